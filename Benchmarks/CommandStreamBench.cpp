@@ -0,0 +1,281 @@
+// Records BlendApp's frame, the ground and the instanced UI draw, into a
+// CommandStream without a device and runs it through NullCommandBackend.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. -I<DirectXMath>/Inc CommandStreamBench.cpp ../CommandStream.cpp ../FrameCommands.cpp ../TerrainMap.cpp ../JobSystem.cpp ../Common/Profiler.cpp -o CommandStreamBench
+//   CommandStreamBench [--map S] [--elements N] [--frames F] [--draws D] [--min-draws M] [--workers W]
+//
+// Prints the stream one command per line, then its hash and what the null
+// backend counted; the stream leaves out addresses, so the output of two
+// builds diffs cleanly.  Every draw has to validate, the exit code is 1
+// otherwise.  Then reports ns/frame to record and validate the stream.
+//
+// Then splits a made-up scene of D draws (4096 by default) the way
+// BlendApp::DrawRenderItems does, into up to four chunks of at least M draws
+// (128, the app's default).  Every chunk has to validate on its own, and
+// every draw has to see the same state bound as in the whole stream.
+// Reports ns/frame to split, and to replay the chunks one after the other
+// and on W workers (three by default).
+
+#include "FrameCommands.h"
+#include "JobSystem.h"
+#include "TerrainMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// FrameResource::MaxUIInstances; FrameResource.h pulls in D3D12.
+	const int MaxUIInstances = 32767;
+
+	// DXGI_FORMAT_R16_UINT and D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST.
+	const std::uint32_t IndexFormat = 57;
+	const std::uint32_t TriangleList = 4;
+
+	// Stand-ins for the device objects; only their names reach the dump.
+	const int MapPso = 0, MapRootSignature = 0, UIPso = 0, UIRootSignature = 0;
+
+	// Made-up GPU addresses, apart like the app's upload buffers would be.
+	const std::uint64_t PassCB = 0x10000, ObjectCB = 0x20000, Textures = 0x30000,
+		MapVertices = 0x1000000, MapIndices = 0x4000000, UIInstances = 0x5000000, UIDrawList = 0x5100000,
+		RectVertices = 0x5200000, RectIndices = 0x5210000;
+
+	// A scene of render items: a material, so a pipeline and a texture, per
+	// 64 items, a mesh per 256 and an object constant buffer slot each.
+	CommandStream Scene(size_t draws)
+	{
+		static const int Opaque = 0, AlphaTested = 0;
+		CommandStream s;
+		s.SetRootSignature(&MapRootSignature, "Map");
+		s.SetRootConstantBufferView(2, PassCB);
+		s.SetPrimitiveTopology(TriangleList);
+		for (size_t i = 0; i < draws; ++i)
+		{
+			if (i % 64 == 0)
+			{
+				if ((i / 64) % 2) s.SetPipelineState(&AlphaTested, "AlphaTested");
+				else s.SetPipelineState(&Opaque, "Opaque");
+				s.SetRootDescriptorTable(0, Textures + (i / 64) * 32);
+			}
+			if (i % 256 == 0)
+			{
+				s.SetVertexBuffer(0, MapVertices + (i / 256) * 0x10000, 0x10000, 32);
+				s.SetIndexBuffer(MapIndices + (i / 256) * 0x1000, 0x1000, IndexFormat);
+			}
+			s.SetRootConstantBufferView(1, ObjectCB + i * 256);
+			s.DrawIndexedInstanced(36 + (std::uint32_t)(i % 7) * 6, 1, (std::uint32_t)(i % 5) * 36, 0, 0);
+		}
+		return s;
+	}
+
+	// Per draw, everything bound when it runs, addresses included.  Every
+	// stream starts from nothing bound, as a command list does.
+	std::vector<std::string> DrawStates(const std::vector<const CommandStream*>& streams)
+	{
+		std::vector<std::string> out;
+		for (const CommandStream* s : streams)
+		{
+			std::string pso, rootSig, indexBuffer, topology;
+			std::vector<std::string> vertexBuffers, rootParameters;
+			auto bind = [](std::vector<std::string>& slots, const Command& c, std::uint64_t value)
+			{
+				if (slots.size() <= c.Slot) slots.resize(c.Slot + 1);
+				slots[c.Slot] = std::to_string(value);
+			};
+			for (const Command& c : s->Commands())
+			{
+				switch (c.Type)
+				{
+				case CommandType::SetPipelineState: pso = c.State.Name; break;
+				case CommandType::SetRootSignature: rootSig = c.State.Name; break;
+				case CommandType::SetVertexBuffer: bind(vertexBuffers, c, c.Buffer.Location); break;
+				case CommandType::SetIndexBuffer: indexBuffer = std::to_string(c.Buffer.Location); break;
+				case CommandType::SetPrimitiveTopology: topology = std::to_string(c.Topology); break;
+				case CommandType::SetRootDescriptorTable:
+				case CommandType::SetRootConstantBufferView:
+				case CommandType::SetRootShaderResourceView:
+					bind(rootParameters, c, c.Address);
+					break;
+				case CommandType::DrawIndexedInstanced:
+				{
+					std::ostringstream d;
+					d << pso << " " << rootSig << " " << indexBuffer << " " << topology << " |";
+					for (const auto& v : vertexBuffers) d << " " << v;
+					d << " |";
+					for (const auto& p : rootParameters) d << " " << p;
+					d << " | " << c.Draw.IndexCountPerInstance << " " << c.Draw.StartIndexLocation;
+					out.push_back(d.str());
+					break;
+				}
+				default:
+					break;
+				}
+			}
+		}
+		return out;
+	}
+
+	bool CheckSplit(const CommandStream& scene, size_t minDraws, std::vector<CommandStream>& chunks, size_t expected)
+	{
+		const size_t count = SplitCommandStream(scene, minDraws, chunks);
+		std::vector<const CommandStream*> split;
+		for (size_t k = 0; k < count; ++k) split.push_back(count == 1 ? &scene : &chunks[k]);
+
+		bool ok = true;
+		if (count != expected)
+		{
+			std::fprintf(stderr, "split at %zu: %zu chunks, wanted %zu\n", minDraws, count, expected);
+			ok = false;
+		}
+		std::uint64_t draws = 0;
+		for (const CommandStream* s : split)
+		{
+			NullCommandBackend backend;
+			backend.Execute(*s);
+			draws += backend.GetStats().Draws;
+			for (const auto& err : backend.Errors()) std::fprintf(stderr, "split at %zu: %s\n", minDraws, err.c_str());
+			ok = ok && backend.Errors().empty();
+		}
+		if (DrawStates(split) != DrawStates({ &scene }))
+		{
+			std::fprintf(stderr, "split at %zu: draws see other state than in the whole stream (%llu draws)\n", minDraws, (unsigned long long)draws);
+			ok = false;
+		}
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int map = 256, elements = 2000, frames = 20000, draws = 4096, minDraws = 128, workers = 3;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--map") map = std::min(std::max(2, value), 256);
+		else if (arg == "--elements") elements = std::min(std::max(0, value), MaxUIInstances);
+		else if (arg == "--frames") frames = std::max(1, value);
+		else if (arg == "--draws") draws = std::max(1, value);
+		else if (arg == "--min-draws") minDraws = std::max(1, value);
+		else if (arg == "--workers") workers = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	// The ground's mesh as BlendApp::BuildWavesGeometry makes it.
+	TerrainMap terrain((std::uint32_t)map);
+	const size_t mapIndices = terrain.BuildIndices<std::uint16_t>().size();
+
+	GroundDraw ground;
+	ground.Pso = &MapPso;
+	ground.RootSignature = &MapRootSignature;
+	ground.PassCB = PassCB;
+	ground.ObjectCB = ObjectCB;
+	ground.Textures = Textures;
+	ground.Mesh.Vertices = { MapVertices, (std::uint32_t)(terrain.Vertices().size() * sizeof(VertexForMap)), (std::uint32_t)sizeof(VertexForMap) };
+	ground.Mesh.Indices = { MapIndices, (std::uint32_t)(mapIndices * sizeof(std::uint16_t)), IndexFormat };
+	ground.Mesh.Topology = TriangleList;
+	ground.Mesh.IndexCount = (std::uint32_t)mapIndices;
+
+	// The unit rect of BlendApp::BuildShapeGeometry: four float2 corners.
+	UIDraw ui;
+	ui.Pso = &UIPso;
+	ui.RootSignature = &UIRootSignature;
+	ui.PassCB = PassCB;
+	ui.Instances = UIInstances;
+	ui.DrawList = UIDrawList;
+	ui.Count = (std::uint32_t)elements;
+	ui.Mesh.Vertices = { RectVertices, 4 * 2 * sizeof(float), 2 * sizeof(float) };
+	ui.Mesh.Indices = { RectIndices, 6 * sizeof(std::uint16_t), IndexFormat };
+	ui.Mesh.Topology = TriangleList;
+	ui.Mesh.IndexCount = 6;
+
+	// Same order as BlendApp::DrawRenderItems.
+	CommandStream stream;
+	RecordGroundDraw(stream, ground);
+	RecordUIDraw(stream, ui);
+
+	stream.Dump(std::cout);
+	NullCommandBackend backend;
+	backend.Execute(stream);
+	const NullCommandBackend::Stats& s = backend.GetStats();
+	std::printf("hash %016llx\n", (unsigned long long)stream.Hash());
+	std::printf("commands %llu  draws %llu  instances %llu  indices %llu  state changes %llu\n",
+		(unsigned long long)s.Commands, (unsigned long long)s.Draws, (unsigned long long)s.Instances,
+		(unsigned long long)s.Indices, (unsigned long long)s.StateChanges);
+	for (const auto& err : backend.Errors()) std::fprintf(stderr, "%s\n", err.c_str());
+	bool ok = backend.Errors().empty();
+
+	volatile std::uint64_t sink = 0;
+	const auto start = Clock::now();
+	for (int f = 0; f < frames; ++f)
+	{
+		stream.Clear();
+		RecordGroundDraw(stream, ground);
+		RecordUIDraw(stream, ui);
+		backend.Reset();
+		backend.Execute(stream);
+		sink += backend.GetStats().Draws;
+	}
+	const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+
+	std::printf("record + validate %.1f ns/frame\n", ns);
+
+	// The app's own frame has two draws and stays whole at the default.
+	std::vector<CommandStream> chunks(4);
+	ok = CheckSplit(stream, 128, chunks, 1) && ok;
+	ok = CheckSplit(stream, 1, chunks, 2) && ok;
+	const CommandStream scene = Scene((size_t)draws);
+	ok = CheckSplit(scene, 1, chunks, std::min<size_t>(4, (size_t)draws)) && ok;
+	ok = CheckSplit(scene, (size_t)draws / 3 + 1, chunks, draws < 3 ? 1 : 2) && ok;
+	ok = CheckSplit(scene, (size_t)draws + 1, chunks, 1) && ok;
+
+	JobSystem jobs((unsigned)workers);
+	const size_t used = SplitCommandStream(scene, (size_t)minDraws, chunks);
+	const int reps = std::max(1, frames / 20);
+	auto timed = [&](auto&& body)
+	{
+		const auto begin = Clock::now();
+		for (int r = 0; r < reps; ++r) body();
+		return std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / reps;
+	};
+	const double splitNs = timed([&]() { SplitCommandStream(scene, (size_t)minDraws, chunks); });
+	const double serialNs = timed([&]()
+	{
+		for (size_t k = 0; k < used; ++k)
+		{
+			NullCommandBackend b;
+			b.Execute(used == 1 ? scene : chunks[k]);
+			sink += b.GetStats().Draws;
+		}
+	});
+	const double parallelNs = timed([&]()
+	{
+		jobs.ParallelFor(used, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t k = begin; k < end; ++k)
+			{
+				NullCommandBackend b;
+				b.Execute(used == 1 ? scene : chunks[k]);
+				sink += b.GetStats().Draws;
+			}
+		});
+	});
+
+	std::printf("scene of %d draws, %zu chunks of at least %d draws, %u threads\n", draws, used, minDraws, jobs.ThreadCount());
+	std::printf("split %.0f ns/frame  replay serial %.0f ns/frame  parallel %.0f ns/frame  speedup %.2fx\n",
+		splitNs, serialNs, parallelNs, serialNs / parallelNs);
+	std::printf("%s\n", ok ? "stream valid" : "INVALID");
+	return ok ? 0 : 1;
+}
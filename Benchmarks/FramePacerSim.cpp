@@ -0,0 +1,151 @@
+// Runs FramePacer against a simulated clock and GPU fence and checks its
+// pacing: the CPU never gets more frames ahead than allowed, GPU-bound runs
+// settle at the GPU frame time, and a target rate is held on average even
+// when sleeps overshoot.
+//
+//   g++ -std=c++17 -O2 -I.. FramePacerSim.cpp ../FramePacer.cpp -o FramePacerSim
+//
+// Per scenario it prints the average frame interval, GPU and CPU waits and the
+// latency from BeginFrame to the GPU finishing the frame.  The exit code is 1
+// if a check failed.
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	class SimClock : public IFrameClock
+	{
+	public:
+		// Sleeps overshoot by up to maxOversleepNs, like a coarse OS timer.
+		explicit SimClock(std::uint64_t maxOversleepNs) : mOversleep(0, maxOversleepNs) {}
+
+		virtual std::uint64_t NowNs()override { return Now; }
+		virtual void SleepNs(std::uint64_t ns)override { Now += ns + mOversleep(mRng); }
+		virtual void Spin()override { Now += 1000; }
+
+		std::uint64_t Now = 1000000;
+
+	private:
+		std::mt19937 mRng{ 5 };
+		std::uniform_int_distribution<std::uint64_t> mOversleep;
+	};
+
+	// A GPU that runs submitted frames back to back.  Fence value v completes
+	// when frame v is done.
+	class SimFence : public IFrameFence
+	{
+	public:
+		explicit SimFence(SimClock& clock) : mClock(clock) {}
+
+		virtual std::uint64_t CompletedValue()override
+		{
+			std::uint64_t v = 0;
+			while (v < mEnd.size() && mEnd[v] <= mClock.Now) ++v;
+			return v;
+		}
+
+		virtual void WaitFor(std::uint64_t value)override
+		{
+			mClock.Now = std::max(mClock.Now, mEnd[value - 1]);
+		}
+
+		std::uint64_t Submit(std::uint64_t gpuNs)
+		{
+			const std::uint64_t start = std::max(mClock.Now, mEnd.empty() ? 0 : mEnd.back());
+			mEnd.push_back(start + gpuNs);
+			return mEnd.size();
+		}
+
+		std::uint64_t EndOf(std::uint64_t value)const { return mEnd[value - 1]; }
+
+	private:
+		SimClock& mClock;
+		std::vector<std::uint64_t> mEnd;
+	};
+
+	struct Scenario
+	{
+		const char* Name;
+		int FramesInFlight;
+		double TargetFps;
+		double CpuMs;
+		double GpuMs;
+		// Expected average frame interval.
+		double ExpectMs;
+	};
+
+	bool Run(const Scenario& s)
+	{
+		const int frames = 600;
+		SimClock clock(1500000);
+		SimFence fence(clock);
+		FramePacer pacer(fence, clock);
+		pacer.SetFramesInFlight(s.FramesInFlight);
+		pacer.SetTargetFps(s.TargetFps);
+
+		std::uint64_t violations = 0;
+		double latencyMs = 0.0;
+		std::vector<std::uint64_t> submitted;
+		FrameTiming sum;
+		for (int f = 0; f < frames; ++f)
+		{
+			const int slot = pacer.BeginFrame();
+			const std::uint64_t begin = clock.Now;
+
+			// The frame being started counts as one in flight.
+			const std::uint64_t inFlight = submitted.size() - fence.CompletedValue() + 1;
+			if (inFlight > (std::uint64_t)s.FramesInFlight) ++violations;
+
+			clock.Now += (std::uint64_t)(s.CpuMs * 1e6);
+			const std::uint64_t value = fence.Submit((std::uint64_t)(s.GpuMs * 1e6));
+			pacer.EndFrame(slot, value);
+			submitted.push_back(value);
+
+			// Skip the warm-up while the queue fills.
+			if (f >= 10)
+			{
+				latencyMs += (fence.EndOf(value) - begin) / 1e6;
+				sum.GpuWaitMs += pacer.LastFrame().GpuWaitMs;
+				sum.CpuWaitMs += pacer.LastFrame().CpuWaitMs;
+				sum.IntervalMs += pacer.LastFrame().IntervalMs;
+			}
+		}
+
+		const double n = frames - 10;
+		const double interval = sum.IntervalMs / n;
+		const bool ok = violations == 0 && std::fabs(interval - s.ExpectMs) <= s.ExpectMs * 0.01;
+		std::printf("%-22s %6d %8.1f %11.3f %10.3f %10.3f %11.3f %10llu  %s\n",
+			s.Name, s.FramesInFlight, s.TargetFps, interval, sum.GpuWaitMs / n, sum.CpuWaitMs / n,
+			latencyMs / n, (unsigned long long)violations, ok ? "ok" : "FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	const Scenario scenarios[] =
+	{
+		{ "gpu-bound",       1, 0.0,  5.0, 12.0, 17.0 },
+		{ "gpu-bound",       2, 0.0,  5.0, 12.0, 12.0 },
+		{ "gpu-bound",       3, 0.0,  5.0, 12.0, 12.0 },
+		{ "gpu-bound",       4, 0.0,  5.0, 12.0, 12.0 },
+		{ "cpu-bound",       3, 0.0, 10.0,  4.0, 10.0 },
+		{ "target 60",       2, 60.0, 3.0,  4.0, 1000.0 / 60.0 },
+		{ "target 144",      3, 144.0, 3.0, 4.0, 1000.0 / 144.0 },
+		{ "target above gpu", 2, 120.0, 3.0, 12.0, 12.0 },
+		{ "target below cpu", 2, 60.0, 25.0, 4.0, 25.0 },
+	};
+
+	std::printf("%-22s %6s %8s %11s %10s %10s %11s %10s\n",
+		"scenario", "frames", "fps", "interval ms", "gpu wait", "cpu wait", "latency ms", "overruns");
+
+	bool ok = true;
+	for (const auto& s : scenarios) ok &= Run(s);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+// Headless replay of a recorded input session (BlendDemo -record <file>):
+// runs the frames of the recording through MapEditor, the same camera, brush
+// and UI click code BlendApp uses, at the recording's fixed step, followed by
+// the dirty terrain copy of BlendApp::UpdateTerrainVB and the UI layout and
+// UIInstance emission of BlendApp::UpdateObjectCBs.  Nothing depends on the
+// wall clock, so two builds replaying the same file do the same work.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc InputReplay.cpp ../MapEditor.cpp ../InputRecorder.cpp ../TerrainMap.cpp -o InputReplay
+//   InputReplay <recording> [--html ../sample.html] [--css ../somestyle.css]
+//   InputReplay --synthesize <recording> [--frames N] [--seed S]
+//
+// --synthesize writes a generated session (camera moves, brush strokes on all
+// layers, UI clicks) for machines without a recorded one.
+//
+// Per phase it reports the mean and p95 time per frame.  The checksum covers
+// the terrain vertices and UI colors at the end of the run; it has to match
+// between builds for their timings to be comparable.
+
+#include "MapEditor.h"
+#include "UIInstance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double Microseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	bool ReadFile(const std::string& path, std::string& out)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) return false;
+		std::stringstream s;
+		s << file.rdbuf();
+		out = s.str();
+		return true;
+	}
+
+	const size_t MaxUIInstances = 32767;
+
+	// The UIInstance write of BlendApp::UpdateObjectCBs, filling from the top.
+	void EmitElement(UIInstance* instances, size_t& i, const YTML1_1::Element& e)
+	{
+		if (i >= MaxUIInstances) return;
+
+		UIInstance& inst = *new(&instances[MaxUIInstances - 1 - i++]) UIInstance;
+		const auto& d = e.size_in_display;
+		inst.Rect = { d.x, d.y, d.w, d.h };
+		inst.FillColor = PackUIColor(e.background_color);
+		inst.BorderColor = PackUIColor(e.border_color);
+		inst.BorderWidths = PackUIBorderWidths(e.border.left, e.border.top, e.border.right, e.border.bottom);
+		inst.CornerRadius = e.border_radius;
+	}
+
+	struct Fnv
+	{
+		std::uint64_t Hash = 14695981039346656037ull;
+
+		void Add(const void* data, size_t size)
+		{
+			auto bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; ++i)
+			{
+				Hash ^= bytes[i];
+				Hash *= 1099511628211ull;
+			}
+		}
+	};
+
+	struct Phase
+	{
+		const char* Name = "";
+		std::vector<double> Us = {};
+
+		void Report()const
+		{
+			std::vector<double> sorted = Us;
+			std::sort(sorted.begin(), sorted.end());
+			double total = 0.0;
+			for (double v : sorted) total += v;
+			const double mean = sorted.empty() ? 0.0 : total / sorted.size();
+			const double p95 = sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.95))];
+			std::printf("%-8s %12.2f %12.2f %12.1f\n", Name, mean, p95, total / 1000.0);
+		}
+	};
+
+	InputEvent Mouse(InputEventType type, std::uint32_t buttons, int x, int y)
+	{
+		InputEvent e;
+		e.Type = type;
+		e.Buttons = buttons;
+		e.X = x;
+		e.Y = y;
+		return e;
+	}
+
+	InputEvent Key(InputEventType type, std::uint32_t key)
+	{
+		InputEvent e;
+		e.Type = type;
+		e.Key = key;
+		return e;
+	}
+
+	// Alternates between panning with a WASD key, dragging a brush stroke over
+	// the middle of the view on the next layer, and clicking somewhere.
+	InputRecording Synthesize(std::uint32_t frames, unsigned seed)
+	{
+		InputRecording rec;
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> x(0, (int)rec.ClientWidth - 1), y(0, (int)rec.ClientHeight - 1);
+		std::uniform_int_distribution<int> length(30, 180), action(0, 2);
+		std::normal_distribution<float> turn(0.f, 0.2f);
+		const std::uint32_t moveKeys[] = { 'W', 'A', 'S', 'D' };
+		const auto stepUs = (std::uint64_t)(rec.FixedStep * 1e6);
+
+		std::uint32_t f = 0, layer = 0;
+		auto add = [&](const InputEvent& e) { rec.Add(f, f * stepUs, e); };
+		while (f + 1 < frames)
+		{
+			const std::uint32_t end = std::min(frames - 1, f + (std::uint32_t)length(rng));
+			switch (action(rng))
+			{
+			case 0:
+			{
+				const std::uint32_t key = moveKeys[rng() % 4];
+				add(Key(InputEventType::KeyDown, key));
+				f = end;
+				add(Key(InputEventType::KeyUp, key));
+				break;
+			}
+			case 1:
+			{
+				const std::uint32_t layerKey = '1' + layer;
+				layer = (layer + 1) % 4;
+				add(Key(InputEventType::KeyDown, layerKey));
+				add(Key(InputEventType::KeyUp, layerKey));
+
+				float px = rec.ClientWidth * 0.5f, py = rec.ClientHeight * 0.5f, heading = 0.f;
+				add(Mouse(InputEventType::MouseDown, InputCode::LeftButton, (int)px, (int)py));
+				while (++f < end)
+				{
+					heading += turn(rng);
+					px = std::min(std::max(px + std::cos(heading) * 4.f, 0.f), rec.ClientWidth - 1.f);
+					py = std::min(std::max(py + std::sin(heading) * 4.f, 0.f), rec.ClientHeight - 1.f);
+					add(Mouse(InputEventType::MouseMove, InputCode::LeftButton, (int)px, (int)py));
+				}
+				add(Mouse(InputEventType::MouseUp, 0, (int)px, (int)py));
+				break;
+			}
+			default:
+			{
+				const int cx = x(rng), cy = y(rng);
+				add(Mouse(InputEventType::MouseMove, 0, cx, cy));
+				add(Mouse(InputEventType::MouseDown, InputCode::LeftButton, cx, cy));
+				++f;
+				add(Mouse(InputEventType::MouseUp, 0, cx, cy));
+				break;
+			}
+			}
+			++f;
+		}
+		rec.FrameCount = frames;
+		return rec;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string recordingPath, synthesizePath;
+	std::string htmlPath = "../sample.html", cssPath = "../somestyle.css";
+	std::uint32_t frames = 3600;
+	unsigned seed = 1;
+
+	for (int a = 1; a < argc; ++a)
+	{
+		std::string arg = argv[a];
+		const bool hasValue = a + 1 < argc;
+		if (arg == "--html" && hasValue) htmlPath = argv[++a];
+		else if (arg == "--css" && hasValue) cssPath = argv[++a];
+		else if (arg == "--synthesize" && hasValue) synthesizePath = argv[++a];
+		else if (arg == "--frames" && hasValue) frames = (std::uint32_t)std::max(2, std::atoi(argv[++a]));
+		else if (arg == "--seed" && hasValue) seed = (unsigned)std::atoi(argv[++a]);
+		else if (arg[0] != '-' && recordingPath.empty()) recordingPath = arg;
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	if (!synthesizePath.empty())
+	{
+		if (!Synthesize(frames, seed).Save(synthesizePath))
+		{
+			std::fprintf(stderr, "cannot write %s\n", synthesizePath.c_str());
+			return 2;
+		}
+		return 0;
+	}
+
+	InputRecording recording;
+	if (recordingPath.empty() || !recording.Load(recordingPath))
+	{
+		std::fprintf(stderr, "cannot load recording '%s'\n", recordingPath.c_str());
+		return 2;
+	}
+
+	std::string css, html;
+	if (!ReadFile(cssPath, css) || !ReadFile(htmlPath, html))
+	{
+		std::fprintf(stderr, "cannot read %s or %s\n", cssPath.c_str(), htmlPath.c_str());
+		return 2;
+	}
+
+	// Same setup as BlendApp::BuildFrameResources and OnResize.
+	YTML1_1::Tree ui;
+	YTML1_1::StyleSheet style;
+	size_t uid = 1;
+	YTML1_1::ParseCSS(css, style);
+	YTML1_1::ParseYTML1_1(html, ui, style, uid);
+	ui->eid = 0;
+	ui->size = { (float)recording.ClientWidth, (float)recording.ClientHeight };
+	ui->flags = 0;
+
+	MapEditor editor;
+	editor.SetViewport((int)recording.ClientWidth, (int)recording.ClientHeight);
+	editor.Terrain().TakeDirtyRange();
+
+	std::vector<unsigned char> vertices(editor.Terrain().Vertices().size() * sizeof(VertexForMap));
+	std::vector<UIInstance> instances(MaxUIInstances);
+
+	Phase input{ "input" }, camera{ "camera" }, brush{ "brush" }, upload{ "upload" }, ui_{ "ui" }, frame{ "frame" };
+	size_t events = 0, changedVertices = 0, uploadedBytes = 0, elements = 0;
+
+	InputPlayer player(recording);
+	const float dt = (float)recording.FixedStep;
+	for (std::uint32_t f = 0; !player.Finished(f); ++f)
+	{
+		const auto frameStart = Clock::now();
+
+		auto start = Clock::now();
+		for (const auto& e : player.EventsFor(f))
+		{
+			editor.HandleEvent(e, ui);
+			++events;
+		}
+		input.Us.push_back(Microseconds(start));
+
+		start = Clock::now();
+		editor.UpdateCamera(dt);
+		camera.Us.push_back(Microseconds(start));
+
+		start = Clock::now();
+		changedVertices += editor.UpdateBrush();
+		brush.Us.push_back(Microseconds(start));
+
+		start = Clock::now();
+		auto dirty = editor.Terrain().TakeDirtyRange();
+		if (!dirty.Empty())
+		{
+			std::memcpy(vertices.data() + dirty.Begin * sizeof(VertexForMap),
+				&editor.Terrain().Vertices()[dirty.Begin], dirty.Count() * sizeof(VertexForMap));
+		}
+		uploadedBytes += dirty.Count() * sizeof(VertexForMap);
+		upload.Us.push_back(Microseconds(start));
+
+		start = Clock::now();
+		size_t i = 0;
+		YTML1_1::RunYTML1_1(ui, [&](YTML1_1::Element& e, bool&)
+			{
+				if (e.flags & ElementFlag::Enable) EmitElement(instances.data(), i, e);
+			});
+		elements += i;
+		ui_.Us.push_back(Microseconds(start));
+
+		frame.Us.push_back(Microseconds(frameStart));
+	}
+
+	Fnv checksum;
+	const auto& terrain = editor.Terrain().Vertices();
+	checksum.Add(terrain.data(), terrain.size() * sizeof(VertexForMap));
+	YTML1_1::RunYTML1_1(ui, [&](YTML1_1::Element& e, bool&)
+		{
+			checksum.Add(&e.background_color, sizeof(e.background_color));
+		});
+
+	std::printf("%u frames at %.2f ms, %zu events, %zu vertices brushed, %zu bytes uploaded, %zu UI elements\n",
+		recording.FrameCount, recording.FixedStep * 1000.0, events, changedVertices, uploadedBytes, elements);
+	std::printf("checksum %016llx\n", (unsigned long long)checksum.Hash);
+	std::printf("%-8s %12s %12s %12s\n", "phase", "mean us/f", "p95 us/f", "total ms");
+	for (const Phase* p : { &input, &camera, &brush, &upload, &ui_, &frame }) p->Report();
+	return 0;
+}
@@ -0,0 +1,147 @@
+// Scheduler microbenchmark for JobSystem / TaskGraph.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. JobSystemBench.cpp ../JobSystem.cpp ../Common/Profiler.cpp -o JobSystemBench
+//   JobSystemBench [--workers W]
+//
+// W defaults to one per hardware thread besides the caller, but never fewer
+// than three, so the scheduler is measured on a one-core machine too.
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	volatile float gSink = 0.f;
+	void Sink(const float* v, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i) gSink = gSink + v[i];
+	}
+
+	// Some floating point work that the compiler cannot fold away.
+	float Burn(size_t begin, size_t end, const std::vector<float>& in)
+	{
+		float acc = 0.f;
+		for (size_t i = begin; i < end; ++i) acc += std::sqrt(in[i] * 0.5f + 1.f) * std::sin(in[i]);
+		return acc;
+	}
+
+	void BenchEmptyTasks(JobSystem& jobs)
+	{
+		const size_t count = 200000;
+		// Without workers ParallelFor runs the range inline, which times a
+		// loop and not the scheduler.
+		if (jobs.ThreadCount() < 2)
+		{
+			std::printf("empty tasks        no workers, scheduler bypassed\n");
+			return;
+		}
+
+		auto start = Clock::now();
+		jobs.ParallelFor(count, 1, [](size_t, size_t) {});
+		double t = Seconds(start);
+		std::printf("empty tasks        %8zu tasks  %8.1f ns/task\n", count, t * 1e9 / count);
+	}
+
+	void BenchParallelFor(JobSystem& jobs)
+	{
+		const size_t count = 1 << 22;
+		std::vector<float> in(count);
+		for (size_t i = 0; i < count; ++i) in[i] = (float)(i % 1000);
+
+		auto start = Clock::now();
+		float serial = Burn(0, count, in);
+		double ts = Seconds(start);
+
+		const size_t grain = 16384;
+		std::vector<float> partial((count + grain - 1) / grain);
+		start = Clock::now();
+		jobs.ParallelFor(count, grain, [&](size_t b, size_t e) { partial[b / grain] = Burn(b, e, in); });
+		double tp = Seconds(start);
+
+		Sink(&serial, 1);
+		Sink(partial.data(), partial.size());
+		std::printf("parallel for       serial %7.2f ms  parallel %7.2f ms  speedup %5.2fx\n",
+			ts * 1e3, tp * 1e3, ts / tp);
+	}
+
+	// Same shape as BlendApp::Update: three independent chains that join.
+	void BenchFrameGraph(JobSystem& jobs)
+	{
+		const size_t count = 1 << 18;
+		std::vector<float> in(count, 1.f);
+		float out[6] = {};
+
+		TaskGraph graph;
+		size_t brush = graph.Add([&]() { out[0] = Burn(0, count / 4, in); });
+		size_t terrain = graph.Add([&]() { out[1] = Burn(0, count, in); });
+		size_t ui = graph.Add([&]() { out[2] = Burn(0, count, in); });
+		size_t anim = graph.Add([&]() { out[3] = Burn(0, count / 8, in); });
+		size_t mats = graph.Add([&]() { out[4] = Burn(0, count / 8, in); });
+		size_t pass = graph.Add([&]() { out[5] = Burn(0, count / 8, in); });
+		graph.Precede(brush, terrain);
+		graph.Precede(brush, pass);
+		graph.Precede(anim, mats);
+		graph.Precede(mats, pass);
+		(void)ui;
+
+		const int frames = 200;
+		auto start = Clock::now();
+		for (int f = 0; f < frames; ++f)
+		{
+			out[0] = Burn(0, count / 4, in); out[1] = Burn(0, count, in); out[2] = Burn(0, count, in);
+			out[3] = Burn(0, count / 8, in); out[4] = Burn(0, count / 8, in); out[5] = Burn(0, count / 8, in);
+			Sink(out, 6);
+		}
+		double ts = Seconds(start);
+
+		start = Clock::now();
+		for (int f = 0; f < frames; ++f)
+		{
+			graph.Run(jobs);
+			Sink(out, 6);
+		}
+		double tg = Seconds(start);
+
+		std::printf("frame task graph   serial %7.3f ms/frame  graph %7.3f ms/frame  speedup %5.2fx\n",
+			ts * 1e3 / frames, tg * 1e3 / frames, ts / tg);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned workers = std::max(std::thread::hardware_concurrency(), 4u) - 1;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--workers") workers = (unsigned)std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	JobSystem jobs(workers);
+	std::printf("threads: %u\n", jobs.ThreadCount());
+
+	BenchEmptyTasks(jobs);
+	BenchParallelFor(jobs);
+	BenchFrameGraph(jobs);
+	return 0;
+}
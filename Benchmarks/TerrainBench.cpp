@@ -0,0 +1,189 @@
+// Terrain brushing benchmark: replays brush strokes on TerrainMap at several
+// map sizes and brush radii, one dab per frame like BlendApp::UpdateBrush,
+// and uploads the dirty range after every frame like BlendApp::UpdateTerrainVB.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc TerrainBench.cpp ../TerrainMap.cpp -o TerrainBench
+//   TerrainBench [--strokes file] [--dabs-per-frame N]
+//
+// A strokes file has one normalized "x y" dab per line, strokes separated by
+// blank lines.  Without one a fixed set of random strokes is generated.
+//
+// Per configuration it reports the time per dab, the vertices and bytes a dab
+// marks dirty, and per frame the bytes and time of the dirty-range upload next
+// to the bytes of re-uploading the whole map.
+
+#include "TerrainMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+	using Stroke = std::vector<DirectX::XMFLOAT2>;
+
+	double Nanoseconds(Clock::time_point start)
+	{
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	}
+
+	// Wandering strokes of a few hundred frames each, at the pace of a mouse
+	// dragged across a 256 map in a couple of seconds.
+	std::vector<Stroke> GenerateStrokes()
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		std::normal_distribution<float> turn(0.f, 0.15f);
+
+		std::vector<Stroke> strokes(32);
+		for (auto& s : strokes)
+		{
+			DirectX::XMFLOAT2 p = { unit(rng), unit(rng) };
+			float heading = unit(rng) * 6.2831853f;
+			const int dabs = 100 + (int)(unit(rng) * 300);
+			for (int i = 0; i < dabs; ++i)
+			{
+				s.push_back(p);
+				heading += turn(rng);
+				p.x += std::cos(heading) * 0.004f;
+				p.y += std::sin(heading) * 0.004f;
+				if (p.x < 0.f || p.x > 1.f) { heading = 3.1415927f - heading; p.x = std::fmin(std::fmax(p.x, 0.f), 1.f); }
+				if (p.y < 0.f || p.y > 1.f) { heading = -heading; p.y = std::fmin(std::fmax(p.y, 0.f), 1.f); }
+			}
+		}
+		return strokes;
+	}
+
+	bool ReadStrokes(const std::string& path, std::vector<Stroke>& strokes)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) return false;
+
+		strokes.assign(1, Stroke());
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream s(line);
+			DirectX::XMFLOAT2 p;
+			if (s >> p.x >> p.y) strokes.back().push_back(p);
+			else if (!strokes.back().empty()) strokes.push_back(Stroke());
+		}
+		if (strokes.back().empty()) strokes.pop_back();
+		return true;
+	}
+
+	struct Result
+	{
+		size_t Dabs = 0;
+		size_t Frames = 0;
+		double BrushNs = 0.0;
+		size_t ChangedVertices = 0;
+		size_t UploadedBytes = 0;
+		double UploadNs = 0.0;
+	};
+
+	Result Run(std::uint32_t size, float radius, int dabsPerFrame, const std::vector<Stroke>& strokes)
+	{
+		TerrainMap map(size);
+		std::vector<unsigned char> staging(map.Vertices().size() * sizeof(VertexForMap));
+
+		// The initial full upload is not part of the strokes.
+		map.TakeDirtyRange();
+
+		Result r;
+		int layer = 1;
+		for (const auto& stroke : strokes)
+		{
+			for (size_t i = 0; i < stroke.size(); i += dabsPerFrame)
+			{
+				for (size_t d = i; d < i + dabsPerFrame && d < stroke.size(); ++d)
+				{
+					auto start = Clock::now();
+					r.ChangedVertices += map.Brush(stroke[d], radius, layer);
+					r.BrushNs += Nanoseconds(start);
+					++r.Dabs;
+				}
+
+				auto start = Clock::now();
+				auto dirty = map.TakeDirtyRange();
+				if (!dirty.Empty())
+				{
+					std::memcpy(staging.data() + dirty.Begin * sizeof(VertexForMap),
+						&map.Vertices()[dirty.Begin], dirty.Count() * sizeof(VertexForMap));
+				}
+				r.UploadNs += Nanoseconds(start);
+				r.UploadedBytes += dirty.Count() * sizeof(VertexForMap);
+				++r.Frames;
+			}
+
+			layer = layer % (int)(MapTexture::size - 1) + 1;
+		}
+
+		// Keep the copies observable.
+		volatile unsigned char sink = staging[staging.size() / 2];
+		(void)sink;
+		return r;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<Stroke> strokes;
+	int dabsPerFrame = 1;
+
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		if (arg == "--strokes")
+		{
+			if (!ReadStrokes(argv[a + 1], strokes))
+			{
+				std::fprintf(stderr, "cannot read %s\n", argv[a + 1]);
+				return 2;
+			}
+		}
+		else if (arg == "--dabs-per-frame") dabsPerFrame = std::max(1, std::atoi(argv[a + 1]));
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+	if (strokes.empty()) strokes = GenerateStrokes();
+
+	size_t dabs = 0;
+	for (const auto& s : strokes) dabs += s.size();
+	std::printf("%zu strokes, %zu dabs, %d dab(s) per frame, %zu bytes per vertex\n",
+		strokes.size(), dabs, dabsPerFrame, sizeof(VertexForMap));
+	std::printf("%6s %6s %10s %10s %12s %14s %14s %12s\n",
+		"size", "radius", "ns/dab", "verts/dab", "dirty B/dab", "upload B/frame", "full B/frame", "upload ns/f");
+
+	const std::uint32_t sizes[] = { 128, 256, 512, 1024 };
+	const float radii[] = { 3.f, 9.f, 27.f };
+	for (auto size : sizes)
+	{
+		for (auto radius : radii)
+		{
+			Result r = Run(size, radius, dabsPerFrame, strokes);
+			const double perDab = 1.0 / std::max<size_t>(r.Dabs, 1);
+			const double perFrame = 1.0 / std::max<size_t>(r.Frames, 1);
+			std::printf("%6u %6.0f %10.1f %10.1f %12.0f %14.0f %14zu %12.0f\n",
+				size, radius,
+				r.BrushNs * perDab,
+				r.ChangedVertices * perDab,
+				r.ChangedVertices * sizeof(VertexForMap) * perDab,
+				r.UploadedBytes * perFrame,
+				(size_t)size * size * sizeof(VertexForMap),
+				r.UploadNs * perFrame);
+		}
+	}
+	return 0;
+}
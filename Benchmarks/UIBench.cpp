@@ -0,0 +1,400 @@
+// Headless benchmark of the UI pipeline: ParseCSS -> ParseYTML1_1 -> RunYTML1_1
+// -> UIInstance emission, on synthetic documents.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIBench.cpp -o UIBench
+//   UIBench [--reps N] [--baseline ui_baseline.txt] [--write-baseline file] [--tolerance pct]
+//           [--depth D --fanout F --classes C --inline R --seed S --combinators K]
+//
+// Reports ns/element and allocations/element per phase:
+//   parse     ParseYTML1_1 against an empty stylesheet (inline styles included)
+//   style     ParseCSS plus the extra cost of parsing against the stylesheet
+//   layout    RunYTML1_1 with an empty callback
+//   emission  the UIInstance writes of BlendApp::UpdateObjectCBs on top of layout
+// The selectors scenarios add K rules with descendant and child combinators
+// at two tree depths; their style ns/element should stay close, and the
+// selector line shows how many candidate rules the ancestor Bloom filter
+// rejected and how many elements took their rules from the StyleCache.
+// Any generator option replaces the built-in scenarios with a single "custom" one.
+// With a baseline the exit code is 1 when a phase got slower than the tolerance
+// or allocates more than before.  ui_baseline.txt holds the numbers of the
+// built-in scenarios; rewrite it with --write-baseline on the machine you
+// compare on.
+
+#include "YTML1_1.hpp"
+#include "UIInstance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+// Every allocation in the process goes through here so phases can count them.
+static size_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+	++gAllocations;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct DocumentParams
+	{
+		int Depth = 4;
+		int Fanout = 8;
+		int Classes = 64;
+		float InlineRatio = 0.25f;
+		unsigned Seed = 1;
+		// Rules like ".c1 .c2", ".c1 > .c2" or "div .c1 > .c2" on top of the
+		// one rule per class.
+		int Combinators = 0;
+	};
+
+	struct Document
+	{
+		std::string Css;
+		std::string Ytml;
+	};
+
+	class Generator
+	{
+	public:
+		explicit Generator(const DocumentParams& p) : mParams(p), mRng(p.Seed) {}
+
+		Document Generate()
+		{
+			Document doc;
+
+			std::ostringstream css;
+			for (int k = 0; k < mParams.Classes; ++k)
+			{
+				css << ".c" << k << " {\n";
+				AppendDeclarations(css, "\n\t");
+				css << "\n}\n\n";
+			}
+			for (int k = 0; k < mParams.Combinators; ++k)
+			{
+				const int a = Uniform(0, mParams.Classes - 1), b = Uniform(0, mParams.Classes - 1);
+				switch (Uniform(0, 3))
+				{
+				case 0: css << ".c" << a << " .c" << b; break;
+				case 1: css << ".c" << a << " > .c" << b; break;
+				case 2: css << "div .c" << a << " > .c" << b; break;
+				case 3: css << ".c" << a << ".c" << b << " div"; break;
+				}
+				css << " {\n";
+				AppendDeclarations(css, "\n\t");
+				css << "\n}\n\n";
+			}
+			doc.Css = css.str();
+
+			std::ostringstream ytml;
+			for (int i = 0; i < mParams.Fanout; ++i) AppendElement(ytml, 1);
+			doc.Ytml = ytml.str();
+			return doc;
+		}
+
+	private:
+		int Uniform(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(mRng); }
+
+		void AppendDeclarations(std::ostringstream& s, const char* sep)
+		{
+			s << sep << "width: " << Uniform(4, 400) << "px;";
+			s << sep << "height: " << Uniform(4, 200) << "px;";
+			s << sep << "margin:" << Uniform(0, 10) << " " << Uniform(0, 10) << " " << Uniform(0, 10) << " " << Uniform(0, 10) << ";";
+			if (Uniform(0, 1)) s << sep << "border: 1 1 1 1;";
+			s << sep << "background-color: #" << std::hex << std::setw(6) << std::setfill('0') << Uniform(0, 0xffffff) << std::dec << ";";
+			s << sep << "border-color: #" << std::hex << std::setw(6) << std::setfill('0') << Uniform(0, 0xffffff) << std::dec << ";";
+		}
+
+		void AppendElement(std::ostringstream& s, int depth)
+		{
+			std::string indent(depth - 1, '\t');
+			s << indent << "<div class=\"c" << Uniform(0, mParams.Classes - 1);
+			if (Uniform(0, 3) == 0) s << " c" << Uniform(0, mParams.Classes - 1);
+			s << "\"";
+
+			if (std::uniform_real_distribution<float>(0.f, 1.f)(mRng) < mParams.InlineRatio)
+			{
+				s << " style=\"";
+				AppendDeclarations(s, " ");
+				s << "\"";
+			}
+
+			if (depth == mParams.Depth)
+			{
+				s << "/>\n";
+				return;
+			}
+
+			s << ">\n";
+			for (int i = 0; i < mParams.Fanout; ++i) AppendElement(s, depth + 1);
+			s << indent << "</div>\n";
+		}
+
+		DocumentParams mParams;
+		std::mt19937 mRng;
+	};
+
+	const size_t MaxUIInstances = 32767;
+
+	// The UIInstance write of BlendApp::UpdateObjectCBs, filling from the top.
+	void EmitElement(UIInstance* instances, size_t& i, const YTML1_1::Element& e)
+	{
+		if (i >= MaxUIInstances) return;
+
+		UIInstance& inst = *new(&instances[MaxUIInstances - 1 - i++]) UIInstance;
+		const auto& d = e.size_in_display;
+		inst.Rect = { d.x, d.y, d.w, d.h };
+		inst.FillColor = PackUIColor(e.background_color);
+		inst.BorderColor = PackUIColor(e.border_color);
+		inst.BorderWidths = PackUIBorderWidths(e.border.left, e.border.top, e.border.right, e.border.bottom);
+		inst.CornerRadius = e.border_radius;
+	}
+
+	struct Sample
+	{
+		double Ns = 0.0;
+		size_t Allocations = 0;
+	};
+
+	template<typename Func>
+	Sample Measure(Func&& func)
+	{
+		Sample s;
+		size_t allocs = gAllocations;
+		auto start = Clock::now();
+		func();
+		s.Ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		s.Allocations = gAllocations - allocs;
+		return s;
+	}
+
+	// Fastest run, which is the least disturbed one.  Allocations are the
+	// same in every run.
+	Sample Best(const std::vector<Sample>& samples)
+	{
+		return *std::min_element(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.Ns < b.Ns; });
+	}
+
+	// Layout and emission are cheap next to parsing, so each sample runs them
+	// a number of times to get above timer and scheduling noise.
+	const int TreePasses = 16;
+
+	void ResetRoot(YTML1_1::Tree& root)
+	{
+		// Same root BlendApp builds for a 1280x720 window.
+		root.value = YTML1_1::Element();
+		root->eid = 0;
+		root->size = { 1280.f, 720.f };
+		root->flags = 0;
+	}
+
+	struct PhaseResult
+	{
+		std::string Phase;
+		double NsPerElement;
+		double AllocsPerElement;
+	};
+
+	std::vector<PhaseResult> RunScenario(const Document& doc, int reps, size_t& elementCount, YTML1_1::SelectorStats& selectors)
+	{
+		std::vector<UIInstance> instances(MaxUIInstances);
+		std::vector<Sample> parse, styled, layout, emission;
+
+		for (int r = 0; r < reps; ++r)
+		{
+			{
+				YTML1_1::Tree tree;
+				ResetRoot(tree);
+				YTML1_1::StyleSheet empty;
+				size_t id = 1;
+				parse.push_back(Measure([&]() { YTML1_1::ParseYTML1_1(doc.Ytml, tree, empty, id); }));
+			}
+
+			YTML1_1::Tree tree;
+			ResetRoot(tree);
+			size_t id = 1;
+			YTML1_1::StyleSheet style;
+			styled.push_back(Measure([&]()
+				{
+					YTML1_1::ParseCSS(doc.Css, style);
+					YTML1_1::ParseYTML1_1(doc.Ytml, tree, style, id, &selectors);
+				}));
+			elementCount = id - 1;
+
+			layout.push_back(Measure([&]()
+				{
+					for (int pass = 0; pass < TreePasses; ++pass)
+						YTML1_1::RunYTML1_1(tree, [](YTML1_1::Element&, bool&) {});
+				}));
+
+			emission.push_back(Measure([&]()
+				{
+					for (int pass = 0; pass < TreePasses; ++pass)
+					{
+						size_t i = 0;
+						YTML1_1::RunYTML1_1(tree, [&](YTML1_1::Element& e, bool&)
+						{
+							if (e.flags & ElementFlag::Enable) EmitElement(instances.data(), i, e);
+						});
+					}
+				}));
+		}
+
+		Sample p = Best(parse), s = Best(styled), l = Best(layout), e = Best(emission);
+		const double n = (double)std::max<size_t>(elementCount, 1);
+		const double np = n * TreePasses;
+
+		// The differences can dip below zero on noise.
+		auto diff = [](double a, double b) { return std::max(0.0, a - b); };
+		auto diffAllocs = [](size_t a, size_t b) { return a > b ? (double)(a - b) : 0.0; };
+
+		return {
+			{ "parse", p.Ns / n, p.Allocations / n },
+			{ "style", diff(s.Ns, p.Ns) / n, diffAllocs(s.Allocations, p.Allocations) / n },
+			{ "layout", l.Ns / np, l.Allocations / np },
+			{ "emission", diff(e.Ns, l.Ns) / np, diffAllocs(e.Allocations, l.Allocations) / np },
+		};
+	}
+
+	using Baseline = std::map<std::string, PhaseResult>;
+
+	Baseline ReadBaseline(const std::string& path)
+	{
+		Baseline baseline;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#') continue;
+
+			std::istringstream s(line);
+			std::string scenario;
+			PhaseResult r;
+			if (s >> scenario >> r.Phase >> r.NsPerElement >> r.AllocsPerElement) baseline[scenario + "/" + r.Phase] = r;
+		}
+		return baseline;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int reps = 9;
+	double tolerance = 15.0;
+	std::string baselinePath, writePath;
+	DocumentParams custom;
+	bool useCustom = false;
+
+	for (int a = 1; a < argc; ++a)
+	{
+		std::string arg = argv[a];
+		const char* next = a + 1 < argc ? argv[a + 1] : nullptr;
+		if (next == nullptr)
+		{
+			std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+			return 2;
+		}
+		++a;
+
+		if (arg == "--reps") reps = std::max(1, std::atoi(next));
+		else if (arg == "--baseline") baselinePath = next;
+		else if (arg == "--write-baseline") writePath = next;
+		else if (arg == "--tolerance") tolerance = std::atof(next);
+		else if (arg == "--depth") { custom.Depth = std::max(1, std::atoi(next)); useCustom = true; }
+		else if (arg == "--fanout") { custom.Fanout = std::max(1, std::atoi(next)); useCustom = true; }
+		else if (arg == "--classes") { custom.Classes = std::max(1, std::atoi(next)); useCustom = true; }
+		else if (arg == "--inline") { custom.InlineRatio = (float)std::atof(next); useCustom = true; }
+		else if (arg == "--seed") { custom.Seed = (unsigned)std::atoi(next); useCustom = true; }
+		else if (arg == "--combinators") { custom.Combinators = std::max(0, std::atoi(next)); useCustom = true; }
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::vector<std::pair<std::string, DocumentParams>> scenarios;
+	if (useCustom)
+	{
+		scenarios.push_back({ "custom", custom });
+	}
+	else
+	{
+		scenarios.push_back({ "flat", { 1, 2000, 16, 0.1f, 1 } });
+		scenarios.push_back({ "balanced", { 4, 8, 64, 0.25f, 2 } });
+		scenarios.push_back({ "deep", { 12, 2, 8, 0.f, 3 } });
+		scenarios.push_back({ "inline", { 3, 16, 4, 1.f, 4 } });
+		scenarios.push_back({ "selectors", { 6, 4, 64, 0.f, 5, 400 } });
+		// Deep, but under MaxUIInstances, so every element is emitted.
+		scenarios.push_back({ "selectors-deep", { 13, 2, 64, 0.f, 6, 400 } });
+	}
+
+	Baseline baseline;
+	if (!baselinePath.empty()) baseline = ReadBaseline(baselinePath);
+
+	std::ofstream out;
+	if (!writePath.empty())
+	{
+		out.open(writePath);
+		out << "# scenario phase ns/element allocs/element\n";
+	}
+
+	bool regressed = false;
+	std::printf("%-14s %-9s %10s %10s %12s\n", "scenario", "phase", "ns/elem", "allocs/elem", "vs baseline");
+	for (const auto& sc : scenarios)
+	{
+		Document doc = Generator(sc.second).Generate();
+
+		size_t elements = 0;
+		YTML1_1::SelectorStats selectors;
+		auto results = RunScenario(doc, reps, elements, selectors);
+
+		std::printf("%s: %zu elements, %zu bytes of YTML, %zu bytes of CSS\n",
+			sc.first.c_str(), elements, doc.Ytml.size(), doc.Css.size());
+		if (elements > MaxUIInstances)
+			std::printf("%s: emission stops at %zu instances, so its time is not comparable\n", sc.first.c_str(), MaxUIInstances);
+		const double n = (double)std::max<size_t>(selectors.elements, 1);
+		std::printf("%s: per element %.2f candidate rules, %.2f rejected by the Bloom filter, %.2f matched, %.2f from the style cache\n",
+			sc.first.c_str(), selectors.candidates / n, selectors.bloomRejects / n, selectors.matches / n, selectors.cacheHits / n);
+
+		for (const auto& r : results)
+		{
+			char delta[64] = "";
+			auto itr = baseline.find(sc.first + "/" + r.Phase);
+			if (itr != baseline.end())
+			{
+				const PhaseResult& b = itr->second;
+				double pct = b.NsPerElement > 0.0 ? (r.NsPerElement / b.NsPerElement - 1.0) * 100.0 : 0.0;
+				// Sub-nanosecond phases are all noise in relative terms; a
+				// phase that cost nothing is held to that alone.
+				bool slower = (pct > tolerance || b.NsPerElement <= 0.0) && r.NsPerElement - b.NsPerElement > 1.0;
+				bool moreAllocs = r.AllocsPerElement > b.AllocsPerElement + 0.005;
+				std::snprintf(delta, sizeof(delta), "%+7.1f%%%s%s", pct, slower ? " SLOWER" : "", moreAllocs ? " ALLOCS" : "");
+				regressed |= slower || moreAllocs;
+			}
+
+			std::printf("%-14s %-9s %10.1f %10.2f   %s\n", sc.first.c_str(), r.Phase.c_str(), r.NsPerElement, r.AllocsPerElement, delta);
+			if (out.is_open()) out << sc.first << " " << r.Phase << " " << r.NsPerElement << " " << r.AllocsPerElement << "\n";
+		}
+	}
+
+	return regressed ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+// Benchmark of flex layout in RunYTML1_1 on a document of nested flex
+// containers, about 11k elements by default, many sized by their content.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIFlexBench.cpp -o UIFlexBench
+//   UIFlexBench [--depth D] [--fanout F] [--auto pct] [--reps N] [--seed S]
+//
+// First a few small documents are laid out and their rects compared with
+// ones worked out by hand.  Then the generated document, where --auto is the
+// share of containers with an auto width and height, is laid out again and
+// again: the rects of every run have to equal those of a freshly parsed
+// copy, whose lengths and measurements are all new.  Reports ns/element for
+// kept lengths, for lengths all resolved again and for the same document
+// with every display: flex dropped, content measurements made against those
+// found already made in the same run, and allocations per run once warm.
+// The exit code is 1 on a mismatch.
+
+#include "YTML1_1.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+// Every allocation in the process goes through here so layout runs can
+// count theirs.
+static size_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+	++gAllocations;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const int Classes = 16;
+
+	struct Case
+	{
+		const char* Name;
+		const char* Html;
+		// x, y, w, h of every element after the root, in tree order.
+		std::vector<float> Rects;
+		// Content measurements made and found again; -1 is not checked.
+		int Measured = -1;
+		int Hits = -1;
+	};
+
+	// Laid out in a 400 by 300 root.
+	const Case Cases[] = {
+		{ "grow", "<div style=\"display: flex; width: 310px; height: 100px; column-gap: 10px;\">"
+			"<div style=\"flex: 1;\"/><div style=\"flex: 2;\"/><div style=\"width: 50px; height: 20px;\"/></div>",
+			{ 0, 0, 310, 100, 0, 0, 80, 100, 90, 0, 160, 100, 260, 0, 50, 20 } },
+		{ "shrink", "<div style=\"display: flex; width: 100px; height: 10px;\">"
+			"<div style=\"width: 100px; height: 10px;\"/><div style=\"width: 50px; height: 10px; flex-shrink: 2;\"/></div>",
+			{ 0, 0, 100, 10, 0, 0, 75, 10, 75, 0, 25, 10 } },
+		{ "wrap", "<div style=\"display: flex; flex-wrap: wrap; width: 200px; height: 200px; gap: 10px; align-items: flex-start;\">"
+			"<div style=\"width: 80px; height: 30px;\"/><div style=\"width: 80px; height: 40px;\"/><div style=\"width: 80px; height: 20px;\"/></div>",
+			{ 0, 0, 200, 200, 0, 0, 80, 30, 90, 0, 80, 40, 0, 50, 80, 20 } },
+		{ "column center", "<div style=\"display: flex; flex-direction: column; justify-content: center; align-items: center; width: 100px; height: 200px;\">"
+			"<div style=\"width: 40px; height: 20px;\"/><div style=\"width: 60px; height: 40px;\"/></div>",
+			{ 0, 0, 100, 200, 30, 70, 40, 20, 20, 90, 60, 40 } },
+		{ "reverse", "<div style=\"display: flex; flex-direction: row-reverse; justify-content: space-between; align-items: flex-end; width: 200px; height: 50px;\">"
+			"<div style=\"width: 30px; height: 10px;\"/><div style=\"width: 40px; height: 20px;\"/><div style=\"width: 50px; height: 50px;\"/></div>",
+			{ 0, 0, 200, 50, 170, 40, 30, 10, 90, 30, 40, 20, 0, 0, 50, 50 } },
+		{ "evenly", "<div style=\"display: flex; justify-content: space-evenly; width: 110px; height: 10px;\">"
+			"<div style=\"width: 20px; height: 10px; margin: 0 0 0 10;\"/><div style=\"width: 20px; height: 10px;\"/></div>",
+			{ 0, 0, 110, 10, 30, 0, 20, 10, 70, 0, 20, 10 } },
+		// The outer column is as big as its content, the inner row too; the
+		// row is measured once for the column's size and found again when
+		// the column arranges it.
+		{ "content size", "<div style=\"display: flex; flex-direction: column; border: 2;\">"
+			"<div style=\"display: flex; column-gap: 5px;\"><div style=\"width: 20px; height: 10px;\"/><div style=\"width: 30px; height: 15px;\"/></div>"
+			"<div style=\"width: 50px; height: 5px;\"/></div>",
+			{ 0, 0, 59, 24, 2, 2, 55, 15, 2, 2, 20, 10, 27, 2, 30, 15, 2, 17, 50, 5 }, 2, 1 },
+	};
+
+	// x, y, w, h of every element after the root, in tree order.
+	void Rects(YTML1_1::Tree& tree, std::vector<float>& out)
+	{
+		out.clear();
+		bool root = true;
+		YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e)
+			{
+				const auto& d = e.size_in_display;
+				if (!root) out.insert(out.end(), { d.x, d.y, d.w, d.h });
+				root = false;
+			}, tree);
+	}
+
+	void Parse(const std::string& html, const std::string& css, YTML1_1::Tree& tree, float w, float h)
+	{
+		YTML1_1::StyleSheet sheet;
+		YTML1_1::ParseCSS(css, sheet);
+		size_t id = 1;
+		YTML1_1::ParseYTML1_1(html, tree, sheet, id);
+		tree->eid = 0;
+		tree->flags = 0;
+		tree->size = { w, h };
+	}
+
+	bool CheckCases()
+	{
+		auto nop = [](YTML1_1::Element&, bool&) {};
+		bool ok = true;
+		std::vector<float> got;
+		for (const Case& c : Cases)
+		{
+			YTML1_1::Tree tree;
+			Parse(c.Html, "", tree, 400.f, 300.f);
+			YTML1_1::LayoutStats stats;
+			YTML1_1::RunYTML1_1(tree, nop, &stats);
+			Rects(tree, got);
+			const bool counts = (c.Measured < 0 || (size_t)c.Measured == stats.measured) && (c.Hits < 0 || (size_t)c.Hits == stats.measure_hits);
+			if (got == c.Rects && counts) continue;
+
+			ok = false;
+			std::fprintf(stderr, "%s: measured %zu, found %zu; rects", c.Name, stats.measured, stats.measure_hits);
+			for (float v : got) std::fprintf(stderr, " %g", v);
+			std::fprintf(stderr, "\n");
+		}
+		return ok;
+	}
+
+	void AppendElement(std::ostringstream& s, std::mt19937& rng, int depth, int maxDepth, int fanout)
+	{
+		std::uniform_int_distribution<int> cls(0, Classes - 1);
+		if (depth == maxDepth)
+		{
+			s << "<div class=\"l" << cls(rng) << "\"/>\n";
+			return;
+		}
+		s << "<div class=\"f" << cls(rng) << "\">\n";
+		for (int i = 0; i < fanout; ++i) AppendElement(s, rng, depth + 1, maxDepth, fanout);
+		s << "</div>\n";
+	}
+
+	// f classes are containers, l classes leaves.  With flex false the
+	// containers keep their sizes but not display: flex.
+	std::string Stylesheet(unsigned seed, int autoPct, bool flex)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> pct(0, 99), small(2, 40), pick(0, 5);
+		static const char* directions[] = { "row", "column", "row-reverse", "column-reverse" };
+		static const char* justify[] = { "flex-start", "flex-end", "center", "space-between", "space-around", "space-evenly" };
+		static const char* align[] = { "stretch", "flex-start", "flex-end", "center" };
+		std::ostringstream css;
+		for (int k = 0; k < Classes; ++k)
+		{
+			css << ".f" << k << " {\n";
+			if (flex) css << "\tdisplay: flex;\n";
+			css << "\tflex-direction: " << directions[k % 4] << ";\n\tjustify-content: " << justify[pick(rng)] << ";\n";
+			css << "\talign-items: " << align[pick(rng) % 4] << ";\n\tgap: " << small(rng) / 4 << "px;\n\tborder: 1;\n";
+			if (k % 3 == 0) css << "\tflex-wrap: wrap;\n";
+			if (k * 100 >= autoPct * Classes) css << "\twidth: " << 40 + pct(rng) << "%;\n\theight: " << 20 + pct(rng) * 4 << "px;\n";
+			if (k % 2) css << "\tflex: 1 1 auto;\n";
+			css << "}\n";
+
+			css << ".l" << k << " {\n\twidth: " << small(rng) << "px;\n\theight: " << small(rng) << "px;\n\tmargin: 1 2 1 2;\n";
+			if (k % 4 == 0) css << "\tflex-grow: " << 1 + k % 3 << ";\n";
+			if (k % 5 == 0) css << "\tflex-basis: " << 10 + pct(rng) % 20 << "%;\n";
+			css << "}\n";
+		}
+		return css.str();
+	}
+
+	size_t Count(YTML1_1::Tree& tree)
+	{
+		size_t n = 1;
+		for (auto* c : tree.child) n += Count(*c);
+		return n;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int depth = 4, fanout = 10, autoPct = 40, reps = 20;
+	unsigned seed = 46;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--depth") depth = std::max(1, value);
+		else if (arg == "--fanout") fanout = std::max(1, value);
+		else if (arg == "--auto") autoPct = std::clamp(value, 0, 100);
+		else if (arg == "--reps") reps = std::max(1, value);
+		else if (arg == "--seed") seed = (unsigned)value;
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	bool ok = CheckCases();
+	std::printf("%zu hand-checked layouts %s\n", std::size(Cases), ok ? "match" : "differ");
+
+	std::mt19937 rng(seed);
+	std::ostringstream html;
+	for (int i = 0; i < fanout; ++i) AppendElement(html, rng, 1, depth, fanout);
+	const std::string flexCss = Stylesheet(seed, autoPct, true), blockCss = Stylesheet(seed, autoPct, false);
+
+	YTML1_1::Tree live, block;
+	Parse(html.str(), flexCss, live, 1280.f, 720.f);
+	Parse(html.str(), blockCss, block, 1280.f, 720.f);
+	const size_t elements = Count(live);
+
+	auto nop = [](YTML1_1::Element&, bool&) {};
+	auto time = [&](YTML1_1::Tree& tree, bool resolve, YTML1_1::LayoutStats& stats)
+	{
+		double best = 1e30;
+		for (int r = 0; r < reps; ++r)
+		{
+			if (resolve) YTML1_1::RawLoopTree_L([](YTML1_1::Element& e) { e.lengths_resolved = false; }, tree);
+			const auto start = Clock::now();
+			YTML1_1::RunYTML1_1(tree, nop, &stats);
+			best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+		}
+		return best / (double)elements;
+	};
+
+	YTML1_1::LayoutStats kept, all, flat;
+	const double keptNs = time(live, false, kept);
+	const double allNs = time(live, true, all);
+	const double blockNs = time(block, false, flat);
+
+	const size_t before = gAllocations;
+	YTML1_1::RunYTML1_1(live, nop);
+	const size_t allocations = gAllocations - before;
+
+	// A fresh copy, and the live tree after a resize there and back.
+	YTML1_1::Tree fresh;
+	Parse(html.str(), flexCss, fresh, 1280.f, 720.f);
+	YTML1_1::RunYTML1_1(fresh, nop);
+	live->size = { 1000.f, 600.f };
+	YTML1_1::RunYTML1_1(live, nop);
+	live->size = { 1280.f, 720.f };
+	YTML1_1::RunYTML1_1(live, nop);
+	std::vector<float> a, b;
+	Rects(live, a);
+	Rects(fresh, b);
+	if (a != b)
+	{
+		std::fprintf(stderr, "kept layout differs from a fresh one\n");
+		ok = false;
+	}
+
+	std::printf("%zu elements, %d%% of container classes auto-sized, %d reps\n", elements, autoPct, reps);
+	std::printf("%-16s %10s %10s %10s\n", "layout", "ns/elem", "measured", "found");
+	std::printf("%-16s %10.1f %10zu %10zu\n", "flex, kept", keptNs, kept.measured, kept.measure_hits);
+	std::printf("%-16s %10.1f %10zu %10zu\n", "flex, resolved", allNs, all.measured, all.measure_hits);
+	std::printf("%-16s %10.1f %10s %10s\n", "block", blockNs, "-", "-");
+	std::printf("%zu allocations per warm run\n", allocations);
+	std::printf("%s\n", ok ? "layouts match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
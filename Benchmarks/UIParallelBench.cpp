@@ -0,0 +1,160 @@
+// Scaling benchmark of RunYTML1_1Parallel against RunYTML1_1 on a data grid:
+// a column of rows, each a flex row of cells holding a label and an icon,
+// with some rows in the old flow.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. -I<DirectXMath>/Inc UIParallelBench.cpp ../JobSystem.cpp ../Common/Profiler.cpp -o UIParallelBench
+//   UIParallelBench [--rows R] [--columns C] [--grain G] [--threads T] [--reps N]
+//
+// Lays the grid out serially, then in parallel with 1, 2, 4 ... up to T
+// threads (the hardware threads by default).  Every parallel run has to give
+// the same rects, bit for bit, and call user_func on the same elements in
+// the same order as the serial one; the exit code is 1 otherwise.  Reports
+// ns/element and the speedup over serial layout for each thread count.
+
+#include "YTMLParallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::string Grid(int rows, int columns)
+	{
+		std::ostringstream s;
+		s << "<div class=\"grid\">\n";
+		for (int r = 0; r < rows; ++r)
+		{
+			s << "<div class=\"" << (r % 8 == 7 ? "flow" : "row") << "\">";
+			for (int c = 0; c < columns; ++c)
+				s << "<div class=\"cell c" << c % 4 << "\"><div class=\"label\"/><div class=\"icon\"/></div>";
+			s << "</div>\n";
+		}
+		s << "</div>\n";
+		return s.str();
+	}
+
+	const char* Css =
+		".grid { display: flex; flex-direction: column; width: 100%; height: 100%; row-gap: 1px; }\n"
+		".row { display: flex; height: 1.5em; column-gap: 2px; align-items: center; }\n"
+		".flow { height: 24px; }\n"
+		".cell { display: flex; flex: 1 1 0; height: 90%; border: 1; justify-content: space-between; margin: 0 1 0 1; }\n"
+		".c0 { flex-grow: 2; }\n"
+		".c1 { width: 5%; flex: none; }\n"
+		".c3 { font-size: 0.8em; }\n"
+		".label { flex: 1; height: 1em; margin: 2 4 2 4; }\n"
+		".icon { width: 1em; height: 1em; border-radius: 50%; }\n";
+
+	// Rects of every element, in tree order.
+	void Rects(YTML1_1::Tree& tree, std::vector<float>& out)
+	{
+		out.clear();
+		YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e)
+			{
+				const auto& d = e.size_in_display;
+				out.insert(out.end(), { d.x, d.y, d.w, d.h, e.size.w, e.size.h, e.border_radius, e.font_size });
+			}, tree);
+	}
+
+	bool SameBits(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int rows = 2000, columns = 16, reps = 10;
+	size_t grain = 512;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--rows") rows = std::max(1, value);
+		else if (arg == "--columns") columns = std::max(1, value);
+		else if (arg == "--grain") grain = (size_t)std::max(1, value);
+		else if (arg == "--threads") threads = (unsigned)std::max(1, value);
+		else if (arg == "--reps") reps = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	YTML1_1::StyleSheet sheet;
+	YTML1_1::ParseCSS(Css, sheet);
+	YTML1_1::Tree tree;
+	size_t id = 1;
+	YTML1_1::ParseYTML1_1(Grid(rows, columns), tree, sheet, id);
+	tree->eid = 0;
+	tree->flags = 0;
+	tree->size = { 1920.f, 1080.f };
+
+	std::vector<size_t> order;
+	auto record = [&](YTML1_1::Element& e, bool&) { order.push_back(e.eid); };
+	auto nop = [](YTML1_1::Element&, bool&) {};
+
+	// Every run resolves all lengths and makes all measurements again, as
+	// after a resize.
+	auto time = [&](auto&& layout)
+	{
+		double best = 1e30;
+		for (int r = 0; r < reps; ++r)
+		{
+			YTML1_1::RawLoopTree_L([](YTML1_1::Element& e) { e.lengths_resolved = false; }, tree);
+			const auto start = Clock::now();
+			layout();
+			best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+		}
+		return best;
+	};
+
+	YTML1_1::LayoutStats serialStats;
+	YTML1_1::RunYTML1_1(tree, record, &serialStats);
+	std::vector<float> serialRects, rects;
+	Rects(tree, serialRects);
+	const std::vector<size_t> serialOrder = order;
+	const size_t elements = serialStats.elements;
+	const double serialNs = time([&]() { YTML1_1::RunYTML1_1(tree, nop); });
+
+	std::printf("%zu elements, %d rows of %d cells, grain %zu\n", elements, rows, columns, grain);
+	std::printf("%-10s %10s %10s\n", "threads", "ns/elem", "speedup");
+	std::printf("%-10s %10.1f %10s\n", "serial", serialNs / elements, "1.00");
+
+	bool ok = true;
+	for (unsigned t = 1;; t = std::min(t * 2, threads))
+	{
+		JobSystem jobs(t - 1);
+
+		// Scribble over the rects first, so stale ones cannot pass.
+		YTML1_1::RawLoopTree_L([](YTML1_1::Element& e) { e.size_in_display = { -1.f, -1.f, -1.f, -1.f }; e.lengths_resolved = false; }, tree);
+		order.clear();
+		YTML1_1::LayoutStats stats;
+		YTML1_1::RunYTML1_1Parallel(tree, jobs, record, &stats, grain);
+		Rects(tree, rects);
+		if (!SameBits(rects, serialRects) || order != serialOrder || stats.elements != serialStats.elements ||
+			stats.measured != serialStats.measured || stats.measure_hits != serialStats.measure_hits)
+		{
+			std::fprintf(stderr, "%u threads: layout differs from serial\n", t);
+			ok = false;
+		}
+
+		const double ns = time([&]() { YTML1_1::RunYTML1_1Parallel(tree, jobs, nop, nullptr, grain); });
+		std::printf("%-10u %10.1f %10.2f\n", t, ns / elements, serialNs / ns);
+		if (t == threads) break;
+	}
+	std::printf("%s\n", ok ? "layouts match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
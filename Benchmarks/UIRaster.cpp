@@ -0,0 +1,391 @@
+// Headless UI rasterizer: lays out a document like BlendApp, emits its
+// UIInstances and shades them on the CPU with ShadeUIInstance, the reference
+// of UI.hlsl's pixel shader, so UI rendering can be checked without a GPU.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIRaster.cpp ../UICuller.cpp -o UIRaster
+//   UIRaster [--html ../sample.html --css ../somestyle.css] [--size WxH]
+//            [--golden ui_raster_golden.txt] [--write-golden file] [--ppm prefix]
+//
+// Renders the given document as scene "document", a built-in one with
+// rounded, uneven and oversized borders as "shapes" and one of covered and
+// off-screen cards as "stack".  Per scene it prints the instance count and
+// rasterized quad pixels against the two stacked rects per bordered element
+// drawn before, and a checksum of the 8 bit image.  Every scene is rendered
+// again through UICuller, which has to leave the image unchanged; its drawn
+// and culled counts are printed as well.  With a golden file the exit code is
+// 1 when a checksum changed; --ppm writes the images for a look.
+
+#include "YTML1_1.hpp"
+#include "UIInstance.h"
+#include "UICuller.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* ShapesCss = R"(
+.panel {
+	width: 300px;
+	height: 200px;
+	margin: 10 0 0 10;
+	border: 4 4 4 4;
+	border-radius: 16;
+	background-color: #303030;
+	border-color: #c0c0c0;
+}
+.pill {
+	width: 120px;
+	height: 24px;
+	margin: 8 0 0 8;
+	border: 1 1 1 1;
+	border-radius: 12;
+	background-color: #4080f0;
+	border-color: #ffffff;
+}
+.uneven {
+	width: 80px;
+	height: 60px;
+	margin: 8 0 0 8;
+	border: 6 3 0 1;
+	border-radius: 10;
+	background-color: #20a020;
+	border-color: #000000;
+}
+.dot {
+	width: 40px;
+	height: 40px;
+	margin: 8 0 0 8;
+	border-radius: 20;
+	background-color: #f0f040;
+}
+.thick {
+	width: 50px;
+	height: 30px;
+	margin: 8 0 0 8;
+	border: 30 30 30 30;
+	background-color: #ff0000;
+	border-color: #8020c0;
+}
+)";
+
+	const char* ShapesHtml = R"(
+<div class="panel">
+	<div class="pill"/>
+	<div class="uneven"/>
+	<div class="dot"/>
+	<div class="thick"/>
+</div>
+<div class="panel">
+	<div class="dot"/>
+	<div class="uneven"/>
+	<div class="pill"/>
+</div>
+)";
+
+	const char* StackCss = R"(
+.card {
+	width: 192px;
+	height: 144px;
+	background-color: #406080;
+}
+.cover {
+	width: 192px;
+	height: 144px;
+	border: 2 2 2 2;
+	background-color: #c06040;
+	border-color: #ffffff;
+}
+.rounded {
+	width: 192px;
+	height: 144px;
+	border: 2 2 2 2;
+	border-radius: 8;
+	background-color: #60c040;
+	border-color: #ffffff;
+}
+)";
+
+	// Square covers hide their cards, rounded ones leave the corners
+	// showing; the last card is off the right edge at 800 pixels.
+	const char* StackHtml = R"(
+<div class="card"><div class="cover"/></div>
+<div class="card"><div class="rounded"/></div>
+<div class="card"><div class="cover"/></div>
+<div class="card"><div class="rounded"/></div>
+<div class="card"><div class="cover"/></div>
+<div class="card"><div class="rounded"/></div>
+)";
+
+	bool ReadFile(const std::string& path, std::string& out)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) return false;
+		std::stringstream s;
+		s << file.rdbuf();
+		out = s.str();
+		return true;
+	}
+
+	struct Fnv
+	{
+		std::uint64_t Hash = 14695981039346656037ull;
+
+		void Add(const void* data, size_t size)
+		{
+			auto bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; ++i)
+			{
+				Hash ^= bytes[i];
+				Hash *= 1099511628211ull;
+			}
+		}
+	};
+
+	// Pixels whose centers lie in [x, x + w) x [y, y + h), the ones the
+	// rasterizer covers for a quad, within the target.
+	size_t QuadPixels(float x, float y, float w, float h, int width, int height)
+	{
+		auto span = [](float lo, float size, int limit)
+		{
+			const int a = std::max(0, (int)std::ceil(lo - 0.5f));
+			const int b = std::min(limit, (int)std::ceil(lo + size - 0.5f));
+			return (size_t)std::max(0, b - a);
+		};
+		if (w <= 0.f || h <= 0.f) return 0;
+		return span(x, w, width) * span(y, h, height);
+	}
+
+	struct Result
+	{
+		size_t Elements = 0, Bordered = 0;
+		size_t QuadPixelsBefore = 0, QuadPixelsNow = 0, Discarded = 0;
+		std::vector<unsigned char> Rgb;
+		std::uint64_t Checksum = 0;
+		UICullStats Cull;
+	};
+
+	// Without a culler every element is drawn.
+	Result Render(const std::string& html, const std::string& css, int width, int height, UICuller* culler)
+	{
+		// Same setup as BlendApp::BuildFrameResources and OnResize.
+		YTML1_1::Tree ui;
+		YTML1_1::StyleSheet style;
+		size_t uid = 1;
+		YTML1_1::ParseCSS(css, style);
+		YTML1_1::ParseYTML1_1(html, ui, style, uid);
+		ui->eid = 0;
+		ui->size = { (float)width, (float)height };
+		ui->flags = 0;
+
+		// BlendApp::UpdateObjectCBs, in emission order.
+		Result r;
+		std::vector<UIInstance> instances;
+		std::vector<std::uint32_t> drawOrder;
+		if (culler) culler->Begin();
+		YTML1_1::RunYTML1_1(ui, [&](YTML1_1::Element& e, bool&)
+			{
+				if (!(e.flags & ElementFlag::Enable)) return;
+
+				const auto& d = e.size_in_display;
+				UIInstance inst;
+				inst.Rect = { d.x, d.y, d.w, d.h };
+				inst.FillColor = PackUIColor(e.background_color);
+				inst.BorderColor = PackUIColor(e.border_color);
+				inst.BorderWidths = PackUIBorderWidths(e.border.left, e.border.top, e.border.right, e.border.bottom);
+				inst.CornerRadius = e.border_radius;
+				if (!culler || culler->Accept(inst)) instances.push_back(inst);
+
+				++r.Elements;
+				r.QuadPixelsBefore += QuadPixels(d.x, d.y, d.w, d.h, width, height);
+				if (inst.BorderWidths != 0)
+				{
+					++r.Bordered;
+					r.QuadPixelsBefore += QuadPixels(d.x + e.border.left, d.y + e.border.top,
+						d.w - e.border.left - e.border.right, d.h - e.border.top - e.border.bottom, width, height);
+				}
+			});
+
+		// Topmost first against a depth test, then alpha blended over the
+		// clear color like the UI PSO.
+		const DirectX::XMFLOAT4 clear = { 0.7f, 0.7f, 0.7f, 1.f };
+		std::vector<DirectX::XMFLOAT4> image((size_t)width * height, clear);
+		std::vector<bool> depth((size_t)width * height, false);
+		if (culler)
+		{
+			culler->Finish(instances, drawOrder);
+			r.Cull = culler->Stats();
+		}
+		else
+		{
+			for (size_t i = instances.size(); i-- > 0;) drawOrder.push_back((std::uint32_t)i);
+			r.Cull.Emitted = drawOrder.size();
+		}
+		for (std::uint32_t index : drawOrder)
+		{
+			const UIInstance& inst = instances[index];
+			const auto& rect = inst.Rect;
+			if (rect.z <= 0.f || rect.w <= 0.f) continue;
+
+			const int x0 = std::max(0, (int)std::ceil(rect.x - 0.5f)), x1 = std::min(width, (int)std::ceil(rect.x + rect.z - 0.5f));
+			const int y0 = std::max(0, (int)std::ceil(rect.y - 0.5f)), y1 = std::min(height, (int)std::ceil(rect.y + rect.w - 0.5f));
+			r.QuadPixelsNow += (size_t)std::max(0, x1 - x0) * std::max(0, y1 - y0);
+			for (int y = y0; y < y1; ++y)
+			{
+				for (int x = x0; x < x1; ++x)
+				{
+					const size_t p = (size_t)y * width + x;
+					if (depth[p]) continue;
+
+					DirectX::XMFLOAT4 c;
+					if (!ShadeUIInstance(inst, x + 0.5f, y + 0.5f, c))
+					{
+						++r.Discarded;
+						continue;
+					}
+					auto& dst = image[p];
+					dst = { c.x * c.w + dst.x * (1.f - c.w), c.y * c.w + dst.y * (1.f - c.w), c.z * c.w + dst.z * (1.f - c.w), dst.w };
+					depth[p] = true;
+				}
+			}
+		}
+
+		r.Rgb.reserve(image.size() * 3);
+		for (const auto& c : image)
+		{
+			for (float v : { c.x, c.y, c.z })
+				r.Rgb.push_back((unsigned char)(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f));
+		}
+		Fnv hash;
+		hash.Add(r.Rgb.data(), r.Rgb.size());
+		r.Checksum = hash.Hash;
+		return r;
+	}
+
+	bool WritePpm(const std::string& path, const std::vector<unsigned char>& rgb, int width, int height)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) return false;
+		file << "P6\n" << width << " " << height << "\n255\n";
+		file.write((const char*)rgb.data(), rgb.size());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string htmlPath = "../sample.html", cssPath = "../somestyle.css";
+	std::string goldenPath, writeGoldenPath, ppmPrefix;
+	int width = 800, height = 600;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		if (arg == "--html") htmlPath = argv[a + 1];
+		else if (arg == "--css") cssPath = argv[a + 1];
+		else if (arg == "--golden") goldenPath = argv[a + 1];
+		else if (arg == "--write-golden") writeGoldenPath = argv[a + 1];
+		else if (arg == "--ppm") ppmPrefix = argv[a + 1];
+		else if (arg == "--size")
+		{
+			if (std::sscanf(argv[a + 1], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+			{
+				std::fprintf(stderr, "bad size %s\n", argv[a + 1]);
+				return 2;
+			}
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::string html, css;
+	if (!ReadFile(cssPath, css) || !ReadFile(htmlPath, html))
+	{
+		std::fprintf(stderr, "cannot read %s or %s\n", cssPath.c_str(), htmlPath.c_str());
+		return 2;
+	}
+
+	std::map<std::string, std::uint64_t> golden;
+	if (!goldenPath.empty())
+	{
+		std::ifstream file(goldenPath);
+		if (!file.is_open())
+		{
+			std::fprintf(stderr, "cannot read %s\n", goldenPath.c_str());
+			return 2;
+		}
+		std::string line;
+		while (std::getline(file, line))
+		{
+			char name[64];
+			unsigned long long checksum;
+			if (line.empty() || line[0] == '#') continue;
+			if (std::sscanf(line.c_str(), "%63s %llx", name, &checksum) == 2) golden[name] = checksum;
+		}
+	}
+
+	struct Scene { const char* Name; std::string Html, Css; };
+	const Scene scenes[] = { { "document", html, css }, { "shapes", ShapesHtml, ShapesCss }, { "stack", StackHtml, StackCss } };
+
+	UICuller culler;
+	culler.SetViewport((float)width, (float)height);
+
+	std::printf("%dx%d\n", width, height);
+	std::printf("%-10s %8s %16s %22s %10s %17s   %s\n", "scene", "elements", "instances", "quad pixels", "discarded", "checksum",
+		"culled: drawn offscreen invisible occluded");
+
+	bool ok = true;
+	std::ostringstream newGolden;
+	newGolden << "# scene checksum of the " << width << "x" << height << " image\n";
+	for (const auto& scene : scenes)
+	{
+		const Result r = Render(scene.Html, scene.Css, width, height, nullptr);
+		const Result c = Render(scene.Html, scene.Css, width, height, &culler);
+		std::printf("%-10s %8zu %7zu -> %6zu %10zu -> %9zu %10zu %016llx   %5zu %9zu %9zu %8zu %s",
+			scene.Name, r.Elements, r.Elements + r.Bordered, r.Elements,
+			r.QuadPixelsBefore, r.QuadPixelsNow, r.Discarded, (unsigned long long)r.Checksum,
+			c.Cull.Emitted, c.Cull.Offscreen, c.Cull.Invisible, c.Cull.Occluded,
+			c.Checksum == r.Checksum ? "same" : "DIFFERENT");
+		ok &= c.Checksum == r.Checksum;
+
+		if (!goldenPath.empty())
+		{
+			auto it = golden.find(scene.Name);
+			const bool match = it != golden.end() && it->second == r.Checksum;
+			std::printf("  %s", match ? "ok" : "CHANGED");
+			ok &= match;
+		}
+		std::printf("\n");
+
+		char line[96];
+		std::snprintf(line, sizeof(line), "%s %016llx\n", scene.Name, (unsigned long long)r.Checksum);
+		newGolden << line;
+
+		if (!ppmPrefix.empty() && !WritePpm(ppmPrefix + scene.Name + ".ppm", r.Rgb, width, height))
+		{
+			std::fprintf(stderr, "cannot write %s%s.ppm\n", ppmPrefix.c_str(), scene.Name);
+			return 2;
+		}
+	}
+
+	if (!writeGoldenPath.empty())
+	{
+		std::ofstream file(writeGoldenPath);
+		file << newGolden.str();
+		if (!file)
+		{
+			std::fprintf(stderr, "cannot write %s\n", writeGoldenPath.c_str());
+			return 2;
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+// Hot reload benchmark: small edits to a document and its stylesheet, like a
+// save in an editor, are applied to a live tree through ReloadYTML1_1 and
+// ReloadCSS, the path BlendApp takes when FileWatcher reports a change.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIReloadBench.cpp -o UIReloadBench
+//   UIReloadBench [--depth D] [--fanout F] [--edits N]
+//
+// Edits are: an element's class changed, a leaf inserted, a leaf removed and
+// a rule's declarations changed.  After every reload the live tree is
+// compared with a clean parse of the edited files, and the nodes the edit did
+// not touch have to have kept their eid; the exit code is 1 otherwise.
+// Reports per edit kind the microseconds of the reparse and of the patch and
+// restyle, and the elements restyled.
+
+#include "YTML1_1.hpp"
+#include "YTMLPatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const int Classes = 32;
+
+	double Microseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	struct Line
+	{
+		std::string Text;
+		bool Leaf = false;
+	};
+
+	void AppendElement(std::vector<Line>& lines, std::mt19937& rng, int depth, int maxDepth, int fanout)
+	{
+		std::uniform_int_distribution<int> cls(0, Classes - 1);
+		std::string open = "<div class=\"c" + std::to_string(cls(rng)) + "\"";
+		if (depth == maxDepth)
+		{
+			lines.push_back({ open + "/>", true });
+			return;
+		}
+		lines.push_back({ open + ">", false });
+		for (int i = 0; i < fanout; ++i) AppendElement(lines, rng, depth + 1, maxDepth, fanout);
+		lines.push_back({ "</div>", false });
+	}
+
+	std::string Join(const std::vector<Line>& lines)
+	{
+		std::string s;
+		for (const auto& l : lines) s.append(l.Text).append("\n");
+		return s;
+	}
+
+	std::string Rule(int k, int width, int color)
+	{
+		std::ostringstream s;
+		if (k % 3 == 0) s << ".c" << k % Classes << " {\n";
+		else if (k % 3 == 1) s << ".c" << (k * 7) % Classes << " > .c" << k % Classes << " {\n";
+		else s << ".c" << (k * 5) % Classes << " .c" << k % Classes << " {\n";
+		s << "\twidth: " << width << "px;\n\tbackground-color: #" << std::hex << std::setw(6) << std::setfill('0') << color << std::dec << ";\n}\n";
+		return s.str();
+	}
+
+	// Structure, markup and computed style.
+	bool SameTree(YTML1_1::Tree& a, YTML1_1::Tree& b)
+	{
+		const auto& x = a.value;
+		const auto& y = b.value;
+		if (a.child.size() != b.child.size() || x.head != y.head || x.attributes != y.attributes || !(x.lengths == y.lengths) ||
+			std::memcmp(&x.background_color, &y.background_color, sizeof(x.background_color)) != 0)
+			return false;
+		for (size_t i = 0; i < a.child.size(); ++i)
+			if (!SameTree(*a.child[i], *b.child[i])) return false;
+		return true;
+	}
+
+	void CollectIds(YTML1_1::Tree& t, std::vector<size_t>& ids)
+	{
+		for (auto* c : t.child)
+		{
+			ids.push_back(c->value.eid);
+			CollectIds(*c, ids);
+		}
+	}
+
+	struct Totals
+	{
+		int Count = 0;
+		double ParseUs = 0.0;
+		double PatchUs = 0.0;
+		size_t Restyled = 0;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	int depth = 4, fanout = 8, edits = 40;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--depth") depth = std::max(2, value);
+		else if (arg == "--fanout") fanout = std::max(1, value);
+		else if (arg == "--edits") edits = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::mt19937 rng(31);
+	std::uniform_int_distribution<int> px(4, 200), color(0, 0xffffff), cls(0, Classes - 1);
+
+	std::vector<std::string> rules;
+	for (int k = 0; k < 3 * Classes; ++k) rules.push_back(Rule(k, px(rng), color(rng)));
+	auto joinRules = [&]()
+	{
+		std::string s;
+		for (const auto& r : rules) s += r;
+		return s;
+	};
+
+	std::vector<Line> lines;
+	for (int i = 0; i < fanout; ++i) AppendElement(lines, rng, 1, depth, fanout);
+
+	YTML1_1::StyleSheet sheet;
+	YTML1_1::ParseCSS(joinRules(), sheet);
+	YTML1_1::Tree live;
+	size_t biggest = 1;
+	YTML1_1::ParseYTML1_1(Join(lines), live, sheet, biggest);
+	YTML1_1::StyleInvalidator invalidator(sheet);
+
+	const char* kinds[] = { "class", "insert", "remove", "rule" };
+	Totals totals[4];
+	std::vector<size_t> before, after;
+	bool ok = true;
+	for (int n = 0; n < edits * 4 && ok; ++n)
+	{
+		const int kind = n % 4;
+		Totals& t = totals[kind];
+		CollectIds(live, before);
+
+		auto start = Clock::now();
+		double parseUs = 0.0;
+		size_t expectedKept = before.size();
+		if (kind == 3)
+		{
+			rules[std::uniform_int_distribution<size_t>(0, rules.size() - 1)(rng)] = Rule(cls(rng) * 3, px(rng), color(rng));
+			const std::string css = joinRules();
+			start = Clock::now();
+			YTML1_1::ReloadCSS(css, sheet, live, invalidator);
+		}
+		else
+		{
+			std::uniform_int_distribution<size_t> pick(0, lines.size() - 1);
+			size_t i = pick(rng);
+			if (kind == 0)
+			{
+				while (lines[i].Text == "</div>") i = pick(rng);
+				auto& text = lines[i].Text;
+				text.replace(text.find("\"c") + 2, text.find('"', text.find("\"c") + 1) - text.find("\"c") - 2, std::to_string(cls(rng)));
+			}
+			else if (kind == 1)
+			{
+				lines.insert(lines.begin() + i, { "<div class=\"c" + std::to_string(cls(rng)) + "\"/>", true });
+			}
+			else
+			{
+				while (!lines[i].Leaf) i = pick(rng);
+				lines.erase(lines.begin() + i);
+				expectedKept -= 1;
+			}
+			const std::string html = Join(lines);
+			start = Clock::now();
+			YTML1_1::ReloadYTML1_1(html, live, invalidator, biggest);
+		}
+		invalidator.Flush();
+		const double us = Microseconds(start);
+
+		// The reparse on its own, to split the time.
+		if (kind != 3)
+		{
+			const std::string html = Join(lines);
+			const YTML1_1::StyleSheet unstyled;
+			YTML1_1::Tree fresh;
+			size_t id = 1;
+			auto parseStart = Clock::now();
+			YTML1_1::ParseYTML1_1(html, fresh, unstyled, id);
+			parseUs = Microseconds(parseStart);
+		}
+
+		++t.Count;
+		t.ParseUs += parseUs;
+		t.PatchUs += std::max(0.0, us - parseUs);
+		t.Restyled += invalidator.Stats().restyled;
+
+		YTML1_1::Tree clean;
+		size_t id = 1;
+		YTML1_1::ParseYTML1_1(Join(lines), clean, sheet, id);
+		if (!SameTree(live, clean))
+		{
+			std::fprintf(stderr, "%s edit %d: the patched tree differs from a clean parse\n", kinds[kind], n);
+			ok = false;
+		}
+
+		// Every old eid still there, but the removed one.
+		after.clear();
+		CollectIds(live, after);
+		std::sort(before.begin(), before.end());
+		std::sort(after.begin(), after.end());
+		std::vector<size_t> kept;
+		std::set_intersection(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(kept));
+		if (kept.size() != expectedKept)
+		{
+			std::fprintf(stderr, "%s edit %d: %zu of %zu nodes kept their eid\n", kinds[kind], n, kept.size(), expectedKept);
+			ok = false;
+		}
+		before.clear();
+	}
+
+	std::printf("%zu elements, %zu rules, %d edits of each kind\n", after.size(), sheet.Rules().size(), edits);
+	std::printf("%-8s %12s %12s %16s\n", "edit", "reparse us", "patch us", "restyled/edit");
+	for (int k = 0; k < 4; ++k)
+	{
+		const Totals& t = totals[k];
+		std::printf("%-8s %12.1f %12.1f %16.1f\n", kinds[k], t.ParseUs / t.Count, t.PatchUs / t.Count, (double)t.Restyled / t.Count);
+	}
+
+	// What a reload cost before: a styled parse of the whole document.
+	YTML1_1::Tree full;
+	size_t id = 1;
+	auto start = Clock::now();
+	YTML1_1::ParseYTML1_1(Join(lines), full, sheet, id);
+	std::printf("full styled parse %.1f us\n", Microseconds(start));
+	std::printf("%s\n", ok ? "trees match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
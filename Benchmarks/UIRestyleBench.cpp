@@ -0,0 +1,189 @@
+// Incremental restyle benchmark: per frame a few elements gain or lose a
+// class or get a new style attribute, like hover and selection feedback, and
+// the document is restyled through StyleInvalidator, once incrementally and
+// once in full.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIRestyleBench.cpp -o UIRestyleBench
+//   UIRestyleBench [--depth D] [--fanout F] [--rules R] [--mutations M] [--frames N]
+//
+// The stylesheet has one rule per class plus R rules with descendant and
+// child combinators.  Every frame the incremental result is compared with a
+// full restyle of the same tree; the exit code is 1 on a mismatch.  Reports
+// elements restyled and microseconds per frame.
+
+#include "YTML1_1.hpp"
+#include "YTMLRestyle.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const int Classes = 32;
+
+	double Microseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	void AppendElement(std::ostringstream& s, std::mt19937& rng, int depth, int maxDepth, int fanout)
+	{
+		std::uniform_int_distribution<int> cls(0, Classes - 1);
+		s << "<div class=\"c" << cls(rng) << "\"";
+		if (depth == maxDepth)
+		{
+			s << "/>\n";
+			return;
+		}
+		s << ">\n";
+		for (int i = 0; i < fanout; ++i) AppendElement(s, rng, depth + 1, maxDepth, fanout);
+		s << "</div>\n";
+	}
+
+	// The computed style of every element, in tree order.  Lengths as
+	// written; layout resolves them.
+	void Snapshot(YTML1_1::Tree& tree, std::vector<float>& out)
+	{
+		out.clear();
+		YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e)
+			{
+				const auto& l = e.lengths;
+				const YTML1_1::Length* lengths[] = {
+					&l.width, &l.height, &l.margin.top, &l.margin.right, &l.margin.bottom, &l.margin.left,
+					&l.border.top, &l.border.right, &l.border.bottom, &l.border.left, &l.border_radius, &l.font_size };
+				for (const auto* length : lengths)
+				{
+					out.push_back(length->value);
+					out.push_back((float)length->unit);
+				}
+				const float values[] = {
+					e.background_color.x, e.background_color.y, e.background_color.z,
+					e.border_color.x, e.border_color.y, e.border_color.z,
+					(float)(e.flags & ~ElementFlag::LayoutDirty) };
+				out.insert(out.end(), std::begin(values), std::end(values));
+			}, tree);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int depth = 5, fanout = 6, rules = 200, mutations = 8, frames = 200;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--depth") depth = std::max(1, value);
+		else if (arg == "--fanout") fanout = std::max(1, value);
+		else if (arg == "--rules") rules = std::max(0, value);
+		else if (arg == "--mutations") mutations = std::max(0, value);
+		else if (arg == "--frames") frames = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::mt19937 rng(21);
+	std::uniform_int_distribution<int> cls(0, Classes - 1), px(4, 200);
+
+	std::ostringstream css;
+	for (int k = 0; k < Classes; ++k)
+		css << ".c" << k << " {\n\twidth: " << px(rng) << "px;\n\tbackground-color: #" << std::hex << std::setw(6) << std::setfill('0') << px(rng) * 999 << std::dec << ";\n}\n";
+	// Hover-like classes, h0..h7, that only appear in combinators.
+	for (int k = 0; k < rules; ++k)
+	{
+		const int a = cls(rng), b = cls(rng), h = k % 8;
+		switch (k % 4)
+		{
+		case 0: css << ".h" << h << " .c" << a; break;
+		case 1: css << ".h" << h << " > .c" << a; break;
+		case 2: css << ".c" << a << ".h" << h; break;
+		case 3: css << ".c" << b << " > .c" << a; break;
+		}
+		css << " {\n\theight: " << px(rng) << "px;\n\tmargin: 1 2 3 4;\n}\n";
+	}
+
+	std::ostringstream html;
+	for (int i = 0; i < fanout; ++i) AppendElement(html, rng, 1, depth, fanout);
+
+	YTML1_1::StyleSheet sheet;
+	YTML1_1::ParseCSS(css.str(), sheet);
+	YTML1_1::Tree ui;
+	ui->eid = 0;
+	ui->flags = 0;
+	size_t uid = 1;
+	YTML1_1::ParseYTML1_1(html.str(), ui, sheet, uid);
+
+	std::vector<YTML1_1::Tree*> nodes;
+	std::vector<YTML1_1::Tree*> stack = { &ui };
+	while (!stack.empty())
+	{
+		YTML1_1::Tree* t = stack.back();
+		stack.pop_back();
+		if (t != &ui) nodes.push_back(t);
+		stack.insert(stack.end(), t->child.begin(), t->child.end());
+	}
+	std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+	std::uniform_int_distribution<int> hover(0, 7), kind(0, 3);
+
+	YTML1_1::StyleInvalidator invalidator(sheet);
+	std::vector<float> incremental, full;
+	double incrementalUs = 0.0, fullUs = 0.0;
+	size_t restyled = 0, layoutDirty = 0;
+	bool ok = true;
+	for (int f = 0; f < frames && ok; ++f)
+	{
+		for (int m = 0; m < mutations; ++m)
+		{
+			YTML1_1::Tree& node = *nodes[pick(rng)];
+			const std::string h = "h" + std::to_string(hover(rng));
+			switch (kind(rng))
+			{
+			case 0: invalidator.AddClass(node, h); break;
+			case 1: invalidator.RemoveClass(node, h); break;
+			case 2: invalidator.SetStyle(node, "height: " + std::to_string(px(rng)) + "px;"); break;
+			case 3: invalidator.AddClass(node, "c" + std::to_string(cls(rng))); break;
+			}
+		}
+
+		auto start = Clock::now();
+		invalidator.Flush();
+		incrementalUs += Microseconds(start);
+		restyled += invalidator.Stats().restyled;
+		layoutDirty += invalidator.Stats().layoutDirty;
+		Snapshot(ui, incremental);
+
+		start = Clock::now();
+		invalidator.InvalidateTree(ui);
+		invalidator.Flush();
+		fullUs += Microseconds(start);
+		Snapshot(ui, full);
+
+		if (incremental != full)
+		{
+			std::fprintf(stderr, "frame %d: incremental restyle differs from a full one\n", f);
+			ok = false;
+		}
+	}
+
+	std::printf("%zu elements, %zu rules, %d mutations per frame, %d frames\n",
+		nodes.size(), sheet.Rules().size(), mutations, frames);
+	std::printf("%-12s %14s %12s\n", "restyle", "elements/frame", "us/frame");
+	std::printf("%-12s %14.1f %12.1f\n", "incremental", (double)restyled / frames, incrementalUs / frames);
+	std::printf("%-12s %14zu %12.1f\n", "full", nodes.size(), fullUs / frames);
+	std::printf("layout dirty %.1f elements/frame\n", (double)layoutDirty / frames);
+	std::printf("%s\n", ok ? "styles match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
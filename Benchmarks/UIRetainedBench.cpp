@@ -0,0 +1,174 @@
+// Retained UI instance buffer benchmark: per frame a few elements change
+// color and a few disappear or come back, like hover and click feedback, and
+// the UI upload of BlendApp::UpdateObjectCBs is done the old way (every
+// instance every frame) and through UIRetainedBuffer.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIRetainedBench.cpp ../UIRetainedBuffer.cpp -o UIRetainedBench
+//   UIRetainedBench [--elements N] [--changes K] [--toggles T] [--frames F] [--copies C]
+//
+// The frame resources are simulated as C plain copies used round robin.
+// After every sync the copy's draw list is resolved against its instances and
+// compared with a full emission of the same frame; the exit code is 1 on a
+// mismatch.  Reports bytes uploaded and microseconds per frame.
+
+#include "YTML1_1.hpp"
+#include "UIRetainedBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double Microseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	UIInstance MakeInstance(const YTML1_1::Element& e)
+	{
+		UIInstance inst;
+		const auto& d = e.size_in_display;
+		inst.Rect = { d.x, d.y, d.w, d.h };
+		inst.FillColor = PackUIColor(e.background_color);
+		inst.BorderColor = PackUIColor(e.border_color);
+		inst.BorderWidths = PackUIBorderWidths(e.border.left, e.border.top, e.border.right, e.border.bottom);
+		inst.CornerRadius = e.border_radius;
+		return inst;
+	}
+
+	struct Copy
+	{
+		std::vector<UIInstance> Instances;
+		std::vector<std::uint32_t> DrawList;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	int elements = 4000, changes = 4, toggles = 2, frames = 600, copies = 3;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--elements") elements = std::max(1, value);
+		else if (arg == "--changes") changes = std::max(0, value);
+		else if (arg == "--toggles") toggles = std::max(0, value);
+		else if (arg == "--frames") frames = std::max(1, value);
+		else if (arg == "--copies") copies = std::min(std::max(1, value), UIRetainedBuffer::MaxCopies);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::ostringstream html;
+	for (int i = 0; i < elements; ++i)
+		html << "<div style=\"width: 24px; height: 16px; margin: 2 0 0 2; border: 1 1 1 1; background-color: #"
+			<< std::hex << std::setw(6) << std::setfill('0') << (0x102030 + i * 77) % 0xffffff << std::dec << ";\"/>\n";
+
+	YTML1_1::Tree ui;
+	YTML1_1::StyleSheet style;
+	size_t uid = 1;
+	YTML1_1::ParseYTML1_1(html.str(), ui, style, uid);
+	ui->eid = 0;
+	ui->size = { 1920.f, 1080.f };
+	ui->flags = 0;
+
+	std::vector<YTML1_1::Element*> nodes;
+	for (auto* child : ui.child) nodes.push_back(&child->value);
+
+	const std::uint32_t capacity = 32767;
+	UIRetainedBuffer retained(capacity, copies);
+	std::vector<Copy> gpu(copies);
+	for (auto& c : gpu) c.Instances.resize(capacity);
+
+	std::mt19937 rng(11);
+	std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+	std::uniform_int_distribution<std::uint32_t> color(0, 0xffffff);
+
+	std::vector<UIInstance> full, fullTarget(capacity), resolved;
+	std::vector<std::uint32_t> slots, drawList;
+	double fullUs = 0.0, retainedUs = 0.0;
+	size_t fullBytes = 0, retainedBytes = 0, moved = 0, freed = 0;
+	bool ok = true;
+	for (int f = 0; f < frames; ++f)
+	{
+		// Edits between frames.
+		for (int k = 0; k < changes; ++k)
+		{
+			const std::uint32_t c = color(rng);
+			nodes[pick(rng)]->background_color = { (c & 0xff) / 255.f, (c >> 8 & 0xff) / 255.f, (c >> 16) / 255.f, 1.f };
+		}
+		for (int k = 0; k < toggles; ++k) nodes[pick(rng)]->flags ^= ElementFlag::Enable;
+
+		// Old: every instance to the upload buffer, topmost first.
+		auto start = Clock::now();
+		full.clear();
+		YTML1_1::RunYTML1_1(ui, [&](YTML1_1::Element& e, bool&)
+			{
+				if (e.flags & ElementFlag::Enable) full.push_back(MakeInstance(e));
+			});
+		for (size_t i = 0; i < full.size(); ++i) fullTarget[full.size() - 1 - i] = full[i];
+		fullUs += Microseconds(start);
+		fullBytes += full.size() * sizeof(UIInstance);
+
+		// Retained: diff, then sync the copy of this frame.
+		start = Clock::now();
+		retained.BeginFrame();
+		slots.clear();
+		YTML1_1::RunYTML1_1(ui, [&](YTML1_1::Element& e, bool&)
+			{
+				if (!(e.flags & ElementFlag::Enable)) return;
+				const std::uint32_t slot = retained.Update(e.eid, MakeInstance(e));
+				if (slot != UIRetainedBuffer::InvalidSlot) slots.push_back(slot);
+			});
+		retained.EndFrame();
+		drawList.assign(slots.rbegin(), slots.rend());
+		retained.SetDrawList(drawList);
+
+		Copy& copy = gpu[f % copies];
+		size_t bytes = sizeof(UIInstance) * retained.Sync(f % copies, [&](std::uint32_t first, const UIInstance* data, size_t count)
+			{
+				std::memcpy(&copy.Instances[first], data, count * sizeof(UIInstance));
+			});
+		bytes += sizeof(std::uint32_t) * retained.SyncDrawList(f % copies, [&](const std::uint32_t* list, size_t count)
+			{
+				copy.DrawList.assign(list, list + count);
+			});
+		retainedUs += Microseconds(start);
+		retainedBytes += bytes;
+		moved += retained.Stats().Moved;
+		freed += retained.Stats().Freed;
+
+		// What the GPU would draw from the copy against the full emission.
+		resolved.clear();
+		for (std::uint32_t slot : copy.DrawList) resolved.push_back(copy.Instances[slot]);
+		if (resolved.size() != full.size() ||
+			std::memcmp(resolved.data(), fullTarget.data(), full.size() * sizeof(UIInstance)) != 0)
+		{
+			std::fprintf(stderr, "frame %d: copy %d differs from the full emission\n", f, f % copies);
+			ok = false;
+			break;
+		}
+	}
+
+	std::printf("%d elements, %d color changes and %d toggles per frame, %d frames, %d copies\n",
+		elements, changes, toggles, frames, copies);
+	std::printf("%-10s %14s %12s\n", "path", "bytes/frame", "us/frame");
+	std::printf("%-10s %14.0f %12.1f\n", "full", (double)fullBytes / frames, fullUs / frames);
+	std::printf("%-10s %14.0f %12.1f\n", "retained", (double)retainedBytes / frames, retainedUs / frames);
+	std::printf("live %zu, span %zu, freed %zu, moved %zu\n",
+		retained.Stats().Live, retained.Stats().Span, freed, moved);
+	std::printf("%s\n", ok ? "copies match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Benchmark of scrolling a pane by its scroll offset against scrolling it by
+// relayout: a pane holding a tall flex column of rows, each a label and an
+// icon.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIScrollBench.cpp -o UIScrollBench
+//   UIScrollBench [--rows R] [--frames F]
+//
+// Scrolls the pane by Element::scroll and emits the tree with EmitYTML1_1,
+// then scrolls it the way it had to be done before, by a negative margin on
+// the column and RunYTML1_1.  Every scroll position has to show the same
+// rects both ways, give the same HitTest results, and agree with
+// DisplayRect, also with a translate on the column; the exit code is 1
+// otherwise.  Reports ns/frame both ways.
+
+#include "YTML1_1.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::string Pane(int rows)
+	{
+		std::ostringstream s;
+		s << "<div class=\"pane\"><div class=\"column\" style=\"height: " << rows * 24 << "px;\">\n";
+		for (int r = 0; r < rows; ++r) s << "<div class=\"row" << (r % 2 ? " odd" : "") << "\"><div class=\"label\"/><div class=\"icon\"/></div>\n";
+		s << "</div></div>\n";
+		return s.str();
+	}
+
+	const char* Css =
+		".pane { width: 100%; height: 100%; border: 1; }\n"
+		".column { display: flex; flex-direction: column; }\n"
+		".row { display: flex; height: 24px; column-gap: 4px; align-items: center; }\n"
+		".row.odd { background-color: #f4f4f4; }\n"
+		".label { flex: 1; height: 1em; margin: 0 4 0 4; }\n"
+		".icon { width: 1em; height: 1em; border-radius: 50%; }\n";
+
+	void Emitted(YTML1_1::Tree& tree, std::vector<YTML1_1::FloatRect>& out)
+	{
+		out.clear();
+		YTML1_1::EmitYTML1_1(tree, [&](YTML1_1::Element&, const YTML1_1::FloatRect& r, bool&) { out.push_back(r); });
+	}
+
+	void Laid(YTML1_1::Tree& tree, std::vector<YTML1_1::FloatRect>& out)
+	{
+		out.clear();
+		YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e) { out.push_back(e.size_in_display); }, tree);
+	}
+
+	// Far down the column, adding the offset before or after the positions
+	// rounds differently; a sixteenth of a pixel is well within it.
+	bool Near(const std::vector<YTML1_1::FloatRect>& a, const std::vector<YTML1_1::FloatRect>& b)
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+			if (std::fabs(a[i].x - b[i].x) > 0.0625f || std::fabs(a[i].y - b[i].y) > 0.0625f || a[i].w != b[i].w || a[i].h != b[i].h) return false;
+		return true;
+	}
+
+	void SetMargin(YTML1_1::Tree& column, float top)
+	{
+		column->tuple["margin"] = std::to_string(top) + "px 0 0 0";
+		column->tupleChanged("margin");
+		column->flags |= ElementFlag::LayoutDirty;
+	}
+
+	const YTML1_1::Tree* Find(const YTML1_1::Tree& node, const YTML1_1::Element* e)
+	{
+		if (&node.value == e) return &node;
+		for (const YTML1_1::Tree* c : node.child)
+			if (const YTML1_1::Tree* found = Find(*c, e)) return found;
+		return nullptr;
+	}
+
+	// Points in the middle of rows, away from every edge, at the scroll
+	// positions checked.
+	std::vector<size_t> Hits(YTML1_1::Tree& tree)
+	{
+		std::vector<size_t> out;
+		for (float x : { 3.f, 20.f, 400.f, 1270.f })
+			for (float y = 10.f; y < 720.f; y += 48.f)
+			{
+				const YTML1_1::Element* hit = YTML1_1::HitTest(tree, x, y);
+				out.push_back(hit ? hit->eid : 0);
+			}
+		return out;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int rows = 20000, frames = 100;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--rows") rows = std::max(40, value);
+		else if (arg == "--frames") frames = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	YTML1_1::StyleSheet sheet;
+	YTML1_1::ParseCSS(Css, sheet);
+	YTML1_1::Tree tree;
+	size_t id = 1;
+	YTML1_1::ParseYTML1_1(Pane(rows), tree, sheet, id);
+	tree->eid = 0;
+	tree->flags = 0;
+	tree->size = { 1280.f, 720.f };
+	YTML1_1::Tree& pane = *tree.child[0];
+	YTML1_1::Tree& column = *pane.child[0];
+	static const std::function<void(YTML1_1::Element&, bool&)> nop = [](YTML1_1::Element&, bool&) {};
+	YTML1_1::RunYTML1_1(tree, nop);
+	const size_t elements = id;
+
+	bool ok = true;
+	std::vector<YTML1_1::FloatRect> offset, relaid;
+	const float end = rows * 24.f - 720.f;
+	for (float s : { 0.f, 5.f, 24.f * 100 + 5.f, end / 2.f - std::fmod(end / 2.f, 24.f) + 5.f, end - 19.f })
+	{
+		pane->scroll.y = s;
+		Emitted(tree, offset);
+		const std::vector<size_t> offsetHits = Hits(tree);
+
+		pane->scroll.y = 0.f;
+		SetMargin(column, -s);
+		YTML1_1::RunYTML1_1(tree, nop);
+		Laid(tree, relaid);
+		const std::vector<size_t> relaidHits = Hits(tree);
+		SetMargin(column, 0.f);
+		YTML1_1::RunYTML1_1(tree, nop);
+
+		if (!Near(offset, relaid))
+		{
+			std::fprintf(stderr, "scroll %.1f: rects differ from relayout\n", s);
+			ok = false;
+		}
+		if (offsetHits != relaidHits)
+		{
+			std::fprintf(stderr, "scroll %.1f: hits differ from relayout\n", s);
+			ok = false;
+		}
+	}
+
+	// DisplayRect, which walks up, agrees with EmitYTML1_1, which walks down.
+	pane->scroll = { 7.f, 24.f * 50 + 3.f };
+	column->translate = { 13.f, -5.f };
+	{
+		Emitted(tree, offset);
+		std::vector<YTML1_1::FloatRect> display;
+		std::function<void(YTML1_1::Tree&)> walk = [&](YTML1_1::Tree& node)
+		{
+			display.push_back(YTML1_1::DisplayRect(node));
+			for (YTML1_1::Tree* c : node.child) walk(*c);
+		};
+		walk(tree);
+		if (!Near(offset, display))
+		{
+			std::fprintf(stderr, "DisplayRect differs from EmitYTML1_1\n");
+			ok = false;
+		}
+		const YTML1_1::Element* hit = YTML1_1::HitTest(tree, 30.f, 30.f);
+		const YTML1_1::Tree* node = hit ? Find(tree, hit) : nullptr;
+		const YTML1_1::FloatRect r = node ? YTML1_1::DisplayRect(*node) : YTML1_1::FloatRect();
+		if (!node || hit == &pane.value || hit == &column.value || !(30.f >= r.x && 30.f <= r.x + r.w && 30.f >= r.y && 30.f <= r.y + r.h))
+		{
+			std::fprintf(stderr, "HitTest missed the row under a translated column\n");
+			ok = false;
+		}
+	}
+	pane->scroll = { 0.f, 0.f };
+	column->translate = { 0.f, 0.f };
+
+	volatile size_t sink = 0;
+	auto emit = [&](YTML1_1::Element& e, const YTML1_1::FloatRect& r, bool&) { sink += (size_t)r.y + e.eid; };
+	const auto offsetStart = Clock::now();
+	for (int f = 0; f < frames; ++f)
+	{
+		pane->scroll.y = (float)(f * 37 % (int)end);
+		YTML1_1::EmitYTML1_1(tree, emit);
+	}
+	const double offsetNs = std::chrono::duration<double, std::nano>(Clock::now() - offsetStart).count() / frames;
+
+	const auto relayoutStart = Clock::now();
+	pane->scroll.y = 0.f;
+	for (int f = 0; f < frames; ++f)
+	{
+		SetMargin(column, -(float)(f * 37 % (int)end));
+		YTML1_1::RunYTML1_1(tree, [&](YTML1_1::Element& e, bool&) { sink += (size_t)e.size_in_display.y + e.eid; });
+	}
+	const double relayoutNs = std::chrono::duration<double, std::nano>(Clock::now() - relayoutStart).count() / frames;
+
+	std::printf("%zu elements, %d rows\n", elements, rows);
+	std::printf("%-10s %12s %10s\n", "scroll by", "ns/frame", "ns/elem");
+	std::printf("%-10s %12.0f %10.1f\n", "offset", offsetNs, offsetNs / elements);
+	std::printf("%-10s %12.0f %10.1f\n", "relayout", relayoutNs, relayoutNs / elements);
+	std::printf("%s\n", ok ? "scrolls match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
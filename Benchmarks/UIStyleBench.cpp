@@ -0,0 +1,207 @@
+// Scaling benchmark of StyleYTML1_1Parallel against StyleYTML1_1 on a log
+// viewer: a toolbar and a table of rows, each with its own id, of cells
+// holding a label and an icon, with the odd rows, some inline styles and some
+// ids the stylesheet mentions thrown in.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. -I<DirectXMath>/Inc UIStyleBench.cpp ../JobSystem.cpp ../Common/Profiler.cpp -o UIStyleBench
+//   UIStyleBench [--rows R] [--columns C] [--grain G] [--threads T] [--reps N]
+//
+// Styles the table with a StyleMatcher alone, as StyleInvalidator restyles,
+// then with the style pass of ParseYTML1_1, then in parallel with 1, 2, 4 ...
+// up to T threads (the hardware threads by default).  Every run has to leave
+// every element with the same tuple and properties as the matcher alone; the
+// exit code is 1 otherwise.  Reports ns/element, the speedup over the serial
+// pass and the elements the StyleCache styled without matching.
+
+#include "YTMLParallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::string Table(int rows, int columns)
+	{
+		std::ostringstream s;
+		s << "<div class=\"app\">\n<div class=\"toolbar\">";
+		for (int b = 0; b < 8; ++b) s << "<div class=\"button\" id=\"b" << b << "\"/>";
+		s << "</div>\n<div class=\"table\">\n";
+		for (int r = 0; r < rows; ++r)
+		{
+			s << "<div id=\"r" << r << "\" class=\"row" << (r % 2 ? " odd" : "") << "\">";
+			for (int c = 0; c < columns; ++c)
+			{
+				s << "<div class=\"cell c" << c % 4 << "\"";
+				if (r % 10 == 3 && c == 1) s << " style=\"width: 12%; background-color: #ffeeee;\"";
+				s << "><div class=\"label\"/><div class=\"icon\"/></div>";
+			}
+			s << "</div>\n";
+		}
+		s << "</div>\n</div>\n";
+		return s.str();
+	}
+
+	const char* Css =
+		".app { display: flex; flex-direction: column; width: 100%; height: 100%; }\n"
+		".toolbar { display: flex; height: 32px; column-gap: 4px; }\n"
+		".toolbar > .button { width: 28px; height: 28px; border: 1; border-radius: 4px; }\n"
+		"#b0 { background-color: #3366cc; }\n"
+		".table { display: flex; flex-direction: column; row-gap: 1px; }\n"
+		".table > .row { display: flex; height: 1.5em; column-gap: 2px; }\n"
+		".row.odd { background-color: #f4f4f4; }\n"
+		".row .cell { flex: 1 1 0; border: 1; margin: 0 1 0 1; }\n"
+		".row > .c0 { flex-grow: 2; }\n"
+		".c1 { width: 5%; flex: none; }\n"
+		".odd .c3 .label { font-size: 0.8em; }\n"
+		".label { flex: 1; height: 1em; margin: 2 4 2 4; }\n"
+		".app .table .icon { width: 1em; height: 1em; border-radius: 50%; }\n"
+		"#r17 .icon, #r4242 .label { background-color: #ff0000; }\n"
+		"div > div > div > .icon { border-color: #808080; }\n";
+
+	// What styling leaves in an element, in tree order.
+	struct Styled {
+		std::map<std::string, std::string> tuple;
+		YTML1_1::ElementLengths lengths;
+		YTML1_1::ElementDisplay display;
+		YTML1_1::FlexStyle flex;
+		DirectX::XMFLOAT4 background, border;
+		uint16_t flags;
+
+		bool operator==(const Styled& rhs)const
+		{
+			return tuple == rhs.tuple && lengths == rhs.lengths && display == rhs.display && flex == rhs.flex &&
+				background.x == rhs.background.x && background.y == rhs.background.y && background.z == rhs.background.z && background.w == rhs.background.w &&
+				border.x == rhs.border.x && border.y == rhs.border.y && border.z == rhs.border.z && border.w == rhs.border.w && flags == rhs.flags;
+		}
+	};
+
+	std::vector<Styled> Snapshot(YTML1_1::Tree& tree)
+	{
+		std::vector<Styled> out;
+		for (YTML1_1::Tree* c : tree.child)
+			YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e)
+				{
+					out.push_back({ { e.tuple.begin(), e.tuple.end() }, e.lengths, e.display, e.flex, e.background_color, e.border_color, e.flags });
+				}, *c);
+		return out;
+	}
+
+	// Back to the element as BuildYTML1_1 left it.
+	void Unstyle(YTML1_1::Tree& tree)
+	{
+		for (YTML1_1::Tree* c : tree.child)
+			YTML1_1::RawLoopTree_L([](YTML1_1::Element& e)
+				{
+					e.ResetStyle();
+					e.ApplyAttributes();
+				}, *c);
+	}
+
+	void MatchSubtree(YTML1_1::Tree& node, YTML1_1::StyleMatcher& matcher)
+	{
+		YTML1_1::ApplyStyle(node.value, matcher);
+		if (node.child.empty()) return;
+		matcher.Push();
+		for (YTML1_1::Tree* c : node.child) MatchSubtree(*c, matcher);
+		matcher.Pop();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int rows = 6000, columns = 6, reps = 5;
+	size_t grain = 512;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--rows") rows = std::max(1, value);
+		else if (arg == "--columns") columns = std::max(1, value);
+		else if (arg == "--grain") grain = (size_t)std::max(1, value);
+		else if (arg == "--threads") threads = (unsigned)std::max(1, value);
+		else if (arg == "--reps") reps = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	YTML1_1::StyleSheet sheet;
+	YTML1_1::ParseCSS(Css, sheet);
+	YTML1_1::Tree tree;
+	size_t id = 1;
+	YTML1_1::BuildYTML1_1(Table(rows, columns), tree, id);
+	const size_t elements = id - 1;
+
+	auto time = [&](auto&& style)
+	{
+		double best = 1e30;
+		for (int r = 0; r < reps; ++r)
+		{
+			Unstyle(tree);
+			const auto start = Clock::now();
+			style();
+			best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+		}
+		return best;
+	};
+
+	auto matchAlone = [&]()
+	{
+		YTML1_1::StyleMatcher matcher(sheet);
+		for (YTML1_1::Tree* c : tree.child) MatchSubtree(*c, matcher);
+	};
+	Unstyle(tree);
+	matchAlone();
+	const std::vector<Styled> reference = Snapshot(tree);
+	const double matcherNs = time(matchAlone);
+
+	bool ok = true;
+	YTML1_1::SelectorStats serialStats;
+	Unstyle(tree);
+	YTML1_1::StyleYTML1_1(tree, sheet, &serialStats);
+	if (!(Snapshot(tree) == reference) || serialStats.elements != elements)
+	{
+		std::fprintf(stderr, "serial: style differs from the matcher's\n");
+		ok = false;
+	}
+	const double serialNs = time([&]() { YTML1_1::StyleYTML1_1(tree, sheet); });
+
+	std::printf("%zu elements, %d rows of %d cells, grain %zu\n", elements, rows, columns, grain);
+	std::printf("%-10s %10s %10s %12s\n", "threads", "ns/elem", "speedup", "cache hits");
+	std::printf("%-10s %10.1f %10.2f %12s\n", "matcher", matcherNs / elements, serialNs / matcherNs, "-");
+	std::printf("%-10s %10.1f %10s %11.1f%%\n", "serial", serialNs / elements, "1.00", 100.0 * serialStats.cacheHits / elements);
+
+	for (unsigned t = 1;; t = std::min(t * 2, threads))
+	{
+		JobSystem jobs(t - 1);
+
+		YTML1_1::SelectorStats stats;
+		Unstyle(tree);
+		YTML1_1::StyleYTML1_1Parallel(tree, sheet, jobs, &stats, 0, grain);
+		if (!(Snapshot(tree) == reference) || stats.elements != elements)
+		{
+			std::fprintf(stderr, "%u threads: style differs from the matcher's\n", t);
+			ok = false;
+		}
+
+		const double ns = time([&]() { YTML1_1::StyleYTML1_1Parallel(tree, sheet, jobs, nullptr, 0, grain); });
+		std::printf("%-10u %10.1f %10.2f %11.1f%%\n", t, ns / elements, serialNs / ns, 100.0 * stats.cacheHits / elements);
+		if (t == threads) break;
+	}
+	std::printf("%s\n", ok ? "styles match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
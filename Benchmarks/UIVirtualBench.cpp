@@ -0,0 +1,306 @@
+// Benchmark of VirtualList against a list with an element per item: the cost
+// of a frame that scrolls a list of 1k to 1M items, with a fixed extent and
+// with estimated ones the items measure other than.
+//
+//   g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc UIVirtualBench.cpp -o UIVirtualBench
+//   UIVirtualBench [--max N] [--frames F]
+//
+// Checks first that the items shown are the ones the scroll position falls
+// on, each where its offset puts it; that an item stays where it is when the
+// items above it are measured, inserted or erased; that following the end
+// keeps the last item at the bottom; and that the slots never outnumber what
+// the content box and the overscan hold.  The exit code is 1 when any of it
+// fails.  Then reports ns/frame, and the slots bound per frame, for lists up
+// to N items (1M by default), next to the materialized list up to 100k.
+
+#include "YTMLVirtual.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+void OutputDebugStringA(const char* s) { std::fputs(s, stderr); }
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const char* Css =
+		".list { width: 100%; height: 100%; border: 1; }\n"
+		".item { display: flex; height: 24px; column-gap: 4px; align-items: center; }\n"
+		".item.odd { background-color: #f4f4f4; }\n"
+		".label { flex: 1; height: 1em; margin: 0 4 0 4; }\n"
+		".icon { width: 1em; height: 1em; border-radius: 50%; }\n";
+
+	const char* Document = "<div class=\"list\"><div class=\"item\"><div class=\"label\"/><div class=\"icon\"/></div></div>";
+
+	// Estimated items are 16 to 39 pixels tall, by their key.
+	float Height(size_t key) { return 16.f + (float)(key * 7 % 24); }
+
+	struct Fixture {
+		YTML1_1::StyleSheet sheet;
+		YTML1_1::Tree tree;
+		size_t id = 1;
+		// What item i shows; Insert and Erase move the keys as they move the
+		// items.
+		std::vector<size_t> keys;
+		size_t next_key = 0;
+		std::unique_ptr<YTML1_1::VirtualList> list;
+
+		Fixture(size_t count, bool estimated)
+		{
+			YTML1_1::ParseCSS(Css, sheet);
+			YTML1_1::ParseYTML1_1(Document, tree, sheet, id);
+			tree->eid = 0;
+			tree->flags = 0;
+			tree->size = { 800.f, 600.f };
+			list = std::make_unique<YTML1_1::VirtualList>(*tree.child[0], sheet, id, [this, estimated](size_t item, YTML1_1::Tree& slot)
+				{
+					const size_t key = keys[item];
+					slot->attributes["key"] = std::to_string(key);
+					slot->attributes["class"] = key % 2 ? "item odd" : "item";
+					if (estimated) slot->attributes["style"] = "height: " + std::to_string((int)Height(key)) + "px;";
+				});
+			list->SetExtent(24.f, estimated);
+			SetCount(count);
+		}
+
+		void SetCount(size_t count)
+		{
+			while (keys.size() < count) keys.push_back(next_key++);
+			keys.resize(count);
+			list->SetCount(count);
+		}
+
+		void Insert(size_t at, size_t count)
+		{
+			std::vector<size_t> added(count);
+			for (size_t& k : added) k = next_key++;
+			keys.insert(keys.begin() + at, added.begin(), added.end());
+			list->Insert(at, count);
+		}
+
+		void Erase(size_t at, size_t count)
+		{
+			keys.erase(keys.begin() + at, keys.begin() + at + count);
+			list->Erase(at, count);
+		}
+
+		~Fixture() { list.reset(); }
+
+		void Layout()
+		{
+			static const std::function<void(YTML1_1::Element&, bool&)> nop = [](YTML1_1::Element&, bool&) {};
+			YTML1_1::RunYTML1_1(tree, nop);
+		}
+
+		YTML1_1::Tree& Container() { return *tree.child[0]; }
+	};
+
+	struct Shown {
+		size_t key, item;
+		float y, h;
+	};
+
+	std::vector<Shown> ShownItems(Fixture& f)
+	{
+		std::vector<Shown> out;
+		for (YTML1_1::Tree* c : f.Container().child)
+		{
+			const size_t key = (size_t)std::stoull(c->value.attributes["key"]);
+			const size_t item = (size_t)(std::find(f.keys.begin(), f.keys.end(), key) - f.keys.begin());
+			out.push_back({ key, item, c->value.size_in_display.y, c->value.size_in_display.h });
+		}
+		return out;
+	}
+
+	bool Fail(const char* what)
+	{
+		std::fprintf(stderr, "%s\n", what);
+		return false;
+	}
+
+	// The items shown follow each other with no gap, from the one the scroll
+	// position falls on, and fill the content box.
+	bool Contiguous(Fixture& f, bool estimated)
+	{
+		const std::vector<Shown> shown = ShownItems(f);
+		if (shown.empty()) return Fail("nothing shown");
+		const YTML1_1::Element& c = f.Container().value;
+		const float top = c.size_in_display.y + c.border.top, bottom = top + f.list->Viewport();
+		const double scroll = f.list->ScrollOffset();
+		for (size_t i = 0; i < shown.size(); ++i)
+		{
+			const Shown& s = shown[i];
+			if (i > 0 && (s.item != shown[i - 1].item + 1 || std::fabs(s.y - (shown[i - 1].y + shown[i - 1].h)) > 0.01f)) return Fail("items not contiguous");
+			if (s.item == f.keys.size()) return Fail("item not in the list shown");
+			if (s.h != (estimated ? Height(s.key) : 24.f)) return Fail("item of the wrong height");
+			if (!estimated && std::fabs(s.y - (top + (float)(s.item * 24.0 - scroll))) > 0.01f) return Fail("item off its offset");
+		}
+		if (shown.front().y > top + 0.01f || shown.front().y + shown.front().h <= top) return Fail("first item not at the top");
+		if (shown.back().y + shown.back().h < bottom - 0.01f && shown.back().item + 1 != f.list->Count()) return Fail("content box not filled");
+		if (shown.back().y >= bottom) return Fail("item below the content box shown");
+		return true;
+	}
+
+	bool Check()
+	{
+		bool ok = true;
+		{
+			Fixture f(100000, false);
+			f.list->ScrollTo(50000 * 24.0 + 7.0);
+			f.Layout();
+			ok = Contiguous(f, false) && ok;
+			if (ShownItems(f).front().item != 50000) ok = Fail("fixed: wrong first item");
+			// Past the end clamps to the last page.
+			f.list->ScrollTo(1e12);
+			f.Layout();
+			ok = Contiguous(f, false) && ok;
+			if (ShownItems(f).back().item != 99999) ok = Fail("fixed: last item not shown at the end");
+		}
+		{
+			Fixture f(100000, true);
+			f.list->ScrollTo(30000 * 24.0);
+			f.Layout();
+			ok = Contiguous(f, true) && ok;
+
+			// Laying out again measures nothing new; inserting and erasing
+			// above moves nothing.
+			const Shown anchor = ShownItems(f).front();
+			f.Layout();
+			if (ShownItems(f).front().key != anchor.key || ShownItems(f).front().y != anchor.y) ok = Fail("estimated: moved by a second layout");
+			f.Insert(10, 500);
+			f.Layout();
+			if (ShownItems(f).front().key != anchor.key || ShownItems(f).front().y != anchor.y) ok = Fail("estimated: moved by an insert above");
+			ok = Contiguous(f, true) && ok;
+			f.Erase(0, 1000);
+			f.Layout();
+			if (ShownItems(f).front().key != anchor.key || ShownItems(f).front().y != anchor.y) ok = Fail("estimated: moved by an erase above");
+			ok = Contiguous(f, true) && ok;
+			// Erasing what is shown brings up what follows.
+			f.Erase(anchor.item - 500, 3);
+			f.Layout();
+			ok = Contiguous(f, true) && ok;
+
+			// Scrolling up measures the items above the anchor on the way.
+			for (int i = 0; i < 200; ++i)
+			{
+				f.list->ScrollBy(-97.0);
+				f.Layout();
+				ok = Contiguous(f, true) && ok;
+			}
+		}
+		{
+			Fixture f(100, true);
+			f.list->SetFollowEnd(true);
+			f.list->ScrollTo(1e12);
+			f.Layout();
+			for (size_t n = 100; n < 400; n += 13)
+			{
+				f.SetCount(n);
+				f.Layout();
+				const std::vector<Shown> shown = ShownItems(f);
+				const YTML1_1::Element& c = f.Container().value;
+				if (shown.back().item != n - 1 || std::fabs(shown.back().y + shown.back().h - (c.size_in_display.y + c.border.top + f.list->Viewport())) > 0.01f)
+					ok = Fail("follow end: last item not at the bottom");
+			}
+		}
+		{
+			// The slots hold the content box and the overscan on both sides,
+			// and every slot has an eid of its own.
+			Fixture f(1000000, true);
+			const size_t most = (size_t)((600.0 + 2.0 * 256.0) / 16.0) + 3;
+			for (int i = 0; i < 400; ++i)
+			{
+				f.list->ScrollBy(i < 200 ? 313.0 : -811.0);
+				f.Layout();
+				if (f.list->Stats().slots > most) ok = Fail("slots unbounded");
+			}
+			std::unordered_set<size_t> eids;
+			YTML1_1::RawLoopTree_L([&](YTML1_1::Element& e) { if (!eids.insert(e.eid).second) ok = Fail("eid shared"); }, f.tree);
+		}
+		return ok;
+	}
+
+	std::string Materialized(size_t count)
+	{
+		std::ostringstream s;
+		s << "<div class=\"list\">";
+		for (size_t i = 0; i < count; ++i) s << "<div class=\"item" << (i % 2 ? " odd" : "") << "\"><div class=\"label\"/><div class=\"icon\"/></div>";
+		s << "</div>";
+		return s.str();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t most = 1000000;
+	int frames = 200;
+	for (int a = 1; a + 1 < argc; a += 2)
+	{
+		std::string arg = argv[a];
+		const int value = std::atoi(argv[a + 1]);
+		if (arg == "--max") most = (size_t)std::max(1000, value);
+		else if (arg == "--frames") frames = std::max(1, value);
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	const bool ok = Check();
+
+	std::printf("%-10s %12s %12s %12s %12s\n", "items", "fixed ns", "estimated", "bound/frame", "materialized");
+	for (size_t count = 1000; count <= most; count *= 10)
+	{
+		double ns[2];
+		double bound = 0.0;
+		for (int estimated = 0; estimated < 2; ++estimated)
+		{
+			Fixture f(count, estimated != 0);
+			f.list->ScrollTo(count * 12.0);
+			f.Layout();
+			size_t b = 0;
+			const auto start = Clock::now();
+			for (int i = 0; i < frames; ++i)
+			{
+				f.list->ScrollBy(i % 50 < 25 ? 37.0 : -37.0);
+				f.Layout();
+				b += f.list->Stats().bound;
+			}
+			ns[estimated] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+			if (estimated) bound = (double)b / frames;
+		}
+
+		std::string elements = "-";
+		if (count <= 100000)
+		{
+			YTML1_1::StyleSheet sheet;
+			YTML1_1::ParseCSS(Css, sheet);
+			YTML1_1::Tree tree;
+			size_t id = 1;
+			YTML1_1::ParseYTML1_1(Materialized(count), tree, sheet, id);
+			tree->eid = 0;
+			tree->flags = 0;
+			tree->size = { 800.f, 600.f };
+			static const std::function<void(YTML1_1::Element&, bool&)> nop = [](YTML1_1::Element&, bool&) {};
+			const int reps = std::max(1, (int)(100000 / count));
+			const auto start = Clock::now();
+			for (int i = 0; i < reps; ++i) YTML1_1::RunYTML1_1(tree, nop);
+			char buffer[32];
+			std::snprintf(buffer, sizeof(buffer), "%.0f", std::chrono::duration<double, std::nano>(Clock::now() - start).count() / reps);
+			elements = buffer;
+		}
+		std::printf("%-10zu %12.0f %12.0f %12.2f %12s\n", count, ns[0], ns[1], bound, elements.c_str());
+	}
+	std::printf("%s\n", ok ? "lists match" : "MISMATCH");
+	return ok ? 0 : 1;
+}
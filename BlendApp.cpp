@@ -2,9 +2,23 @@
 #include "Common/d3dApp.h"
 #include "Common/MathHelper.h"
 #include "Common/UploadBuffer.h"
+#include "Common/Profiler.h"
 #include "Common/GeometryGenerator.h"
 #include "FrameResource.h"
+#include "InputRecorder.h"
+#include "MapEditor.h"
+#include "CommandStream.h"
+#include "FrameCommands.h"
+#include "D3D12CommandBackend.h"
+#include "JobSystem.h"
+#include "FramePacer.h"
+#include "D3D12FrameFence.h"
+#include "UICuller.h"
+#include "UIRetainedBuffer.h"
+#include "FileWatcher.h"
 #include "YTML1_1.hpp"
+#include "YTMLPatch.hpp"
+#include "YTMLParallel.hpp"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -16,7 +30,7 @@ using namespace DirectX::PackedVector;
 #include <time.h>
 #include <DirectXMath.h>
 
-const int gNumFrameResources = 3;
+const int gNumFrameResources = FramePacer::MaxFramesInFlight;
 void OutputDebugStringA(const std::string& s) { OutputDebugStringA(s.c_str()); }
 
 struct RenderItem
@@ -58,10 +72,27 @@ public:
 
     virtual bool Initialize()override;
 
+	// Call before Initialize.  The recording is written when the app closes.
+	void StartRecording(const std::string& path);
+	// Call before Initialize.  Returns false if the file is not a recording.
+	bool StartReplay(const std::string& path);
+
+	// Frames the CPU may run ahead of the GPU, 1 to 4, and the frame rate to
+	// hold, 0 for uncapped.  Both can be set before Initialize.
+	void SetFramesInFlight(int count);
+	void SetTargetFps(double fps);
+
+	// Draws a frame needs per command list before its recording is split
+	// across the job system's threads.  Can be set before Initialize.
+	void SetMinDrawsPerChunk(int count);
+
 private:
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
     virtual void Draw(const GameTimer& gt)override;
+	virtual int CurrentFrameIndex()const override { return mCurrFrameResourceIndex; }
+	virtual std::wstring ExtraFrameStats()override;
+	virtual void GetIdleWait(std::vector<HANDLE>& handles, DWORD& timeoutMs)override;
 
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
@@ -70,8 +101,6 @@ private:
 	virtual void OnKeyDown(WPARAM p) override;
 	virtual void OnKeyUp(WPARAM p) override;
 
-    void OnKeyboardInput(const GameTimer& gt);
-	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
@@ -87,9 +116,21 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList);
+    void DrawRenderItems();
+	void RecordGround(CommandStream& stream);
+	void RecordUI(CommandStream& stream);
+	void SetupCommandList(ID3D12GraphicsCommandList* cmdList);
+	void BuildWorkerCommandLists();
 
-	void Brushing(const XMFLOAT2& pos, const float& range);
+	void UpdateBrush();
+	void UpdateTerrainVB();
+	void BuildUpdateGraph();
+
+	void QueueMouseInput(InputEventType type, WPARAM btnState, int x, int y);
+	void QueueKeyInput(InputEventType type, WPARAM key);
+	void PumpInput(const GameTimer& gt);
+
+	void ReloadUI();
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -100,6 +141,10 @@ private:
     FrameResource* mCurrFrameResource = nullptr;
     int mCurrFrameResourceIndex = 0;
 
+	// The frame resource Draw works on.  Same as mCurrFrameResource unless
+	// pipelined, where Update is already filling the next one.
+	FrameResource* mDrawFrameResource = nullptr;
+
     UINT mCbvSrvDescriptorSize = 0;
 	std::unordered_map<std::string, ComPtr<ID3D12RootSignature>> mRootSignature;
 
@@ -111,37 +156,102 @@ private:
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
-	std::unordered_map<std::string, std::string> mStyle;
+	YTML1_1::StyleSheet mStyle;
 
 	std::unordered_map<std::string, std::vector<D3D12_INPUT_ELEMENT_DESC>> mInputLayout;
  
 	// List of all the render items.
 	std::unordered_map<std::string, std::unique_ptr<RenderItem>> mRitems;
 	std::unique_ptr<UploadBuffer<VertexForMap>> MapVB;
-	std::vector<VertexForMap> MapV;
+	MapEditor mEditor;
 	
     PassConstants mMainPassCB;
 
-	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
-	XMFLOAT2 mEyeOnMap = {0, 0};
-	XMFLOAT4X4 mView = MathHelper::Identity4x4();
-	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
-	XMMATRIX mViewProj;
 
     float mTheta = 1.5f*XM_PI;
     float mPhi = XM_PIDIV2 - 0.1f;
-    float mRadius = 50.0f;
 
-	UINT brushMode = 0;
 	std::mt19937_64 mt = std::mt19937_64(time(nullptr));
 
-    POINT mLastMousePos;
-	UINT mLastMouseState = 0;
 
 	YTML1_1::Tree mYTMLTree;
-	size_t UICBSize = 0;
+
+	// The stylesheet and document are watched; a save is patched into
+	// mYTMLTree and only what it touched is restyled.  Polled in Update; with
+	// render-on-demand the idle wait wakes on the watcher's events and again
+	// once a save has settled, see GetIdleWait.
+	static constexpr const char* UIStylePath = "somestyle.css";
+	static constexpr const char* UIDocumentPath = "sample.html";
+	YTML1_1::StyleInvalidator mUIInvalidator{ mStyle };
+	FileWatcher mUIWatcher;
+	std::vector<std::string> mUIChangedFiles;
+	size_t mUIBiggestId = 1;
+	// Layout runs only after something it reads changed: the window size or
+	// a reload.  Scroll and translate offsets are applied as the instances
+	// are emitted, so a scrolling pane costs the emission walk alone.
+	bool mUILayoutDirty = true;
+
+	// Layout output is diffed into the retained instance buffer and culled on
+	// the CPU; only changed slots and a changed draw list reach the upload
+	// buffers.
+	std::unique_ptr<UIRetainedBuffer> mUIRetained;
+	UICuller mUICuller;
+	std::vector<UIInstance> mUIEmitted;
+	std::vector<std::uint32_t> mUIEmittedSlots;
+	std::vector<std::uint32_t> mUICulled;
+	std::vector<std::uint32_t> mUIDrawList;
+	size_t mUIUploaded = 0;
+
+	// Draw work is recorded into a CommandStream; F8 dumps the last one.  A
+	// stream with enough draws is split into chunks that are replayed on their
+	// own command list in parallel: chunk 0 on mCommandList, chunk k on
+	// mWorkerCommandLists[k - 1], submitted in chunk order.
+	static constexpr size_t MaxCommandChunks = 4;
+	size_t mMinDrawsPerChunk = 128;
+	CommandStream mCommandStream;
+	std::vector<CommandStream> mCommandChunks;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> mWorkerCommandLists;
+	size_t mActiveChunks = 1;
+
+	// Update phases run as a task graph on the job system.
+	std::unique_ptr<JobSystem> mJobs;
+	TaskGraph mUpdateGraph;
+
+	// Window messages only queue input; Update applies it at the start of the
+	// frame, which is the stream that gets recorded and replayed.
+	std::vector<InputEvent> mPendingInput;
+	InputState mLiveInput;
+	std::uint32_t mFrameNumber = 0;
+	std::unique_ptr<InputRecording> mInputRecording;
+	std::string mInputRecordPath;
+	std::unique_ptr<InputRecording> mReplayRecording;
+	std::unique_ptr<InputPlayer> mInputPlayer;
+
+	bool mAnimateMaterials = true;
+
+	SteadyFrameClock mPacerClock;
+	std::unique_ptr<D3D12FrameFence> mPacerFence;
+	std::unique_ptr<FramePacer> mPacer;
+	int mFramesInFlight = 3;
+	double mTargetFps = 0.0;
 };
 
+// Argument following a "-name" switch, or empty if the switch is missing.
+std::string CommandLineValue(const char* cmdLine, const char* name)
+{
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while(args >> arg)
+	{
+		if(arg == name)
+		{
+			args >> arg;
+			return args ? arg : std::string();
+		}
+	}
+	return std::string();
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -153,6 +263,39 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     try
     {
         BlendApp theApp(hInstance);
+		theApp.SetPipelined(strstr(cmdLine, "-pipelined") != nullptr);
+		theApp.SetRenderOnDemand(strstr(cmdLine, "-ondemand") != nullptr);
+
+		// -frames <1-4> sets the frames in flight, -fps <n> caps the frame rate.
+		std::string frames = CommandLineValue(cmdLine, "-frames");
+		std::string fps = CommandLineValue(cmdLine, "-fps");
+		if(!frames.empty())
+			theApp.SetFramesInFlight(atoi(frames.c_str()));
+		if(!fps.empty())
+			theApp.SetTargetFps(atof(fps.c_str()));
+
+		// -chunkdraws <n> splits the draw recording across threads once every
+		// command list gets n draws; 1 splits even the two draws of this scene.
+		std::string chunkDraws = CommandLineValue(cmdLine, "-chunkdraws");
+		if(!chunkDraws.empty())
+			theApp.SetMinDrawsPerChunk(atoi(chunkDraws.c_str()));
+
+		// -record <file> captures this session's input, -replay <file> plays
+		// one back with a fixed time step and quits at its end.
+		std::string recordPath = CommandLineValue(cmdLine, "-record");
+		std::string replayPath = CommandLineValue(cmdLine, "-replay");
+		if(!replayPath.empty())
+		{
+			if(!theApp.StartReplay(replayPath))
+			{
+				MessageBox(nullptr, L"Cannot read the input recording.", L"Replay Failed", MB_OK);
+				return 0;
+			}
+		}
+		else if(!recordPath.empty())
+		{
+			theApp.StartRecording(recordPath);
+		}
         if(!theApp.Initialize())
             return 0;
 
@@ -174,6 +317,9 @@ BlendApp::~BlendApp()
 {
     if(md3dDevice != nullptr)
         FlushCommandQueue();
+
+	if(mInputRecording && !mInputRecording->Save(mInputRecordPath))
+		OutputDebugStringA(("Failed to write " + mInputRecordPath + "\n").c_str());
 }
 
 bool BlendApp::Initialize()
@@ -187,6 +333,14 @@ bool BlendApp::Initialize()
     // Get the increment size of a descriptor in this heap type.  This is hardware specific, 
 	// so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	mJobs = std::make_unique<JobSystem>();
+
+	mPacerFence = std::make_unique<D3D12FrameFence>(mFence.Get());
+	mPacer = std::make_unique<FramePacer>(*mPacerFence, mPacerClock);
+	mUIRetained = std::make_unique<UIRetainedBuffer>(FrameResource::MaxUIInstances, gNumFrameResources);
+	SetFramesInFlight(mFramesInFlight);
+	SetTargetFps(mTargetFps);
 	 
 	LoadTextures();
     BuildRootSignature();
@@ -198,6 +352,8 @@ bool BlendApp::Initialize()
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
+	BuildWorkerCommandLists();
+	BuildUpdateGraph();
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -214,75 +370,89 @@ void BlendApp::OnResize()
 {
     D3DApp::OnResize();
 
+	// The root's size is the viewport; the next layout resolves again only
+	// the lengths that depend on it.
 	mYTMLTree->eid = 0;
 	mYTMLTree->size = { (float)mClientWidth, (float)mClientHeight };
 	mYTMLTree->flags = 0;
+	mUILayoutDirty = true;
 
     // The window resized, so update the aspect ratio and recompute the projection matrix.
-    XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
-    XMStoreFloat4x4(&mProj, P);
+	mEditor.SetViewport(mClientWidth, mClientHeight);
+	mUICuller.SetViewport((float)mClientWidth, (float)mClientHeight);
 }
 
 void BlendApp::Update(const GameTimer& gt)
 {
-	if ((GetKeyState(VK_LBUTTON) & 0x100) != 0)
-	{
-		XMFLOAT4 pos = { -19.921875, 0.f, -19.921875, 1.f };
-		XMVECTOR v = XMVector4Transform(XMVectorSet(pos.x, pos.y, pos.z, pos.w), mViewProj);
-		XMStoreFloat4(&pos, v);
-		XMFLOAT2 npos_start = { (pos.x / pos.w + 1.f) / 2.f * mClientWidth, (-pos.y / pos.w + 1.f) / 2.f * mClientHeight };
-
-		pos = { 19.921875, 0.f, 19.921875, 1.f };
-		v = XMVector4Transform(XMVectorSet(pos.x, pos.y, pos.z, pos.w), mViewProj);
-		XMStoreFloat4(&pos, v);
-		XMFLOAT2 npos_end = { (pos.x / pos.w + 1.f) / 2.f * mClientWidth, (-pos.y / pos.w + 1.f) / 2.f * mClientHeight };
-
-		XMFLOAT4 rect = { npos_start.x, npos_start.y, npos_end.x - npos_start.x, npos_end.y - npos_start.y };
-		if (rect.z < 0) {
-			rect.x += rect.z;
-			rect.z = -rect.z;
-		}
-		if (rect.w < 0) {
-			rect.y += rect.w;
-			rect.w = -rect.w;
-		}
-
-		if (mLastMousePos.x >= rect.x && mLastMousePos.y >= rect.y && mLastMousePos.x <= rect.x + rect.z && mLastMousePos.y <= rect.y + rect.w) {
-			XMFLOAT2 nmp = { (mLastMousePos.x - rect.x) / rect.z, 1 - (mLastMousePos.y - rect.y) / rect.w };
+	PROFILE_ZONE("Update");
 
-			Brushing(nmp, 9);
-		}
+	// Wait for a free frame resource and the target frame time before taking
+	// input, so it is as fresh as possible when the frame is drawn.
+	{
+		PROFILE_ZONE("WaitFrameResource");
+		mCurrFrameResourceIndex = mPacer->BeginFrame();
+		mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
 	}
 
-    OnKeyboardInput(gt);
-	UpdateCamera(gt);
+	// Input is applied on the window thread before the update fans out.
+	PumpInput(gt);
+	mEditor.UpdateCamera(gt.DeltaTime());
+	ReloadUI();
 
-    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
-    mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
+	mUpdateGraph.Run(*mJobs);
 
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+	// With render-on-demand the next frame is only drawn if something in it
+	// will still change without new input.
+	if (mInputPlayer || mAnimateMaterials || mEditor.IsCameraMoving() ||
+		mEditor.Input().IsButtonDown(InputCode::LeftButton) || mEditor.Terrain().IsDirty())
+		Invalidate();
+}
 
-	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
-	UpdateMainPassCB(gt);
+void BlendApp::BuildUpdateGraph()
+{
+	// The graph always runs with mTimer, which is what Update gets as well.
+	//
+	//   brush -> terrain upload
+	//   animate materials -> material constants -> main pass
+	//   object constants and UI layout on their own
+	size_t brush = mUpdateGraph.Add([this]() { UpdateBrush(); });
+	size_t terrain = mUpdateGraph.Add([this]() { UpdateTerrainVB(); });
+	size_t animate = mUpdateGraph.Add([this]() { AnimateMaterials(mTimer); });
+	size_t materials = mUpdateGraph.Add([this]() { UpdateMaterialCBs(mTimer); });
+	size_t mainPass = mUpdateGraph.Add([this]() { UpdateMainPassCB(mTimer); });
+	mUpdateGraph.Add([this]() { UpdateObjectCBs(mTimer); });
+
+	mUpdateGraph.Precede(brush, terrain);
+	mUpdateGraph.Precede(animate, materials);
+	mUpdateGraph.Precede(materials, mainPass);
+}
 
-	for (size_t i = 0; i < MapV.size(); ++i) {
-		auto& v = MapV[i];
+void BlendApp::UpdateBrush()
+{
+	PROFILE_ZONE("Brushing");
 
-		MapVB->CopyData(i, v);
-	}
+	mEditor.UpdateBrush();
+}
+
+void BlendApp::UpdateTerrainVB()
+{
+	// MapVB is shared by all frame resources, so it only needs what changed.
+	const auto dirty = mEditor.Terrain().TakeDirtyRange();
+	const auto& vertices = mEditor.Terrain().Vertices();
+	mJobs->ParallelFor(dirty.Count(), 4096, [&](size_t begin, size_t end)
+	{
+		MapVB->CopyRange(dirty.Begin + begin, &vertices[dirty.Begin + begin], end - begin);
+		StreamingFence();
+	});
 }
 
 void BlendApp::Draw(const GameTimer& gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
+	PROFILE_ZONE("Draw");
+
+	mDrawFrameResource = mFrameResources[mDrawFrameIndex].get();
+
+    auto cmdListAlloc = mDrawFrameResource->CmdListAlloc;
 
     // Reuse the memory associated with command recording.
     // We can only reset when the associated command lists have finished execution on the GPU.
@@ -292,9 +462,6 @@ void BlendApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["UI"].Get()));
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
@@ -303,17 +470,9 @@ void BlendApp::Draw(const GameTimer& gt)
     mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
     mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature["Map"].Get());
+	SetupCommandList(mCommandList.Get());
 
-	
-
-    DrawRenderItems(mCommandList.Get());//, mRitemLayer[(int)RenderLayer::Opaque]
+	DrawRenderItems();//, mRitemLayer[(int)RenderLayer::Opaque]
 
 	///mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
 	///DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
@@ -321,164 +480,268 @@ void BlendApp::Draw(const GameTimer& gt)
 	///mCommandList->SetPipelineState(mPSOs["transparent"].Get());
 	///DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
 
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+    // Indicate a state transition on the resource usage, at the end of the
+	// last chunk's list.
+	ID3D12GraphicsCommandList* lastList = mActiveChunks > 1 ? mWorkerCommandLists[mActiveChunks - 2].Get() : mCommandList.Get();
+	lastList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
 
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    // Add the command lists to the queue for execution, in chunk order.
+	ID3D12CommandList* cmdsLists[MaxCommandChunks] = { mCommandList.Get() };
+	for (size_t k = 1; k < mActiveChunks; ++k)
+	{
+		ThrowIfFailed(mWorkerCommandLists[k - 1]->Close());
+		cmdsLists[k] = mWorkerCommandLists[k - 1].Get();
+	}
+    mCommandQueue->ExecuteCommandLists((UINT)mActiveChunks, cmdsLists);
 
     // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
+	{
+		PROFILE_ZONE("Present");
+		ThrowIfFailed(mSwapChain->Present(PresentSyncInterval(), 0));
+	}
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
     // Advance the fence value to mark commands up to this fence point.
-    mCurrFrameResource->Fence = ++mCurrentFence;
+    mDrawFrameResource->Fence = ++mCurrentFence;
 
 
     // Add an instruction to the command queue to set a new fence point. 
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mPacer->EndFrame(mDrawFrameIndex, mCurrentFence);
 }
 
 void BlendApp::OnMouseDown(WPARAM btnState, int x, int y)
 {
-	if ((btnState & MK_LBUTTON) != 0)
-	{
-		bool run = true;
-		YTML1_1::RawLoopTree_RL(
-			[&](YTML1_1::Element& e, bool& run) {
-				if (e.flags & ElementFlag::Enable)
-				{
-					if (x >= e.size_in_display.x && y >= e.size_in_display.y && x <= e.size_in_display.x + e.size_in_display.w && y <= e.size_in_display.y + e.size_in_display.h)
-					{
-						e.background_color = (XMFLOAT4)Colors::Red;
-						run = false;
-					}
-				}
-			}
-		, mYTMLTree, run);
-	}
-
-    mLastMousePos.x = x;
-    mLastMousePos.y = y;
+	QueueMouseInput(InputEventType::MouseDown, btnState, x, y);
 
     SetCapture(mhMainWnd);
 }
 
 void BlendApp::OnMouseUp(WPARAM btnState, int x, int y)
 {
-	//if ((btnState & MK_LBUTTON) != 0)
-	{
-		bool run = true;
-		YTML1_1::RawLoopTree_RL(
-			[&](YTML1_1::Element& e, bool& run) {
-				if (e.flags & ElementFlag::Enable)
-				{
-					if (x >= e.size_in_display.x && y >= e.size_in_display.y && x <= e.size_in_display.x + e.size_in_display.w && y <= e.size_in_display.y + e.size_in_display.h)
-					{
-						e.background_color = (XMFLOAT4)Colors::Blue;
-						run = false;
-					}
-				}
-			}
-		, mYTMLTree, run);
-	}
+	QueueMouseInput(InputEventType::MouseUp, btnState, x, y);
 
     ReleaseCapture();
 }
 
-void BlendApp::Brushing(const XMFLOAT2& pos, const float& range)
+void BlendApp::OnMouseMove(WPARAM btnState, int x, int y)
 {
-	size_t min_x = 0, max_x = 256, min_y = 0, max_y = 256;
+	QueueMouseInput(InputEventType::MouseMove, btnState, x, y);
+}
 
-	if (pos.x * 255 - range > 0) min_x = (size_t)(pos.x * 255 - range);
-	if (pos.y * 255 - range > 0) min_y = (size_t)(pos.y * 255 - range);
+void BlendApp::OnKeyDown(WPARAM p) 
+{
+	switch (p) {
+	case VK_F8:
+		// Dump and validate the last recorded frame so streams can be diffed between builds.
+		{
+			WaitForRenderIdle();
 
-	if (pos.x * 255 + range < 256) max_x = (size_t)(pos.x * 255 + range);
-	if (pos.y * 255 + range < 256) max_y = (size_t)(pos.y * 255 + range);
+			std::ofstream file("commandstream.txt");
+			mCommandStream.Dump(file);
 
-	for (size_t _x = min_x; _x < max_x; ++_x)
-	{
-		for (size_t _y = min_y; _y < max_y; ++_y)
-		{
-			auto& v = MapV[_y + _x * 256];
-			float dist = sqrtf(powf(v.x - pos.x * 255, 2) + powf(v.y - pos.y * 255, 2));
-			if (dist <= 9)
+			// A split frame is checked chunk by chunk, as each list sees it.
+			NullCommandBackend validator;
+			if (mActiveChunks == 1) validator.Execute(mCommandStream);
+			for (size_t k = 0; mActiveChunks > 1 && k < mActiveChunks; ++k)
 			{
-				float* geo = (float*)& v.Geo;
-				geo[brushMode] += 1.f - dist / range;
-				float all = 0;
-				for (int i = 0; i < MapTexture::size; ++i) all += geo[i];
-				for (int i = 0; i < MapTexture::size; ++i) geo[i] /= all;
+				file << "# chunk " << k << "\n";
+				mCommandChunks[k].Dump(file);
+				validator.Execute(mCommandChunks[k]);
 			}
+			for (const auto& err : validator.Errors()) OutputDebugStringA(err + "\n");
 		}
+		break;
+	case VK_F6:
+		// Cycle the frames in flight.
+		SetFramesInFlight(mFramesInFlight % FramePacer::MaxFramesInFlight + 1);
+		break;
+	case VK_F5:
+		mUICuller.SetOcclusion(!mUICuller.Occlusion());
+		break;
+	case VK_F7:
+		// A still scene lets render-on-demand idle.
+		mAnimateMaterials = !mAnimateMaterials;
+		break;
+	case VK_F9:
+		// Open in chrome://tracing or ui.perfetto.dev.
+		if (!Profiler::ExportChromeTrace("profile.json")) OutputDebugStringA("Failed to write profile.json\n");
+		break;
+	default:
+		QueueKeyInput(InputEventType::KeyDown, p);
+		break;
 	}
 }
+void BlendApp::OnKeyUp(WPARAM p)
+{
+	QueueKeyInput(InputEventType::KeyUp, p);
+}
 
-void BlendApp::OnMouseMove(WPARAM btnState, int x, int y)
+void BlendApp::QueueMouseInput(InputEventType type, WPARAM btnState, int x, int y)
 {
-    if((btnState & MK_LBUTTON) != 0)
-    {
-    }
+	InputEvent e;
+	e.Type = type;
+	e.Buttons = (std::uint32_t)btnState;
+	e.X = x;
+	e.Y = y;
+	mPendingInput.push_back(e);
+}
 
-    mLastMousePos.x = x;
-    mLastMousePos.y = y;
-	mLastMouseState = btnState;
+void BlendApp::QueueKeyInput(InputEventType type, WPARAM key)
+{
+	InputEvent e;
+	e.Type = type;
+	e.Key = (std::uint32_t)key;
+
+	// Drop auto-repeat, a held key only needs its first key down.
+	if (type == InputEventType::KeyDown && mLiveInput.IsKeyDown(e.Key))
+		return;
+
+	mLiveInput.Apply(e);
+	mPendingInput.push_back(e);
 }
 
-void BlendApp::OnKeyDown(WPARAM p) 
+void BlendApp::PumpInput(const GameTimer& gt)
 {
-	switch (p) {
-	case '1':
-		brushMode = 0;
-		break;
-	case '2':
-		brushMode = 1;
-		break;
-	case '3':
-		brushMode = 2;
-		break;
-	case '4':
-		brushMode = 3;
-		break;
+	if (mInputPlayer)
+	{
+		// Live input is ignored while replaying.
+		mPendingInput.clear();
+
+		if (mInputPlayer->Finished(mFrameNumber))
+			PostQuitMessage(0);
+
+		for (const auto& e : mInputPlayer->EventsFor(mFrameNumber))
+			mEditor.HandleEvent(e, mYTMLTree);
+	}
+	else
+	{
+		for (const auto& e : mPendingInput)
+		{
+			if (mInputRecording)
+				mInputRecording->Add(mFrameNumber, (std::uint64_t)(gt.TotalTime() * 1e6), e);
+
+			mEditor.HandleEvent(e, mYTMLTree);
+		}
+		mPendingInput.clear();
+
+		if (mInputRecording)
+			mInputRecording->FrameCount = mFrameNumber + 1;
 	}
+
+	++mFrameNumber;
 }
-void BlendApp::OnKeyUp(WPARAM) {}
- 
-void BlendApp::OnKeyboardInput(const GameTimer& gt)
+
+void BlendApp::ReloadUI()
 {
-	if (GetAsyncKeyState('A')) mEyeOnMap.x -= 1.f * gt.DeltaTime() * mRadius;
-	if (GetAsyncKeyState('D')) mEyeOnMap.x += 1.f * gt.DeltaTime() * mRadius;
-	if (GetAsyncKeyState('W')) mEyeOnMap.y += 1.f * gt.DeltaTime() * mRadius;
-	if (GetAsyncKeyState('S')) mEyeOnMap.y -= 1.f * gt.DeltaTime() * mRadius;
-	MathHelper::Clamp(mEyeOnMap.x, -127.5f / 256.f * 40.f, 127.5f / 256.f * 40.f);
-	MathHelper::Clamp(mEyeOnMap.y, -127.5f / 256.f * 40.f, 127.5f / 256.f * 40.f);
+	PROFILE_ZONE("ReloadUI");
+
+	mUIChangedFiles.clear();
+	mUIWatcher.Poll(mUIChangedFiles);
+	if (mUIChangedFiles.empty()) return;
+
+	YTML1_1::TreePatchStats patch;
+	size_t rules = 0;
+	for (const auto& path : mUIChangedFiles)
+	{
+		std::ifstream file(path);
+		std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		// Caught between truncate and write; the rest of the save follows.
+		if (str.empty()) continue;
 
+		if (path == UIStylePath) rules += YTML1_1::ReloadCSS(str, mStyle, mYTMLTree, mUIInvalidator);
+		else YTML1_1::ReloadYTML1_1(str, mYTMLTree, mUIInvalidator, mUIBiggestId, &patch);
+	}
+	mUIInvalidator.Flush();
+	mUILayoutDirty = true;
+
+	OutputDebugStringA("UI reloaded: " + std::to_string(patch.kept) + " kept, " + std::to_string(patch.added) + " added, " +
+		std::to_string(patch.removed) + " removed, " + std::to_string(rules) + " hit by changed rules, " +
+		std::to_string(mUIInvalidator.Stats().restyled) + " restyled\n");
+	Invalidate();
+}
+
+void BlendApp::GetIdleWait(std::vector<HANDLE>& handles, DWORD& timeoutMs)
+{
+	// A save signals one of these, and the frame it wakes polls the change;
+	// once it settles the timeout wakes another to reload it.
+	std::vector<void*> events;
+	mUIWatcher.WaitHandles(events);
+	handles.insert(handles.end(), events.begin(), events.end());
+
+	const auto settle = mUIWatcher.UntilSettled();
+	if (settle != std::chrono::milliseconds::max())
+		timeoutMs = std::min(timeoutMs, (DWORD)settle.count());
+}
+
+void BlendApp::StartRecording(const std::string& path)
+{
+	mInputRecording = std::make_unique<InputRecording>();
+	mInputRecording->ClientWidth = mClientWidth;
+	mInputRecording->ClientHeight = mClientHeight;
+	mInputRecordPath = path;
+}
+
+bool BlendApp::StartReplay(const std::string& path)
+{
+	auto recording = std::make_unique<InputRecording>();
+	if (!recording->Load(path))
+		return false;
+
+	// Same window size and the same simulated time per frame as recorded.
+	mClientWidth = (int)recording->ClientWidth;
+	mClientHeight = (int)recording->ClientHeight;
+	mTimer.SetFixedStep(recording->FixedStep);
+
+	mReplayRecording = std::move(recording);
+	mInputPlayer = std::make_unique<InputPlayer>(*mReplayRecording);
+	return true;
 }
  
-void BlendApp::UpdateCamera(const GameTimer& gt)
+void BlendApp::SetFramesInFlight(int count)
 {
-	mEyePos.x = mEyeOnMap.x;
-	mEyePos.z = -0.000001f * mRadius + mEyeOnMap.y;
-	mEyePos.y = mRadius;
+	mFramesInFlight = std::min(std::max(count, 1), FramePacer::MaxFramesInFlight);
+
+	// In pipelined mode Update of a frame overlaps Draw of the one before,
+	// which isn't submitted yet, so the pacer can wait for no fewer than two.
+	if (mPacer)
+		mPacer->SetFramesInFlight(mPipelined ? std::max(mFramesInFlight, 2) : mFramesInFlight);
+}
 
-	// Build the view matrix.
-	XMVECTOR pos = XMVectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
-	XMVECTOR target = XMVectorSet(mEyeOnMap.x, 0.f, mEyeOnMap.y, 0.f);
-	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+void BlendApp::SetTargetFps(double fps)
+{
+	mTargetFps = fps;
+	if (mPacer)
+		mPacer->SetTargetFps(fps);
+}
 
-	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
-	XMStoreFloat4x4(&mView, view);
+void BlendApp::SetMinDrawsPerChunk(int count)
+{
+	mMinDrawsPerChunk = (size_t)std::max(count, 1);
+}
+
+std::wstring BlendApp::ExtraFrameStats()
+{
+	FrameTiming t = mPacer->TakeAverage();
+	const UICullStats& ui = mUICuller.Stats();
+	return L"   in flight: " + std::to_wstring(mPacer->FramesInFlight()) +
+		L"   gpu wait: " + std::to_wstring(t.GpuWaitMs) +
+		L"   cpu wait: " + std::to_wstring(t.CpuWaitMs) +
+		L"   ui: " + std::to_wstring(ui.Emitted) + L" drawn, " + std::to_wstring(ui.Culled()) + L" culled, " +
+		std::to_wstring(mUIUploaded) + L" uploaded";
 }
 
 void BlendApp::AnimateMaterials(const GameTimer& gt)
 {
+	if (!mAnimateMaterials)
+		return;
+
 	// Scroll the water material texture coordinates.
 	auto waterMat = mMaterials["water"].get();
 
@@ -503,6 +766,8 @@ void BlendApp::AnimateMaterials(const GameTimer& gt)
 
 void BlendApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_ZONE("UpdateObjectCBs");
+
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mRitems)
 	{
@@ -523,52 +788,68 @@ void BlendApp::UpdateObjectCBs(const GameTimer& gt)
 			e.second->NumFramesDirty--;
 		}
 	}
-	auto currUICB = mCurrFrameResource->UICB.get();
+	auto currUI = mCurrFrameResource->UIInstances.get();
 
-	size_t i = 0;
+	PROFILE_ZONE("RunYTML1_1");
+	mUIRetained->BeginFrame();
+	mUICuller.Begin();
+	mUIEmitted.clear();
+	mUIEmittedSlots.clear();
+
+	// Big documents are laid out on the workers.
+	if (mUILayoutDirty)
+	{
+		YTML1_1::RunYTML1_1Parallel(mYTMLTree, *mJobs, [](YTML1_1::Element&, bool&) {});
+		mUILayoutDirty = false;
+	}
 
-	YTML1_1::RunYTML1_1(mYTMLTree,
-		[&](YTML1_1::Element & e, bool& run) {
+	// The instances are written here, in document order, where the offsets
+	// put them.
+	YTML1_1::EmitYTML1_1(mYTMLTree,
+		[&](YTML1_1::Element & e, const YTML1_1::FloatRect& r, bool& run) {
 			if (e.flags & ElementFlag::Enable)
 			{
-				//Border and Body
-				if (e.border.left != 0 || e.border.top != 0 || e.border.bottom != 0 || e.border.right != 0)
+				// One instance carries body and border.
+				UIInstance inst;
+				inst.Rect = { r.x, r.y, r.w, r.h };
+				inst.FillColor = PackUIColor(e.background_color);
+				inst.BorderColor = PackUIColor(e.border_color);
+				inst.BorderWidths = PackUIBorderWidths(e.border.left, e.border.top, e.border.right, e.border.bottom);
+				inst.CornerRadius = e.border_radius;
+
+				// Culled elements keep their slot, so they cost nothing to
+				// bring back.
+				const std::uint32_t slot = mUIRetained->Update(e.eid, inst);
+				if (slot != UIRetainedBuffer::InvalidSlot && mUICuller.Accept(inst))
 				{
-					UIConsts c;
-					XMStoreFloat4x4(&c.World,
-						XMMatrixScaling(e.size_in_display.w, e.size_in_display.h, 0) +
-						XMMatrixTranslation(e.size_in_display.x, e.size_in_display.y, 0)
-					);
-
-					c.Color = e.border_color;
-					currUICB->CopyData(i++, c);
-
-					XMStoreFloat4x4(&c.World,
-						XMMatrixScaling(e.size_in_display.w - e.border.left - e.border.right, e.size_in_display.h - e.border.top - e.border.bottom, 0) +
-						XMMatrixTranslation(e.size_in_display.x + e.border.left, e.size_in_display.y + e.border.top, 0)
-					);
-
-					c.Color = e.background_color;
-					currUICB->CopyData(i++, c);
+					mUIEmitted.push_back(inst);
+					mUIEmittedSlots.push_back(slot);
 				}
-				else
-				//Only Body
-				{
-					UIConsts c;
-					XMStoreFloat4x4(&c.World,
-						XMMatrixScaling(e.size_in_display.w, e.size_in_display.h, 0) +
-						XMMatrixTranslation(e.size_in_display.x, e.size_in_display.y, 0)
-					);
-
-					c.Color = e.background_color;
-					currUICB->CopyData(i++, c);
-				}
-
 			}
 		}
 	);
-	
-	UICBSize = i;
+	mUIRetained->EndFrame();
+
+	// The survivors come out topmost first, so the last element emitted is
+	// drawn first.
+	mUICuller.Finish(mUIEmitted, mUICulled);
+	mUIDrawList.clear();
+	for (std::uint32_t i : mUICulled) mUIDrawList.push_back(mUIEmittedSlots[i]);
+	mUIRetained->SetDrawList(mUIDrawList);
+
+	// Bring this frame resource's copy up to date with what changed since it
+	// was last used.
+	auto currDrawList = mCurrFrameResource->UIDrawList.get();
+	mUIUploaded = mUIRetained->Sync(mCurrFrameResourceIndex, [&](std::uint32_t first, const UIInstance* data, size_t count)
+		{
+			currUI->CopyRange(first, data, count);
+		});
+	mUIRetained->SyncDrawList(mCurrFrameResourceIndex, [&](const std::uint32_t* drawList, size_t count)
+		{
+			currDrawList->CopyRange(0, drawList, count);
+		});
+	StreamingFence();
+	mCurrFrameResource->UICount = mUIRetained->DrawList().size();
 }
 
 void BlendApp::UpdateMaterialCBs(const GameTimer& gt)
@@ -599,21 +880,21 @@ void BlendApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void BlendApp::UpdateMainPassCB(const GameTimer& gt)
 {
-	XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	XMMATRIX view = XMLoadFloat4x4(&mEditor.View());
+	XMMATRIX proj = XMLoadFloat4x4(&mEditor.Proj());
 
-	mViewProj = XMMatrixMultiply(view, proj);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
 	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(mViewProj), mViewProj);
+	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
 
 	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
 	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
 	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
 	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(mViewProj));
+	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
 	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = mEyePos;
+	mMainPassCB.EyePosW = mEditor.EyePos();
 	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
 	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
 	mMainPassCB.NearZ = 1.0f;
@@ -702,12 +983,13 @@ void BlendApp::BuildRootSignature()
 			IID_PPV_ARGS(mRootSignature["Map"].GetAddressOf())));
 	}
 	{
-		CD3DX12_ROOT_PARAMETER slotRootParameter[2];
-		slotRootParameter[0].InitAsConstantBufferView(0);
+		CD3DX12_ROOT_PARAMETER slotRootParameter[3];
+		slotRootParameter[0].InitAsShaderResourceView(0);
 		slotRootParameter[1].InitAsConstantBufferView(1);
+		slotRootParameter[2].InitAsShaderResourceView(1);
 
 
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2, slotRootParameter,
+		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(3, slotRootParameter,
 			(UINT)staticSamplers.size(), staticSamplers.data(),
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -799,36 +1081,14 @@ void BlendApp::BuildShadersAndInputLayout()
 
 void BlendApp::BuildWavesGeometry()
 {
-	std::vector<std::uint16_t> indices;
+	const auto& vertices = mEditor.Terrain().Vertices();
+	std::vector<std::uint16_t> indices = mEditor.Terrain().BuildIndices<std::uint16_t>();
 
-	for (UINT i = 0; i < 256; ++i)
-	{
-		for (UINT j = 0; j < 256; ++j)
-		{
-			VertexForMap v = VertexForMap(i, j, XMFLOAT3((i - 127.5f) / 256.f * 40.f, 0, (j - 127.5f) / 256.f * 40.f), XMFLOAT3(), XMFLOAT2(i / 255.f * 2, j / 255.f * 2));
-			v.Geo._0 = 1;
-			MapV.push_back(v);
-		}
-	}
+	MapVB = std::make_unique<UploadBuffer<VertexForMap>>(md3dDevice.Get(), (UINT)vertices.size(), false);
+	mEditor.Terrain().MarkAllDirty();
 
-	MapVB = std::make_unique<UploadBuffer<VertexForMap>>(md3dDevice.Get(), MapV.size(), false);
 
-	for (UINT i = 0; i < 255; ++i)
-	{
-		for (UINT j = 0; j < 255; ++j)
-		{
-			indices.push_back(i * 256 + j);
-			indices.push_back(i * 256 + j + 1);
-			indices.push_back(i * 256 + j + 256);
-			
-			indices.push_back(i * 256 + j + 1);
-			indices.push_back(i * 256 + j + 257);
-			indices.push_back(i * 256 + j + 256);
-		}
-	}
-
-
-	UINT vbByteSize = (UINT)MapV.size()*sizeof(VertexForMap);
+	UINT vbByteSize = (UINT)vertices.size()*sizeof(VertexForMap);
 	UINT ibByteSize = (UINT)indices.size()*sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -840,10 +1100,10 @@ void BlendApp::BuildWavesGeometry()
 
 	/*
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), MapV.data(), vbByteSize);
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), MapV.data(), vbByteSize, geo->VertexBufferUploader);*/
+		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);*/
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
@@ -1045,15 +1305,14 @@ void BlendApp::BuildFrameResources()
 {
     for(int i = 0; i < gNumFrameResources; ++i)
     {
-        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1));
+        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1, (UINT)MaxCommandChunks - 1));
     }
 	
-	YTML1_1::ReadCSS("somestyle.css", mStyle);	
+	YTML1_1::ReadCSS(UIStylePath, mStyle);	
+	YTML1_1::ReadYTML1_1Parallel(UIDocumentPath, mYTMLTree, mStyle, mUIBiggestId, *mJobs);
 
-	std::vector<std::string> keys;
-	
-	size_t muid = 1;
-	YTML1_1::ReadYTML1_1("sample.html", mYTMLTree, mStyle, muid);
+	if (!mUIWatcher.Watch(UIStylePath) || !mUIWatcher.Watch(UIDocumentPath))
+		OutputDebugStringA("UI hot reload is off: cannot watch the UI files\n");
 }
 
 void BlendApp::BuildMaterials()
@@ -1130,61 +1389,132 @@ void BlendApp::BuildRenderItems()
 	mRitems["BOX"] = std::move(boxRitem);
 }
 
-void BlendApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList)
+void BlendApp::BuildWorkerCommandLists()
 {
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT uiCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(UIConsts));
-    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
-
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto UICB = mCurrFrameResource->UICB->Resource();
+	mCommandChunks.resize(std::min<size_t>(MaxCommandChunks, mJobs->ThreadCount()));
 
+	mWorkerCommandLists.resize(mCommandChunks.size() - 1);
+	for (size_t k = 0; k < mWorkerCommandLists.size(); ++k)
 	{
-		auto& ri = mRitems["GROUND"];
-
-		mCommandList->SetPipelineState(mPSOs["Map"].Get());
-		mCommandList->SetGraphicsRootSignature(mRootSignature["Map"].Get());
-		mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+		ThrowIfFailed(md3dDevice->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			mFrameResources[0]->WorkerCmdListAllocs[k].Get(),
+			nullptr,
+			IID_PPV_ARGS(mWorkerCommandLists[k].GetAddressOf())));
 
-		ri->Geo->VertexBufferGPU = MapVB->Resource();
+		// Start off in a closed state, DrawRenderItems resets them before recording.
+		ThrowIfFailed(mWorkerCommandLists[k]->Close());
+	}
+}
 
-		mCommandList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		mCommandList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		mCommandList->IASetPrimitiveTopology(ri->PrimitiveType);
+void BlendApp::SetupCommandList(ID3D12GraphicsCommandList* cmdList)
+{
+	// State that is not inherited between command lists.
+	cmdList->RSSetViewports(1, &mScreenViewport);
+	cmdList->RSSetScissorRects(1, &mScissorRect);
+	cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex0(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex0.Offset(0, mCbvSrvDescriptorSize);
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
+void BlendApp::DrawRenderItems()
+{
+	PROFILE_ZONE("DrawRenderItems");
 
-		mCommandList->SetGraphicsRootDescriptorTable(0, tex0);
-		mCommandList->SetGraphicsRootConstantBufferView(1, objCBAddress);
+	// The ground, then every UI element in one instanced draw.
+	mCommandStream.Clear();
+	RecordGround(mCommandStream);
+	RecordUI(mCommandStream);
 
-		mCommandList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+	// Two draws stay on mCommandList; only scenes of many draws split.
+	mActiveChunks = SplitCommandStream(mCommandStream, mMinDrawsPerChunk, mCommandChunks);
+	if (mActiveChunks == 1)
+	{
+		D3D12CommandBackend backend;
+		backend.SetCommandList(mCommandList.Get());
+		backend.Execute(mCommandStream);
+		return;
 	}
+
+	mJobs->ParallelFor(mActiveChunks, 1, [&](size_t begin, size_t end)
 	{
-		const auto& geo = mGeometries.at("rect");
-		mCommandList->SetPipelineState(mPSOs["UI"].Get());
-		mCommandList->SetGraphicsRootSignature(mRootSignature["UI"].Get());
-		mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
-		
-		mCommandList->IASetVertexBuffers(0, 1, &geo->VertexBufferView());
-		mCommandList->IASetIndexBuffer(&geo->IndexBufferView());
-		mCommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-
-		//CD3DX12_GPU_DESCRIPTOR_HANDLE tex0(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		//mCommandList->SetGraphicsRootDescriptorTable(0, tex0);
-		
-		const auto& arg = geo->DrawArgs.begin()->second;
-		for (size_t i = UICBSize - 1; i < UICBSize; --i)
+		for (size_t k = begin; k < end; ++k)
 		{
-			mCommandList->SetGraphicsRootConstantBufferView(0, UICB->GetGPUVirtualAddress() + i * uiCBByteSize);
-			mCommandList->DrawIndexedInstanced(arg.IndexCount, 1, arg.StartIndexLocation, arg.BaseVertexLocation, 0);
+			PROFILE_ZONE("RecordChunk");
+			ID3D12GraphicsCommandList* cmdList = mCommandList.Get();
+			if (k != 0)
+			{
+				auto& alloc = mDrawFrameResource->WorkerCmdListAllocs[k - 1];
+				ThrowIfFailed(alloc->Reset());
+				cmdList = mWorkerCommandLists[k - 1].Get();
+				ThrowIfFailed(cmdList->Reset(alloc.Get(), nullptr));
+				SetupCommandList(cmdList);
+			}
+
+			D3D12CommandBackend backend;
+			backend.SetCommandList(cmdList);
+			backend.Execute(mCommandChunks[k]);
 		}
-	}
+	});
+}
+
+static StreamMesh StreamMeshOf(const MeshGeometry& geo, UINT topology, UINT indexCount, UINT startIndexLocation, int baseVertexLocation)
+{
+	auto vbv = geo.VertexBufferView();
+	auto ibv = geo.IndexBufferView();
+
+	StreamMesh mesh;
+	mesh.Vertices = { vbv.BufferLocation, vbv.SizeInBytes, vbv.StrideInBytes };
+	mesh.Indices = { ibv.BufferLocation, ibv.SizeInBytes, (std::uint32_t)ibv.Format };
+	mesh.Topology = topology;
+	mesh.IndexCount = indexCount;
+	mesh.StartIndexLocation = startIndexLocation;
+	mesh.BaseVertexLocation = baseVertexLocation;
+	return mesh;
+}
+
+void BlendApp::RecordGround(CommandStream& stream)
+{
+	auto passCB = mDrawFrameResource->PassCB->Resource();
+	auto objectCB = mDrawFrameResource->ObjectCB->Resource();
+
+    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	auto& ri = mRitems.at("GROUND");
+	ri->Geo->VertexBufferGPU = MapVB->Resource();
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE tex0(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	tex0.Offset(0, mCbvSrvDescriptorSize);
+
+	GroundDraw draw;
+	draw.Pso = mPSOs.at("Map").Get();
+	draw.RootSignature = mRootSignature.at("Map").Get();
+	draw.PassCB = passCB->GetGPUVirtualAddress();
+	draw.ObjectCB = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
+	draw.Textures = tex0.ptr;
+	draw.Mesh = StreamMeshOf(*ri->Geo, ri->PrimitiveType, ri->IndexCount, ri->StartIndexLocation, ri->BaseVertexLocation);
+	RecordGroundDraw(stream, draw);
+}
+
+void BlendApp::RecordUI(CommandStream& stream)
+{
+	const auto& geo = mGeometries.at("rect");
+	const auto& arg = geo->DrawArgs.begin()->second;
+
+	//CD3DX12_GPU_DESCRIPTOR_HANDLE tex0(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	//stream.SetRootDescriptorTable(0, tex0.ptr);
+
+	UIDraw draw;
+	draw.Pso = mPSOs.at("UI").Get();
+	draw.RootSignature = mRootSignature.at("UI").Get();
+	draw.PassCB = mDrawFrameResource->PassCB->Resource()->GetGPUVirtualAddress();
+	draw.Instances = mDrawFrameResource->UIInstances->Resource()->GetGPUVirtualAddress();
+	draw.DrawList = mDrawFrameResource->UIDrawList->Resource()->GetGPUVirtualAddress();
+	draw.Count = (std::uint32_t)mDrawFrameResource->UICount;
+	draw.Mesh = StreamMeshOf(*geo, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, arg.IndexCount, arg.StartIndexLocation, arg.BaseVertexLocation);
+	RecordUIDraw(stream, draw);
     // For each render item...
     /*for(size_t i = 0; i < ritems.size(); ++i)
     {
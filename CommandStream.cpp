@@ -0,0 +1,306 @@
+#include "CommandStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+void CommandStream::SetPipelineState(const void* pso, const char* name)
+{
+	Command c;
+	c.Type = CommandType::SetPipelineState;
+	c.State = { pso, name };
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetRootSignature(const void* rootSig, const char* name)
+{
+	Command c;
+	c.Type = CommandType::SetRootSignature;
+	c.State = { rootSig, name };
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetVertexBuffer(std::uint32_t slot, std::uint64_t location, std::uint32_t sizeInBytes, std::uint32_t stride)
+{
+	Command c;
+	c.Type = CommandType::SetVertexBuffer;
+	c.Slot = slot;
+	c.Buffer = { location, sizeInBytes, stride };
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetIndexBuffer(std::uint64_t location, std::uint32_t sizeInBytes, std::uint32_t format)
+{
+	Command c;
+	c.Type = CommandType::SetIndexBuffer;
+	c.Buffer = { location, sizeInBytes, format };
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetPrimitiveTopology(std::uint32_t topology)
+{
+	Command c;
+	c.Type = CommandType::SetPrimitiveTopology;
+	c.Topology = topology;
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetRootDescriptorTable(std::uint32_t rootIndex, std::uint64_t gpuDescriptor)
+{
+	Command c;
+	c.Type = CommandType::SetRootDescriptorTable;
+	c.Slot = rootIndex;
+	c.Address = gpuDescriptor;
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetRootConstantBufferView(std::uint32_t rootIndex, std::uint64_t gpuAddress)
+{
+	Command c;
+	c.Type = CommandType::SetRootConstantBufferView;
+	c.Slot = rootIndex;
+	c.Address = gpuAddress;
+	mCommands.push_back(c);
+}
+
+void CommandStream::SetRootShaderResourceView(std::uint32_t rootIndex, std::uint64_t gpuAddress)
+{
+	Command c;
+	c.Type = CommandType::SetRootShaderResourceView;
+	c.Slot = rootIndex;
+	c.Address = gpuAddress;
+	mCommands.push_back(c);
+}
+
+void CommandStream::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+	std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation)
+{
+	Command c;
+	c.Type = CommandType::DrawIndexedInstanced;
+	c.Draw = { indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation };
+	mCommands.push_back(c);
+}
+
+namespace
+{
+	// FNV-1a
+	inline void HashBytes(std::uint64_t& h, const void* data, size_t size)
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			h ^= p[i];
+			h *= 1099511628211ull;
+		}
+	}
+}
+
+std::uint64_t CommandStream::Hash()const
+{
+	std::uint64_t h = 14695981039346656037ull;
+	for (const auto& c : mCommands)
+	{
+		HashBytes(h, &c.Type, sizeof(c.Type));
+		HashBytes(h, &c.Slot, sizeof(c.Slot));
+		switch (c.Type)
+		{
+		case CommandType::SetPipelineState:
+		case CommandType::SetRootSignature:
+			if (c.State.Name != nullptr) HashBytes(h, c.State.Name, strlen(c.State.Name));
+			break;
+		case CommandType::SetVertexBuffer:
+		case CommandType::SetIndexBuffer:
+			HashBytes(h, &c.Buffer.SizeInBytes, sizeof(c.Buffer.SizeInBytes));
+			HashBytes(h, &c.Buffer.StrideOrFormat, sizeof(c.Buffer.StrideOrFormat));
+			break;
+		case CommandType::SetPrimitiveTopology:
+			HashBytes(h, &c.Topology, sizeof(c.Topology));
+			break;
+		case CommandType::DrawIndexedInstanced:
+			HashBytes(h, &c.Draw, sizeof(c.Draw));
+			break;
+		default:
+			break;
+		}
+	}
+	return h;
+}
+
+void CommandStream::Dump(std::ostream& os)const
+{
+	for (const auto& c : mCommands)
+	{
+		os << CommandTypeName(c.Type);
+		switch (c.Type)
+		{
+		case CommandType::SetPipelineState:
+		case CommandType::SetRootSignature:
+			os << " " << (c.State.Name != nullptr ? c.State.Name : "?");
+			break;
+		case CommandType::SetVertexBuffer:
+			os << " slot=" << c.Slot << " size=" << c.Buffer.SizeInBytes << " stride=" << c.Buffer.StrideOrFormat;
+			break;
+		case CommandType::SetIndexBuffer:
+			os << " size=" << c.Buffer.SizeInBytes << " format=" << c.Buffer.StrideOrFormat;
+			break;
+		case CommandType::SetPrimitiveTopology:
+			os << " " << c.Topology;
+			break;
+		case CommandType::SetRootDescriptorTable:
+		case CommandType::SetRootConstantBufferView:
+		case CommandType::SetRootShaderResourceView:
+			os << " root=" << c.Slot;
+			break;
+		case CommandType::DrawIndexedInstanced:
+			os << " indices=" << c.Draw.IndexCountPerInstance << " instances=" << c.Draw.InstanceCount
+				<< " start=" << c.Draw.StartIndexLocation << " base=" << c.Draw.BaseVertexLocation
+				<< " startInstance=" << c.Draw.StartInstanceLocation;
+			break;
+		default:
+			break;
+		}
+		os << "\n";
+	}
+}
+
+void NullCommandBackend::Execute(const CommandStream& stream)
+{
+	bool pso = false, rootSig = false, indexBuffer = false, topology = false, vertexBuffer = false;
+
+	size_t index = 0;
+	for (const auto& c : stream.Commands())
+	{
+		++mStats.Commands;
+		if (c.Type < CommandType::Count) ++mStats.CommandsByType[(size_t)c.Type];
+
+		switch (c.Type)
+		{
+		case CommandType::SetPipelineState:
+			pso = c.State.Object != nullptr;
+			++mStats.StateChanges;
+			break;
+		case CommandType::SetRootSignature:
+			rootSig = c.State.Object != nullptr;
+			++mStats.StateChanges;
+			break;
+		case CommandType::SetVertexBuffer:
+			vertexBuffer = c.Buffer.SizeInBytes != 0;
+			break;
+		case CommandType::SetIndexBuffer:
+			indexBuffer = c.Buffer.SizeInBytes != 0;
+			break;
+		case CommandType::SetPrimitiveTopology:
+			topology = c.Topology != 0;
+			break;
+		case CommandType::SetRootDescriptorTable:
+		case CommandType::SetRootConstantBufferView:
+		case CommandType::SetRootShaderResourceView:
+			if (!rootSig)
+				mErrors.push_back("#" + std::to_string(index) + " " + CommandTypeName(c.Type) + " before SetRootSignature");
+			break;
+		case CommandType::DrawIndexedInstanced:
+			++mStats.Draws;
+			mStats.Instances += c.Draw.InstanceCount;
+			mStats.Indices += (std::uint64_t)c.Draw.IndexCountPerInstance * c.Draw.InstanceCount;
+			if (!pso || !rootSig || !indexBuffer || !topology || !vertexBuffer)
+				mErrors.push_back("#" + std::to_string(index) + " DrawIndexedInstanced with incomplete state");
+			if (c.Draw.IndexCountPerInstance == 0 || c.Draw.InstanceCount == 0)
+				mErrors.push_back("#" + std::to_string(index) + " empty DrawIndexedInstanced");
+			break;
+		default:
+			mErrors.push_back("#" + std::to_string(index) + " unknown command");
+			break;
+		}
+		++index;
+	}
+}
+
+void NullCommandBackend::Reset()
+{
+	mStats = Stats();
+	mErrors.clear();
+}
+
+const char* CommandTypeName(CommandType type)
+{
+	switch (type)
+	{
+	case CommandType::SetPipelineState: return "SetPipelineState";
+	case CommandType::SetRootSignature: return "SetRootSignature";
+	case CommandType::SetVertexBuffer: return "SetVertexBuffer";
+	case CommandType::SetIndexBuffer: return "SetIndexBuffer";
+	case CommandType::SetPrimitiveTopology: return "SetPrimitiveTopology";
+	case CommandType::SetRootDescriptorTable: return "SetRootDescriptorTable";
+	case CommandType::SetRootConstantBufferView: return "SetRootConstantBufferView";
+	case CommandType::SetRootShaderResourceView: return "SetRootShaderResourceView";
+	case CommandType::DrawIndexedInstanced: return "DrawIndexedInstanced";
+	default: return "Unknown";
+	}
+}
+
+size_t SplitCommandStream(const CommandStream& stream, size_t minDrawsPerChunk, std::vector<CommandStream>& chunks)
+{
+	const auto& commands = stream.Commands();
+	const size_t draws = (size_t)std::count_if(commands.begin(), commands.end(),
+		[](const Command& c) { return c.Type == CommandType::DrawIndexedInstanced; });
+	const size_t count = std::min(chunks.size(), draws / std::max<size_t>(1, minDrawsPerChunk));
+	if (count <= 1) return 1;
+
+	for (size_t k = 0; k < count; ++k) chunks[k].Clear();
+
+	// What is bound after the commands seen so far.
+	const Command* pso = nullptr;
+	const Command* rootSig = nullptr;
+	const Command* indexBuffer = nullptr;
+	const Command* topology = nullptr;
+	std::vector<const Command*> vertexBuffers, rootParameters;
+	auto bind = [](std::vector<const Command*>& slots, const Command& c)
+	{
+		if (slots.size() <= c.Slot) slots.resize(c.Slot + 1, nullptr);
+		slots[c.Slot] = &c;
+	};
+
+	// Commands are copied in runs, up to each chunk's last draw.
+	const Command* run = commands.data();
+	size_t chunk = 0, drawn = 0, end = draws / count;
+	for (const auto& c : commands)
+	{
+		switch (c.Type)
+		{
+		case CommandType::SetPipelineState: pso = &c; break;
+		case CommandType::SetRootSignature:
+			// A different root signature drops the root arguments.
+			if (rootSig == nullptr || rootSig->State.Object != c.State.Object) rootParameters.clear();
+			rootSig = &c;
+			break;
+		case CommandType::SetVertexBuffer: bind(vertexBuffers, c); break;
+		case CommandType::SetIndexBuffer: indexBuffer = &c; break;
+		case CommandType::SetPrimitiveTopology: topology = &c; break;
+		case CommandType::SetRootDescriptorTable:
+		case CommandType::SetRootConstantBufferView:
+		case CommandType::SetRootShaderResourceView:
+			bind(rootParameters, c);
+			break;
+		case CommandType::DrawIndexedInstanced:
+		{
+			if (++drawn != end || chunk + 1 == count) break;
+			chunks[chunk].Append(run, &c + 1);
+			run = &c + 1;
+
+			// The next chunk starts from the state this draw saw.
+			end = draws * (++chunk + 1) / count;
+			CommandStream& next = chunks[chunk];
+			if (rootSig != nullptr) next.Append(*rootSig);
+			if (pso != nullptr) next.Append(*pso);
+			for (const Command* vb : vertexBuffers) if (vb != nullptr) next.Append(*vb);
+			if (indexBuffer != nullptr) next.Append(*indexBuffer);
+			if (topology != nullptr) next.Append(*topology);
+			for (const Command* p : rootParameters) if (p != nullptr) next.Append(*p);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	chunks[chunk].Append(run, commands.data() + commands.size());
+	return count;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Backend-agnostic command stream.  Frame code records pipeline binds, buffer
+// binds, root constants and draws here instead of talking to a command list
+// directly, and a backend replays the stream.  Nothing in this header depends
+// on D3D12, so it can be recorded and checked on machines without a GPU.
+
+enum class CommandType : std::uint8_t
+{
+	SetPipelineState = 0,
+	SetRootSignature,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetPrimitiveTopology,
+	SetRootDescriptorTable,
+	SetRootConstantBufferView,
+	SetRootShaderResourceView,
+	DrawIndexedInstanced,
+	Count
+};
+
+struct Command
+{
+	CommandType Type = CommandType::Count;
+
+	// Root parameter index for root bindings, input slot for vertex buffers.
+	std::uint32_t Slot = 0;
+
+	union
+	{
+		// Pipeline state / root signature.  Name is a string literal so that
+		// streams can be compared between runs where the pointers differ.
+		struct { const void* Object; const char* Name; } State;
+
+		// Vertex buffer (StrideOrFormat is the stride) or index buffer
+		// (StrideOrFormat is the DXGI_FORMAT).
+		struct { std::uint64_t Location; std::uint32_t SizeInBytes; std::uint32_t StrideOrFormat; } Buffer;
+
+		// GPU virtual address or GPU descriptor handle.
+		std::uint64_t Address;
+
+		std::uint32_t Topology;
+
+		struct
+		{
+			std::uint32_t IndexCountPerInstance;
+			std::uint32_t InstanceCount;
+			std::uint32_t StartIndexLocation;
+			std::int32_t BaseVertexLocation;
+			std::uint32_t StartInstanceLocation;
+		} Draw;
+	};
+
+	Command() : Draw{ 0, 0, 0, 0, 0 } {}
+};
+
+class CommandStream
+{
+public:
+	void SetPipelineState(const void* pso, const char* name);
+	void SetRootSignature(const void* rootSig, const char* name);
+	void SetVertexBuffer(std::uint32_t slot, std::uint64_t location, std::uint32_t sizeInBytes, std::uint32_t stride);
+	void SetIndexBuffer(std::uint64_t location, std::uint32_t sizeInBytes, std::uint32_t format);
+	void SetPrimitiveTopology(std::uint32_t topology);
+	void SetRootDescriptorTable(std::uint32_t rootIndex, std::uint64_t gpuDescriptor);
+	void SetRootConstantBufferView(std::uint32_t rootIndex, std::uint64_t gpuAddress);
+	void SetRootShaderResourceView(std::uint32_t rootIndex, std::uint64_t gpuAddress);
+	void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+		std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation);
+
+	// Appends commands as recorded elsewhere.
+	void Append(const Command& command) { mCommands.push_back(command); }
+	void Append(const Command* begin, const Command* end) { mCommands.insert(mCommands.end(), begin, end); }
+
+	// Keeps the capacity so recording a frame does not allocate once warmed up.
+	void Clear() { mCommands.clear(); }
+
+	const std::vector<Command>& Commands()const { return mCommands; }
+	size_t Size()const { return mCommands.size(); }
+
+	// Hash of the stream structure (types, slots, counts and object names).
+	// Addresses are left out since they are not stable between runs.
+	std::uint64_t Hash()const;
+
+	// One command per line; meant for diffing streams between builds.
+	void Dump(std::ostream& os)const;
+
+private:
+	std::vector<Command> mCommands;
+};
+
+class ICommandBackend
+{
+public:
+	virtual ~ICommandBackend() = default;
+	virtual void Execute(const CommandStream& stream) = 0;
+};
+
+// Consumes streams without a device.  Counts what would have been submitted
+// and checks that every draw has the state it needs bound.
+class NullCommandBackend : public ICommandBackend
+{
+public:
+	struct Stats
+	{
+		std::uint64_t Commands = 0;
+		std::uint64_t Draws = 0;
+		std::uint64_t Instances = 0;
+		std::uint64_t Indices = 0;
+		std::uint64_t StateChanges = 0;
+		std::uint64_t CommandsByType[(size_t)CommandType::Count] = {};
+	};
+
+	virtual void Execute(const CommandStream& stream)override;
+
+	const Stats& GetStats()const { return mStats; }
+	const std::vector<std::string>& Errors()const { return mErrors; }
+	void Reset();
+
+private:
+	Stats mStats;
+	std::vector<std::string> mErrors;
+};
+
+const char* CommandTypeName(CommandType type);
+
+// Splits stream by draws into chunks that can be replayed on their own
+// command lists and submitted in order, one per element of chunks at most,
+// with at least minDrawsPerChunk draws each.  Command lists inherit no state,
+// so every chunk after the first starts by binding again what its first draw
+// sees bound.  Returns the number of chunks filled; 1 means the stream is too
+// small to split, and chunks is left alone for the caller to replay stream.
+size_t SplitCommandStream(const CommandStream& stream, size_t minDrawsPerChunk, std::vector<CommandStream>& chunks);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Single-slot handoff between one producer and one consumer thread.  The
+// consumer releases the slot once it is done with the value, not when it
+// takes it, so the producer is never more than one value ahead of the work
+// on it.  The slot state is an atomic, so in the steady state a round-trip
+// is three atomic stores and no locks.  A side that has to wait spins briefly and
+// only then parks on a condition variable, which the other side signals when
+// it sees a parked waiter.
+template<typename T>
+class FrameHandoff
+{
+public:
+	// Blocks until the consumer released the previous value.
+	void Publish(const T& value)
+	{
+		WaitFor(Empty);
+		mValue = value;
+		mState.store(Full);
+		WakeWaiter();
+	}
+
+	// Blocks until a value was published.  Every value taken has to be
+	// released before the next one can be published.
+	T Consume()
+	{
+		WaitFor(Full);
+		T value = mValue;
+		mState.store(Taken);
+		return value;
+	}
+
+	// The consumer is done with the value it took.
+	void Release()
+	{
+		mState.store(Empty);
+		WakeWaiter();
+	}
+
+	bool IsEmpty()const { return mState.load(std::memory_order_acquire) == Empty; }
+
+private:
+	enum State : int { Empty = 0, Full = 1, Taken = 2 };
+
+	// Spins on the slot before parking the thread.
+	static const int SpinCount = 4000;
+
+	void WaitFor(State state)
+	{
+		for (int i = 0; i < SpinCount; ++i)
+		{
+			if (mState.load(std::memory_order_acquire) == state) return;
+			if ((i & 63) == 63) std::this_thread::yield();
+		}
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mWaiting.store(true);
+		mWake.wait(lock, [&]() { return mState.load() == state; });
+		mWaiting.store(false);
+	}
+
+	void WakeWaiter()
+	{
+		if (mWaiting.load())
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mWake.notify_one();
+		}
+	}
+
+	T mValue{};
+	std::atomic<int> mState{ Empty };
+	std::atomic<bool> mWaiting{ false };
+	std::mutex mMutex;
+	std::condition_variable mWake;
+};
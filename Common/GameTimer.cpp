@@ -7,7 +7,8 @@
 
 GameTimer::GameTimer()
 : mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false),
+  mFixedStep(0.0), mFixedTime(0.0)
 {
 	__int64 countsPerSec;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
@@ -18,6 +19,11 @@ GameTimer::GameTimer()
 // time when the clock is stopped.
 float GameTimer::TotalTime()const
 {
+	if( mFixedStep > 0.0 )
+	{
+		return (float)mFixedTime;
+	}
+
 	// If we are stopped, do not count the time that has passed since we stopped.
 	// Moreover, if we previously already had a pause, the distance 
 	// mStopTime - mBaseTime includes paused time, which we do not want to count.
@@ -62,6 +68,12 @@ void GameTimer::Reset()
 	mPrevTime = currTime;
 	mStopTime = 0;
 	mStopped  = false;
+	mFixedTime = 0.0;
+}
+
+void GameTimer::SetFixedStep(double seconds)
+{
+	mFixedStep = seconds;
 }
 
 void GameTimer::Start()
@@ -106,6 +118,13 @@ void GameTimer::Tick()
 		return;
 	}
 
+	if( mFixedStep > 0.0 )
+	{
+		mDeltaTime = mFixedStep;
+		mFixedTime += mFixedStep;
+		return;
+	}
+
 	__int64 currTime;
 	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
 	mCurrTime = currTime;
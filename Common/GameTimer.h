@@ -18,6 +18,10 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// With a step > 0 every Tick advances the clock by exactly that many
+	// seconds, independent of wall time, so runs can be reproduced.
+	void SetFixedStep(double seconds);
+
 private:
 	double mSecondsPerCount;
 	double mDeltaTime;
@@ -29,6 +33,9 @@ private:
 	__int64 mCurrTime;
 
 	bool mStopped;
+
+	double mFixedStep;
+	double mFixedTime;
 };
 
 #endif // GAMETIMER_H
\ No newline at end of file
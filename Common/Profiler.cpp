@@ -0,0 +1,133 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+namespace Profiler
+{
+	namespace
+	{
+		std::mutex gRegistryMutex;
+
+		// Buffers live as long as the process so exports stay valid after a
+		// thread exits.
+		std::vector<std::unique_ptr<ThreadBuffer>>& Registry()
+		{
+			static std::vector<std::unique_ptr<ThreadBuffer>> registry;
+			return registry;
+		}
+
+		const std::uint64_t gEpochNs = NowNs();
+
+		void WriteEscaped(std::ofstream& file, const char* s)
+		{
+			for (; *s != '\0'; ++s)
+			{
+				if (*s == '"' || *s == '\\') file << '\\';
+				file << *s;
+			}
+		}
+	}
+
+	std::uint64_t NowNs()
+	{
+		return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	ThreadBuffer& CurrentThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			// Once per thread.
+			std::lock_guard<std::mutex> lock(gRegistryMutex);
+			auto& registry = Registry();
+			registry.push_back(std::make_unique<ThreadBuffer>());
+			buffer = registry.back().get();
+			buffer->ThreadId = (std::uint32_t)registry.size();
+		}
+		return *buffer;
+	}
+
+	void SetThreadName(const char* name)
+	{
+		ThreadBuffer& b = CurrentThreadBuffer();
+		std::lock_guard<std::mutex> lock(gRegistryMutex);
+		b.ThreadName = name;
+	}
+
+	bool ExportChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) return false;
+
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+
+		std::lock_guard<std::mutex> lock(gRegistryMutex);
+		std::vector<Event> events;
+		for (const auto& b : Registry())
+		{
+			if (!b->ThreadName.empty())
+			{
+				file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->ThreadId
+					<< ",\"args\":{\"name\":\"";
+				WriteEscaped(file, b->ThreadName.c_str());
+				file << "\"}}";
+				first = false;
+			}
+
+			// Copy the live window, then drop whatever the owner overwrote
+			// while we were copying.
+			const std::uint64_t head = b->Head.load(std::memory_order_acquire);
+			std::uint64_t begin = head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0;
+			events.clear();
+			for (std::uint64_t i = begin; i < head; ++i) events.push_back(b->Events[i % ThreadBuffer::Capacity]);
+
+			const std::uint64_t after = b->Head.load(std::memory_order_acquire);
+			const std::uint64_t overwritten = after > ThreadBuffer::Capacity ? after - ThreadBuffer::Capacity : 0;
+			size_t skip = overwritten > begin ? (size_t)std::min<std::uint64_t>(overwritten - begin, events.size()) : 0;
+
+			for (size_t i = skip; i < events.size(); ++i)
+			{
+				const Event& e = events[i];
+				if (e.BeginNs < gEpochNs) continue;
+
+				file << (first ? "" : ",\n") << "{\"name\":\"";
+				WriteEscaped(file, e.Name);
+				file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->ThreadId
+					<< ",\"ts\":" << (e.BeginNs - gEpochNs) / 1000.0
+					<< ",\"dur\":" << (e.EndNs - e.BeginNs) / 1000.0 << "}";
+				first = false;
+			}
+		}
+
+		file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		return true;
+	}
+}
+
+FrameTimeHistogram::FrameTimeHistogram(size_t window)
+	: mSamples(window, 0.f)
+{
+}
+
+void FrameTimeHistogram::AddSample(float ms)
+{
+	mSamples[mNext] = ms;
+	mNext = (mNext + 1) % mSamples.size();
+	if (mCount < mSamples.size()) ++mCount;
+}
+
+float FrameTimeHistogram::Percentile(float p)const
+{
+	if (mCount == 0) return 0.f;
+
+	mScratch.assign(mSamples.begin(), mSamples.begin() + mCount);
+	size_t k = (size_t)(std::min(std::max(p, 0.f), 1.f) * (mCount - 1) + 0.5f);
+	std::nth_element(mScratch.begin(), mScratch.begin() + k, mScratch.end());
+	return mScratch[k];
+}
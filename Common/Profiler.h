@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Hierarchical CPU zone profiler.  Zones are timed with a nanosecond clock and
+// written to a ring buffer owned by the recording thread, so recording takes
+// no locks; the buffers are only walked when a capture is exported.
+namespace Profiler
+{
+	std::uint64_t NowNs();
+
+	struct Event
+	{
+		const char* Name;   // must outlive the capture, use string literals
+		std::uint64_t BeginNs;
+		std::uint64_t EndNs;
+	};
+
+	// Per-thread storage for the last Capacity events.
+	struct ThreadBuffer
+	{
+		static const size_t Capacity = 16384;
+
+		Event Events[Capacity];
+		std::atomic<std::uint64_t> Head{ 0 };
+		std::uint32_t ThreadId = 0;
+		std::string ThreadName;
+	};
+
+	ThreadBuffer& CurrentThreadBuffer();
+
+	inline void Record(const char* name, std::uint64_t beginNs, std::uint64_t endNs)
+	{
+		ThreadBuffer& b = CurrentThreadBuffer();
+		const std::uint64_t head = b.Head.load(std::memory_order_relaxed);
+		b.Events[head % ThreadBuffer::Capacity] = { name, beginNs, endNs };
+		b.Head.store(head + 1, std::memory_order_release);
+	}
+
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name) : mName(name), mBegin(NowNs()) {}
+		~Zone() { Record(mName, mBegin, NowNs()); }
+
+		Zone(const Zone& rhs) = delete;
+		Zone& operator=(const Zone& rhs) = delete;
+
+	private:
+		const char* mName;
+		std::uint64_t mBegin;
+	};
+
+	// Shows up as the thread's name in the trace viewer.
+	void SetThreadName(const char* name);
+
+	// Writes every buffered zone of every thread as Chrome trace event JSON
+	// (chrome://tracing, Perfetto).  Returns false if the file can't be opened.
+	bool ExportChromeTrace(const std::string& path);
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+// Rolling window of frame times for percentile queries.
+class FrameTimeHistogram
+{
+public:
+	explicit FrameTimeHistogram(size_t window = 1024);
+
+	void AddSample(float ms);
+
+	// p in [0, 1].  Returns 0 without samples.
+	float Percentile(float p)const;
+
+	size_t Count()const { return mCount; }
+
+private:
+	std::vector<float> mSamples;
+	size_t mNext = 0;
+	size_t mCount = 0;
+	mutable std::vector<float> mScratch;
+};
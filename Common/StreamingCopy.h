@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STREAMING_COPY_SSE2 1
+#endif
+
+// Copies into write-combined memory (upload heaps) with non-temporal stores.
+// They bypass the cache and fill whole write-combining lines, so bulk writes
+// neither evict the CPU's working set nor turn into partial bus writes.  The
+// unaligned head and tail of the destination are plain stores.
+inline void StreamingCopy(void* dst, const void* src, size_t bytes)
+{
+#if STREAMING_COPY_SSE2
+	auto d = static_cast<unsigned char*>(dst);
+	auto s = static_cast<const unsigned char*>(src);
+
+	const size_t head = (16 - ((std::uintptr_t)d & 15)) & 15;
+	if (bytes < head + 64)
+	{
+		std::memcpy(d, s, bytes);
+		return;
+	}
+
+	std::memcpy(d, s, head);
+	d += head;
+	s += head;
+	bytes -= head;
+
+	for (; bytes >= 64; bytes -= 64, d += 64, s += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+		_mm_stream_si128((__m128i*)(d + 0), a);
+		_mm_stream_si128((__m128i*)(d + 16), b);
+		_mm_stream_si128((__m128i*)(d + 32), c);
+		_mm_stream_si128((__m128i*)(d + 48), e);
+	}
+	for (; bytes >= 16; bytes -= 16, d += 16, s += 16)
+		_mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+
+	std::memcpy(d, s, bytes);
+#else
+	std::memcpy(dst, src, bytes);
+#endif
+}
+
+// Orders earlier streaming stores before later stores.  Call once after a
+// batch of StreamingCopy, before the data is handed to the GPU or another
+// thread.
+inline void StreamingFence()
+{
+#if STREAMING_COPY_SSE2
+	_mm_sfence();
+#endif
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "StreamingCopy.h"
+#include <new>
+#include <utility>
 
 template<typename T>
 class UploadBuffer
@@ -55,6 +58,36 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies count elements starting at firstElement.  Packed elements go out
+    // as one streaming copy, call StreamingFence after the last write of the
+    // frame.  Constant buffer elements are padded to 256 bytes and would only
+    // fill partial lines, so they are copied one by one.
+    void CopyRange(size_t firstElement, const T* data, size_t count)
+    {
+        if(mElementByteSize == sizeof(T))
+        {
+            StreamingCopy(&mMappedData[firstElement*mElementByteSize], data, count*sizeof(T));
+            return;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+            memcpy(&mMappedData[(firstElement + i)*mElementByteSize], &data[i], sizeof(T));
+    }
+
+    // Constructs the element in the mapped memory instead of copying a
+    // temporary.  With no arguments it is default-initialized, so a plain
+    // struct is left for the caller to fill.  The memory is write-combined:
+    // write every member once and don't read it back.
+    template<typename... Args>
+    T& Emplace(size_t elementIndex, Args&&... args)
+    {
+        void* p = &mMappedData[elementIndex*mElementByteSize];
+        if constexpr(sizeof...(Args) == 0)
+            return *new(p) T;
+        else
+            return *new(p) T(std::forward<Args>(args)...);
+    }
+
 	BYTE* mMappedData = nullptr;
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
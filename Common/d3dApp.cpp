@@ -29,12 +29,19 @@ D3DApp::D3DApp(HINSTANCE hInstance)
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
     mApp = this;
+
+	mInvalidateEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
 }
 
 D3DApp::~D3DApp()
 {
+	StopRenderThread();
+
 	if(md3dDevice != nullptr)
 		FlushCommandQueue();
+
+	if(mInvalidateEvent != nullptr)
+		CloseHandle(mInvalidateEvent);
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -69,12 +76,67 @@ void D3DApp::Set4xMsaaState(bool value)
     }
 }
 
+void D3DApp::SetPipelined(bool value)
+{
+	assert(!mRenderThread.joinable());
+	mPipelined = value;
+}
+
+void D3DApp::SetRenderOnDemand(bool value)
+{
+	mRenderOnDemand = value;
+	Invalidate();
+}
+
+bool D3DApp::RenderOnDemand()const
+{
+	return mRenderOnDemand;
+}
+
+void D3DApp::Invalidate()
+{
+	mFrameDirty = true;
+	SetEvent(mInvalidateEvent);
+}
+
+UINT64 D3DApp::SkippedFrames()const
+{
+	return mIdleNs * 60 / 1000000000;
+}
+
+UINT D3DApp::PresentSyncInterval()const
+{
+	return mRenderOnDemand ? 1 : 0;
+}
+
 int D3DApp::Run()
 {
 	MSG msg = {0};
  
 	mTimer.Reset();
+	Profiler::SetThreadName("Main");
+
+	if(mPipelined)
+		mRenderThread = std::thread(&D3DApp::RenderThreadMain, this);
 
+	try
+	{
+		RunMessageLoop(msg);
+	}
+	catch(...)
+	{
+		// Draw is virtual, so the render thread has to stop before the
+		// derived app unwinds.
+		StopRenderThread();
+		throw;
+	}
+	StopRenderThread();
+
+	return (int)msg.wParam;
+}
+
+void D3DApp::RunMessageLoop(MSG& msg)
+{
 	while(msg.message != WM_QUIT)
 	{
 		// If there are Window messages then process them.
@@ -85,14 +147,43 @@ int D3DApp::Run()
 		}
 		// Otherwise, do animation/game stuff.
 		else
-        {	
+        {
+			// Nothing changed since the last frame, so don't draw another.
+			if(mRenderOnDemand && !mAppPaused && !mFrameDirty.exchange(false))
+			{
+				WaitForInvalidate();
+				continue;
+			}
+
+			PROFILE_ZONE("Frame");
+
 			mTimer.Tick();
 
 			if( !mAppPaused )
 			{
 				CalculateFrameStats();
 				Update(mTimer);	
-                Draw(mTimer);
+
+				if(mPipelined)
+				{
+					FramePacket packet;
+					packet.Timer = mTimer;
+					packet.FrameIndex = CurrentFrameIndex();
+
+					// Waits until the render thread finished drawing the
+					// previous frame, so Update never gets more than the one
+					// frame being drawn ahead of it.
+					++mPublishedFrames;
+					mRenderHandoff.Publish(packet);
+
+					if(mRenderFailed.load())
+						std::rethrow_exception(mRenderError);
+				}
+				else
+				{
+					mDrawFrameIndex = CurrentFrameIndex();
+					Draw(mTimer);
+				}
 			}
 			else
 			{
@@ -100,8 +191,84 @@ int D3DApp::Run()
 			}
         }
     }
+}
 
-	return (int)msg.wParam;
+void D3DApp::WaitForInvalidate()
+{
+	PROFILE_ZONE("Idle");
+
+	// Idle time is not animation time, and the first frame after it should not
+	// see one huge delta.
+	mTimer.Stop();
+
+	std::vector<HANDLE> handles(1, mInvalidateEvent);
+	DWORD timeout = INFINITE;
+	GetIdleWait(handles, timeout);
+	// One wait slot is taken by the message queue.
+	const DWORD count = (DWORD)std::min<size_t>(handles.size(), MAXIMUM_WAIT_OBJECTS - 1);
+
+	UINT64 start = Profiler::NowNs();
+	const DWORD result = MsgWaitForMultipleObjects(count, handles.data(), FALSE, timeout, QS_ALLINPUT);
+	mIdleNs += Profiler::NowNs() - start;
+
+	// Nobody invalidated for the app's handles or its timeout; the frame is
+	// what lets the app look at what woke it.
+	if(result == WAIT_TIMEOUT || (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + count))
+		mFrameDirty = true;
+	++mIdleWaits;
+
+	mTimer.Start();
+}
+
+void D3DApp::StopRenderThread()
+{
+	if(!mRenderThread.joinable())
+		return;
+
+	FramePacket quit;
+	quit.Quit = true;
+	mRenderHandoff.Publish(quit);
+	mRenderThread.join();
+}
+
+void D3DApp::RenderThreadMain()
+{
+	Profiler::SetThreadName("Render");
+
+	for(;;)
+	{
+		FramePacket packet = mRenderHandoff.Consume();
+		if(packet.Quit)
+			break;
+
+		// After a failure keep draining packets so the window thread does not
+		// block; it rethrows the error after its next publish.
+		if(!mRenderFailed.load())
+		{
+			try
+			{
+				mDrawFrameIndex = packet.FrameIndex;
+				Draw(packet.Timer);
+			}
+			catch(...)
+			{
+				mRenderError = std::current_exception();
+				mRenderFailed = true;
+			}
+		}
+
+		++mRenderedFrames;
+		mRenderHandoff.Release();
+	}
+}
+
+void D3DApp::WaitForRenderIdle()
+{
+	if(!mRenderThread.joinable() || std::this_thread::get_id() == mRenderThread.get_id())
+		return;
+
+	while(mRenderedFrames.load() != mPublishedFrames.load())
+		std::this_thread::yield();
 }
 
 bool D3DApp::Initialize()
@@ -145,6 +312,7 @@ void D3DApp::OnResize()
     assert(mDirectCmdListAlloc);
 
 	// Flush before changing any resources.
+	WaitForRenderIdle();
 	FlushCommandQueue();
 
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
@@ -237,6 +405,26 @@ void D3DApp::OnResize()
  
 LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
+	// Input and anything that changes the window needs a new frame.
+	switch( msg )
+	{
+	case WM_ACTIVATE:
+	case WM_SIZE:
+	case WM_EXITSIZEMOVE:
+	case WM_PAINT:
+	case WM_LBUTTONDOWN:
+	case WM_MBUTTONDOWN:
+	case WM_RBUTTONDOWN:
+	case WM_LBUTTONUP:
+	case WM_MBUTTONUP:
+	case WM_RBUTTONUP:
+	case WM_MOUSEMOVE:
+	case WM_KEYDOWN:
+	case WM_KEYUP:
+		Invalidate();
+		break;
+	}
+
 	switch( msg )
 	{
 	// WM_ACTIVATE is sent when the window is activated or deactivated.  
@@ -549,6 +737,7 @@ void D3DApp::FlushCommandQueue()
 	// Wait until the GPU has completed commands up to this fence point.
     if(mFence->GetCompletedValue() < mCurrentFence)
 	{
+		PROFILE_ZONE("FlushCommandQueue");
 		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
 		
         // Fire event when GPU hits current fence.  
@@ -588,6 +777,7 @@ void D3DApp::CalculateFrameStats()
 	static float timeElapsed = 0.0f;
 
 	frameCnt++;
+	mFrameTimes.AddSample(mTimer.DeltaTime() * 1000.0f);
 
 	// Compute averages over one second period.
 	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
@@ -600,7 +790,15 @@ void D3DApp::CalculateFrameStats()
 
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p50/p95/p99: " + to_wstring(mFrameTimes.Percentile(0.50f)) +
+            L" / " + to_wstring(mFrameTimes.Percentile(0.95f)) +
+            L" / " + to_wstring(mFrameTimes.Percentile(0.99f));
+
+		if(mRenderOnDemand)
+			windowText += L"   skipped: " + to_wstring(SkippedFrames()) +
+				L"   idle waits: " + to_wstring(mIdleWaits);
+		windowText += ExtraFrameStats();
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
@@ -11,6 +11,11 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameHandoff.h"
+#include "Profiler.h"
+#include <atomic>
+#include <exception>
+#include <thread>
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -38,6 +43,23 @@ public:
     void Set4xMsaaState(bool value);
 
 	int Run();
+
+	// Pipelined mode draws frame N on a render thread while the window thread
+	// updates frame N+1.  Must be set before Run.
+	void SetPipelined(bool value);
+
+	// Render-on-demand draws a frame only after Invalidate and otherwise
+	// blocks the window thread until a message arrives or someone calls
+	// Invalidate.  Input and window changes invalidate on their own; the app
+	// invalidates for anything it animates.  Presents wait for vsync.
+	void SetRenderOnDemand(bool value);
+	bool RenderOnDemand()const;
+
+	// Requests a new frame.  Can be called from any thread.
+	void Invalidate();
+
+	// Frames a continuous loop at 60 Hz would have drawn while idle.
+	UINT64 SkippedFrames()const;
  
     virtual bool Initialize();
     virtual LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -55,6 +77,23 @@ protected:
 
 	virtual void OnKeyDown(WPARAM p) {}
 	virtual void OnKeyUp(WPARAM p) {}
+
+	// Index of the per-frame data the last Update filled in.  Draw finds it in
+	// mDrawFrameIndex, which stays valid while Update prepares the next frame.
+	virtual int CurrentFrameIndex()const { return 0; }
+
+	// Appended to the frame stats in the caption, refreshed once a second.
+	virtual std::wstring ExtraFrameStats() { return std::wstring(); }
+
+	// Lets the render-on-demand idle wait wake for the app's own work.  The
+	// handles are waited on along with input, and timeoutMs bounds the wait;
+	// either one waking it draws a frame.
+	virtual void GetIdleWait(std::vector<HANDLE>& handles, DWORD& timeoutMs) { }
+
+	// Blocks until the render thread has drawn every published frame.  Anything
+	// touching render-thread state from the window thread (resizing the swap
+	// chain, recording on mCommandList) has to call this first.
+	void WaitForRenderIdle();
 protected:
 
 	bool InitMainWindow();
@@ -74,6 +113,12 @@ protected:
     void LogAdapterOutputs(IDXGIAdapter* adapter);
     void LogOutputDisplayModes(IDXGIOutput* output, DXGI_FORMAT format);
 
+	void RunMessageLoop(MSG& msg);
+	void WaitForInvalidate();
+	UINT PresentSyncInterval()const;
+	void RenderThreadMain();
+	void StopRenderThread();
+
 protected:
 
     static D3DApp* mApp;
@@ -92,6 +137,9 @@ protected:
 
 	// Used to keep track of the delta-time?and game time (?.4).
 	GameTimer mTimer;
+
+	// Frame times of the window thread, for the caption percentiles.
+	FrameTimeHistogram mFrameTimes;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
@@ -126,5 +174,28 @@ protected:
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	int mClientWidth = 800;
 	int mClientHeight = 600;
+
+	// What the window thread hands to the render thread per frame.
+	struct FramePacket
+	{
+		GameTimer Timer;
+		int FrameIndex = 0;
+		bool Quit = false;
+	};
+
+	bool mPipelined = false;
+	int mDrawFrameIndex = 0;
+	std::thread mRenderThread;
+	FrameHandoff<FramePacket> mRenderHandoff;
+	std::atomic<UINT64> mPublishedFrames{ 0 };
+	std::atomic<UINT64> mRenderedFrames{ 0 };
+	std::exception_ptr mRenderError;
+	std::atomic<bool> mRenderFailed{ false };
+
+	bool mRenderOnDemand = false;
+	std::atomic<bool> mFrameDirty{ true };
+	HANDLE mInvalidateEvent = nullptr;
+	UINT64 mIdleWaits = 0;
+	UINT64 mIdleNs = 0;
 };
 
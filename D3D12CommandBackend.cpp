@@ -0,0 +1,59 @@
+#include "D3D12CommandBackend.h"
+
+void D3D12CommandBackend::Execute(const CommandStream& stream)
+{
+	assert(mCommandList != nullptr);
+
+	for (const auto& c : stream.Commands())
+	{
+		switch (c.Type)
+		{
+		case CommandType::SetPipelineState:
+			mCommandList->SetPipelineState((ID3D12PipelineState*)c.State.Object);
+			break;
+		case CommandType::SetRootSignature:
+			mCommandList->SetGraphicsRootSignature((ID3D12RootSignature*)c.State.Object);
+			break;
+		case CommandType::SetVertexBuffer:
+		{
+			D3D12_VERTEX_BUFFER_VIEW vbv;
+			vbv.BufferLocation = c.Buffer.Location;
+			vbv.SizeInBytes = c.Buffer.SizeInBytes;
+			vbv.StrideInBytes = c.Buffer.StrideOrFormat;
+			mCommandList->IASetVertexBuffers(c.Slot, 1, &vbv);
+			break;
+		}
+		case CommandType::SetIndexBuffer:
+		{
+			D3D12_INDEX_BUFFER_VIEW ibv;
+			ibv.BufferLocation = c.Buffer.Location;
+			ibv.SizeInBytes = c.Buffer.SizeInBytes;
+			ibv.Format = (DXGI_FORMAT)c.Buffer.StrideOrFormat;
+			mCommandList->IASetIndexBuffer(&ibv);
+			break;
+		}
+		case CommandType::SetPrimitiveTopology:
+			mCommandList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)c.Topology);
+			break;
+		case CommandType::SetRootDescriptorTable:
+		{
+			D3D12_GPU_DESCRIPTOR_HANDLE handle;
+			handle.ptr = c.Address;
+			mCommandList->SetGraphicsRootDescriptorTable(c.Slot, handle);
+			break;
+		}
+		case CommandType::SetRootConstantBufferView:
+			mCommandList->SetGraphicsRootConstantBufferView(c.Slot, c.Address);
+			break;
+		case CommandType::SetRootShaderResourceView:
+			mCommandList->SetGraphicsRootShaderResourceView(c.Slot, c.Address);
+			break;
+		case CommandType::DrawIndexedInstanced:
+			mCommandList->DrawIndexedInstanced(c.Draw.IndexCountPerInstance, c.Draw.InstanceCount,
+				c.Draw.StartIndexLocation, c.Draw.BaseVertexLocation, c.Draw.StartInstanceLocation);
+			break;
+		default:
+			break;
+		}
+	}
+}
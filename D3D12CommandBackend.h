@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Common/d3dUtil.h"
+#include "CommandStream.h"
+
+// Replays a CommandStream onto a D3D12 graphics command list.
+class D3D12CommandBackend : public ICommandBackend
+{
+public:
+	void SetCommandList(ID3D12GraphicsCommandList* cmdList) { mCommandList = cmdList; }
+
+	virtual void Execute(const CommandStream& stream)override;
+
+private:
+	ID3D12GraphicsCommandList* mCommandList = nullptr;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Common/d3dUtil.h"
+#include "FramePacer.h"
+
+// IFrameFence over an ID3D12Fence.  The wait event is created once and reused
+// for every wait.
+class D3D12FrameFence : public IFrameFence
+{
+public:
+	explicit D3D12FrameFence(ID3D12Fence* fence);
+	D3D12FrameFence(const D3D12FrameFence& rhs) = delete;
+	D3D12FrameFence& operator=(const D3D12FrameFence& rhs) = delete;
+	~D3D12FrameFence();
+
+	virtual std::uint64_t CompletedValue()override;
+	virtual void WaitFor(std::uint64_t value)override;
+
+private:
+	ID3D12Fence* mFence = nullptr;
+	HANDLE mEvent = nullptr;
+};
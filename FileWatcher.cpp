@@ -0,0 +1,242 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+namespace
+{
+	bool SameName(const std::string& a, const std::string& b)
+	{
+#if defined(_WIN32)
+		return _stricmp(a.c_str(), b.c_str()) == 0;
+#else
+		return a == b;
+#endif
+	}
+
+	std::int64_t WriteTime(const std::string& path)
+	{
+		std::error_code ec;
+		auto time = std::filesystem::last_write_time(path, ec);
+		return ec ? 0 : (std::int64_t)time.time_since_epoch().count();
+	}
+}
+
+#if defined(_WIN32)
+
+struct FileWatcher::Platform
+{
+	struct Directory
+	{
+		std::string Path;
+		HANDLE Handle = INVALID_HANDLE_VALUE;
+		OVERLAPPED Overlapped = {};
+		alignas(DWORD) BYTE Buffer[16 * 1024];
+	};
+
+	std::vector<std::unique_ptr<Directory>> Directories;
+
+	~Platform()
+	{
+		for (auto& d : Directories)
+		{
+			CancelIo(d->Handle);
+			CloseHandle(d->Handle);
+			CloseHandle(d->Overlapped.hEvent);
+		}
+	}
+
+	static bool Issue(Directory& d)
+	{
+		ResetEvent(d.Overlapped.hEvent);
+		return ReadDirectoryChangesW(d.Handle, d.Buffer, sizeof(d.Buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+			nullptr, &d.Overlapped, nullptr) != FALSE;
+	}
+};
+
+#elif defined(__linux__)
+
+struct FileWatcher::Platform
+{
+	int Fd = -1;
+	// Watch descriptor to directory.
+	std::unordered_map<int, std::string> Directories;
+
+	Platform() { Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); }
+	~Platform() { if (Fd >= 0) close(Fd); }
+};
+
+#else
+
+struct FileWatcher::Platform
+{
+};
+
+#endif
+
+FileWatcher::FileWatcher(std::chrono::milliseconds settle)
+	: mSettle(settle), mPlatform(std::make_unique<Platform>())
+{
+}
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::Watch(const std::string& path)
+{
+	File file;
+	file.Path = path;
+	// Absolute, so two spellings of a directory are watched once.
+	std::error_code ec;
+	const std::filesystem::path p = std::filesystem::absolute(path, ec).lexically_normal();
+	if (ec) return false;
+	file.Directory = p.parent_path().string();
+	file.Name = p.filename().string();
+	file.WriteTime = WriteTime(path);
+
+	bool watched = false;
+	for (const auto& f : mFiles) watched |= f.Directory == file.Directory;
+
+#if defined(_WIN32)
+	if (!watched)
+	{
+		auto d = std::make_unique<Platform::Directory>();
+		d->Path = file.Directory;
+		d->Handle = CreateFileA(d->Path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (d->Handle == INVALID_HANDLE_VALUE) return false;
+		d->Overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!Platform::Issue(*d))
+		{
+			CloseHandle(d->Handle);
+			CloseHandle(d->Overlapped.hEvent);
+			return false;
+		}
+		mPlatform->Directories.push_back(std::move(d));
+	}
+#elif defined(__linux__)
+	if (!watched)
+	{
+		if (mPlatform->Fd < 0) return false;
+		const int wd = inotify_add_watch(mPlatform->Fd, file.Directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0) return false;
+		mPlatform->Directories[wd] = file.Directory;
+	}
+#endif
+
+	mFiles.push_back(std::move(file));
+	return true;
+}
+
+void FileWatcher::OnEvent(const std::string& directory, const std::string& name)
+{
+	for (auto& f : mFiles)
+	{
+		if (f.Directory != directory || !(name.empty() || SameName(f.Name, name))) continue;
+		f.Pending = true;
+		f.LastEvent = std::chrono::steady_clock::now();
+	}
+}
+
+bool FileWatcher::Pending()const
+{
+	for (const auto& f : mFiles)
+		if (f.Pending) return true;
+	return false;
+}
+
+std::chrono::milliseconds FileWatcher::UntilSettled()const
+{
+	const auto now = std::chrono::steady_clock::now();
+	auto until = std::chrono::milliseconds::max();
+	for (const auto& f : mFiles)
+	{
+		if (!f.Pending) continue;
+		// Rounded up, so a wait of this long does not wake just before.
+		const auto left = std::chrono::ceil<std::chrono::milliseconds>(f.LastEvent + mSettle - now);
+		until = std::min(until, std::max(left, std::chrono::milliseconds(0)));
+	}
+	return until;
+}
+
+void FileWatcher::WaitHandles(std::vector<void*>& handles)const
+{
+#if defined(_WIN32)
+	for (const auto& d : mPlatform->Directories) handles.push_back(d->Overlapped.hEvent);
+#else
+	(void)handles;
+#endif
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+#if defined(_WIN32)
+	for (auto& d : mPlatform->Directories)
+	{
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(d->Handle, &d->Overlapped, &bytes, FALSE)) continue;
+
+		// No bytes means the buffer overflowed; anything may have changed.
+		if (bytes == 0) OnEvent(d->Path, std::string());
+		for (DWORD offset = 0; bytes != 0;)
+		{
+			const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(d->Buffer + offset);
+			const int length = (int)(info->FileNameLength / sizeof(WCHAR));
+			std::string name(WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, nullptr, 0, nullptr, nullptr), '\0');
+			WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, name.data(), (int)name.size(), nullptr, nullptr);
+			if (!name.empty()) OnEvent(d->Path, name);
+
+			if (info->NextEntryOffset == 0) break;
+			offset += info->NextEntryOffset;
+		}
+		Platform::Issue(*d);
+	}
+#elif defined(__linux__)
+	alignas(inotify_event) char buffer[16 * 1024];
+	for (;;)
+	{
+		const ssize_t bytes = read(mPlatform->Fd, buffer, sizeof(buffer));
+		if (bytes <= 0) break;
+
+		for (ssize_t offset = 0; offset < bytes;)
+		{
+			const auto* e = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + e->len;
+
+			if (e->mask & IN_Q_OVERFLOW)
+			{
+				for (const auto& d : mPlatform->Directories) OnEvent(d.second, std::string());
+				continue;
+			}
+			auto itr = mPlatform->Directories.find(e->wd);
+			if (itr != mPlatform->Directories.end() && e->len > 0) OnEvent(itr->second, std::string(e->name));
+		}
+	}
+#else
+	for (auto& f : mFiles)
+	{
+		const std::int64_t time = WriteTime(f.Path);
+		if (time == f.WriteTime) continue;
+		f.WriteTime = time;
+		OnEvent(f.Directory, f.Name);
+	}
+#endif
+
+	const auto now = std::chrono::steady_clock::now();
+	for (auto& f : mFiles)
+	{
+		if (!f.Pending || now - f.LastEvent < mSettle) continue;
+		f.Pending = false;
+		f.WriteTime = WriteTime(f.Path);
+		changed.push_back(f.Path);
+	}
+}
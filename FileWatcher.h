@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reports files that changed on disk, for hot reload.  The directory of each
+// file is watched rather than the file itself, so saves that replace the file
+// (write to a temporary, then rename) are seen too.  A file is reported once
+// it has been quiet for the settle time, which keeps a save done in several
+// writes from being read half written.
+//
+// Uses ReadDirectoryChangesW on Windows and inotify on Linux; elsewhere it
+// falls back to comparing modification times on every poll.
+
+class FileWatcher
+{
+public:
+	explicit FileWatcher(std::chrono::milliseconds settle = std::chrono::milliseconds(50));
+	~FileWatcher();
+	FileWatcher(const FileWatcher& rhs) = delete;
+	FileWatcher& operator=(const FileWatcher& rhs) = delete;
+
+	// Returns false if the directory of path cannot be watched.
+	bool Watch(const std::string& path);
+
+	// Appends the watched paths, as given to Watch, that changed and settled
+	// since the last poll.  Never blocks.
+	void Poll(std::vector<std::string>& changed);
+
+	// True while a change was seen but has not settled yet.
+	bool Pending()const;
+
+	// Time until the first pending change settles: zero once one has, max()
+	// while none is pending.  An idle loop sleeps at most this long before
+	// it polls.
+	std::chrono::milliseconds UntilSettled()const;
+
+	// Appends the events that get signaled when a watched directory changes,
+	// as void* HANDLEs, for an idle loop to wait on.  They stay signaled until
+	// the next poll.  Windows only; elsewhere nothing is appended.
+	void WaitHandles(std::vector<void*>& handles)const;
+
+private:
+	struct Platform;
+
+	struct File
+	{
+		std::string Path;
+		std::string Directory;
+		std::string Name;
+		bool Pending = false;
+		std::chrono::steady_clock::time_point LastEvent;
+		// The polling fallback's view of the file.
+		std::int64_t WriteTime = 0;
+	};
+
+	// Called by the platform code for every name changed in a directory.
+	void OnEvent(const std::string& directory, const std::string& name);
+
+	std::chrono::milliseconds mSettle;
+	std::vector<File> mFiles;
+	std::unique_ptr<Platform> mPlatform;
+};
@@ -0,0 +1,41 @@
+#include "FrameCommands.h"
+
+namespace
+{
+	void BindMesh(CommandStream& stream, const StreamMesh& mesh)
+	{
+		stream.SetVertexBuffer(0, mesh.Vertices.Location, mesh.Vertices.SizeInBytes, mesh.Vertices.StrideOrFormat);
+		stream.SetIndexBuffer(mesh.Indices.Location, mesh.Indices.SizeInBytes, mesh.Indices.StrideOrFormat);
+		stream.SetPrimitiveTopology(mesh.Topology);
+	}
+}
+
+void RecordGroundDraw(CommandStream& stream, const GroundDraw& draw)
+{
+	stream.SetPipelineState(draw.Pso, "Map");
+	stream.SetRootSignature(draw.RootSignature, "Map");
+	stream.SetRootConstantBufferView(2, draw.PassCB);
+	BindMesh(stream, draw.Mesh);
+
+	stream.SetRootDescriptorTable(0, draw.Textures);
+	stream.SetRootConstantBufferView(1, draw.ObjectCB);
+
+	const StreamMesh& m = draw.Mesh;
+	stream.DrawIndexedInstanced(m.IndexCount, 1, m.StartIndexLocation, m.BaseVertexLocation, 0);
+}
+
+void RecordUIDraw(CommandStream& stream, const UIDraw& draw)
+{
+	if (draw.Count == 0) return;
+
+	stream.SetPipelineState(draw.Pso, "UI");
+	stream.SetRootSignature(draw.RootSignature, "UI");
+	stream.SetRootConstantBufferView(1, draw.PassCB);
+	BindMesh(stream, draw.Mesh);
+
+	stream.SetRootShaderResourceView(0, draw.Instances);
+	stream.SetRootShaderResourceView(2, draw.DrawList);
+
+	const StreamMesh& m = draw.Mesh;
+	stream.DrawIndexedInstanced(m.IndexCount, draw.Count, m.StartIndexLocation, m.BaseVertexLocation, 0);
+}
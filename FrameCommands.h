@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CommandStream.h"
+
+#include <cstdint>
+
+// The draws a frame is made of, recorded into a CommandStream from plain
+// values.  BlendApp fills these in from its device objects; without a device
+// any stand-in objects and addresses do, and the stream comes out the same,
+// so a headless build can record, count and diff the real frame.
+
+struct StreamBufferView
+{
+	std::uint64_t Location = 0;
+	std::uint32_t SizeInBytes = 0;
+	// The stride for a vertex buffer, the DXGI_FORMAT for an index buffer.
+	std::uint32_t StrideOrFormat = 0;
+};
+
+struct StreamMesh
+{
+	StreamBufferView Vertices;
+	StreamBufferView Indices;
+	std::uint32_t Topology = 0;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+};
+
+// The paintable ground, one draw with the "Map" pipeline.
+struct GroundDraw
+{
+	const void* Pso = nullptr;
+	const void* RootSignature = nullptr;
+	std::uint64_t PassCB = 0;
+	std::uint64_t ObjectCB = 0;
+	// GPU descriptor of the ground textures.
+	std::uint64_t Textures = 0;
+	StreamMesh Mesh;
+};
+
+// Every UI element as one instanced draw of the unit rect with the "UI"
+// pipeline.  Instance i draws the instance in slot DrawList[i], topmost
+// first, so the depth test keeps the first one drawn.
+struct UIDraw
+{
+	const void* Pso = nullptr;
+	const void* RootSignature = nullptr;
+	std::uint64_t PassCB = 0;
+	std::uint64_t Instances = 0;
+	std::uint64_t DrawList = 0;
+	std::uint32_t Count = 0;
+	StreamMesh Mesh;
+};
+
+void RecordGroundDraw(CommandStream& stream, const GroundDraw& draw);
+
+// Records nothing when there is no element to draw.
+void RecordUIDraw(CommandStream& stream, const UIDraw& draw);
@@ -0,0 +1,130 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+std::uint64_t SteadyFrameClock::NowNs()
+{
+	return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyFrameClock::SleepNs(std::uint64_t ns)
+{
+	std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+void SteadyFrameClock::Spin()
+{
+	std::this_thread::yield();
+}
+
+FramePacer::FramePacer(IFrameFence& fence, IFrameClock& clock)
+	: mFence(fence), mClock(clock)
+{
+	for (int i = 0; i < MaxFramesInFlight; ++i)
+	{
+		mSlotFrame[i] = 0;
+		mSlotFence[i] = 0;
+	}
+}
+
+void FramePacer::SetFramesInFlight(int count)
+{
+	mFramesInFlight = std::min(std::max(count, 1), MaxFramesInFlight);
+}
+
+void FramePacer::SetTargetFps(double fps)
+{
+	mTargetFps = std::max(fps, 0.0);
+	mDeadlineNs = 0;
+}
+
+int FramePacer::BeginFrame()
+{
+	std::uint64_t start = mClock.NowNs();
+	mLast = FrameTiming();
+	if (mFrame > 0) mLast.IntervalMs = (start - mLastBeginNs) / 1e6;
+	mLastBeginNs = start;
+
+	WaitForGpu();
+	std::uint64_t afterGpu = mClock.NowNs();
+	mLast.GpuWaitMs = (afterGpu - start) / 1e6;
+
+	WaitForTargetTime(afterGpu);
+	mLast.CpuWaitMs = (mClock.NowNs() - afterGpu) / 1e6;
+
+	mSum.GpuWaitMs += mLast.GpuWaitMs;
+	mSum.CpuWaitMs += mLast.CpuWaitMs;
+	mSum.IntervalMs += mLast.IntervalMs;
+	++mSumCount;
+
+	// Frame numbers start at 1 so that a zero slot means never used.
+	const std::uint64_t frame = ++mFrame;
+	const int slot = (int)(frame % MaxFramesInFlight);
+	mSlotFence[slot] = 0;
+	mSlotFrame[slot] = frame;
+	return slot;
+}
+
+void FramePacer::EndFrame(int slot, std::uint64_t fenceValue)
+{
+	mSlotFence[slot] = fenceValue;
+}
+
+void FramePacer::WaitForGpu()
+{
+	// The new frame is mFrame + 1, so with N in flight the frames up to
+	// mFrame + 1 - N have to be finished.  Slots rotate through all of
+	// MaxFramesInFlight, so the new frame's slot is free as well.
+	const std::uint64_t frames = (std::uint64_t)mFramesInFlight.load();
+	if (mFrame + 1 <= frames) return;
+
+	const std::uint64_t required = mFrame + 1 - frames;
+	const int slot = (int)(required % MaxFramesInFlight);
+	const std::uint64_t fence = mSlotFence[slot].load();
+
+	// Not submitted yet happens when Draw runs on another thread and lags
+	// more than the requested frames; the frame is waited for once the pacer
+	// sees its fence.
+	if (mSlotFrame[slot].load() != required || fence == 0) return;
+
+	if (mFence.CompletedValue() < fence) mFence.WaitFor(fence);
+}
+
+void FramePacer::WaitForTargetTime(std::uint64_t now)
+{
+	if (mTargetFps <= 0.0) return;
+
+	const std::uint64_t interval = (std::uint64_t)(1e9 / mTargetFps);
+
+	// First frame, or fell more than a frame behind: start counting from now
+	// instead of rushing frames to catch up.
+	if (mDeadlineNs == 0 || now > mDeadlineNs + interval)
+	{
+		mDeadlineNs = now + interval;
+		return;
+	}
+
+	if (now < mDeadlineNs)
+	{
+		if (mDeadlineNs - now > mSpinThresholdNs) mClock.SleepNs(mDeadlineNs - now - mSpinThresholdNs);
+		while (mClock.NowNs() < mDeadlineNs) mClock.Spin();
+	}
+	mDeadlineNs += interval;
+}
+
+FrameTiming FramePacer::TakeAverage()
+{
+	FrameTiming average;
+	if (mSumCount > 0)
+	{
+		average.GpuWaitMs = mSum.GpuWaitMs / mSumCount;
+		average.CpuWaitMs = mSum.CpuWaitMs / mSumCount;
+		average.IntervalMs = mSum.IntervalMs / mSumCount;
+	}
+	mSum = FrameTiming();
+	mSumCount = 0;
+	return average;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Frame pacing: bounds how many frames the CPU may run ahead of the GPU and
+// optionally holds the frame rate to a target.  Time and the GPU fence are
+// reached through the two interfaces below, so the pacing logic runs the same
+// against a simulated clock and fence as against the real ones.
+
+class IFrameClock
+{
+public:
+	virtual ~IFrameClock() = default;
+
+	virtual std::uint64_t NowNs() = 0;
+
+	// May oversleep; the pacer spins out the rest.
+	virtual void SleepNs(std::uint64_t ns) = 0;
+
+	// One iteration of a busy wait.
+	virtual void Spin() = 0;
+};
+
+class IFrameFence
+{
+public:
+	virtual ~IFrameFence() = default;
+
+	virtual std::uint64_t CompletedValue() = 0;
+
+	// Blocks until the fence reached value.
+	virtual void WaitFor(std::uint64_t value) = 0;
+};
+
+// std::chrono::steady_clock and std::this_thread.
+class SteadyFrameClock : public IFrameClock
+{
+public:
+	virtual std::uint64_t NowNs()override;
+	virtual void SleepNs(std::uint64_t ns)override;
+	virtual void Spin()override;
+};
+
+// Waits of one frame.  GpuWait is the time blocked on the fence because the
+// GPU was FramesInFlight frames behind, CpuWait the time spent holding the
+// frame back to the target rate, and Interval the time since the previous
+// BeginFrame.
+struct FrameTiming
+{
+	double GpuWaitMs = 0.0;
+	double CpuWaitMs = 0.0;
+	double IntervalMs = 0.0;
+};
+
+class FramePacer
+{
+public:
+	// Frame resources are allocated for this many frames regardless of the
+	// current setting, so it can change at runtime.
+	static const int MaxFramesInFlight = 4;
+
+	FramePacer(IFrameFence& fence, IFrameClock& clock);
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+
+	// Clamped to [1, MaxFramesInFlight].
+	void SetFramesInFlight(int count);
+	int FramesInFlight()const { return mFramesInFlight.load(); }
+
+	// 0 runs uncapped.
+	void SetTargetFps(double fps);
+	double TargetFps()const { return mTargetFps; }
+
+	// Sleeps end this long before the deadline and the rest is spun, which
+	// covers the coarse sleep granularity of the OS.
+	void SetSpinThresholdNs(std::uint64_t ns) { mSpinThresholdNs = ns; }
+
+	// Waits until the frame FramesInFlight frames back finished on the GPU,
+	// then until the target frame time.  Returns the frame resource slot of
+	// the new frame, in [0, MaxFramesInFlight).
+	int BeginFrame();
+
+	// The fence value signaled after the frame in slot was submitted.  May be
+	// called from another thread than BeginFrame.
+	void EndFrame(int slot, std::uint64_t fenceValue);
+
+	// Frames begun so far.
+	std::uint64_t FrameCount()const { return mFrame; }
+
+	const FrameTiming& LastFrame()const { return mLast; }
+
+	// Average of the frames since the previous call.
+	FrameTiming TakeAverage();
+
+private:
+	void WaitForGpu();
+	void WaitForTargetTime(std::uint64_t now);
+
+	IFrameFence& mFence;
+	IFrameClock& mClock;
+
+	std::atomic<int> mFramesInFlight{ 3 };
+	double mTargetFps = 0.0;
+	std::uint64_t mSpinThresholdNs = 2000000;
+
+	// Per slot the frame it holds and the fence value it was submitted with,
+	// 0 while the frame is still being recorded.
+	std::atomic<std::uint64_t> mSlotFrame[MaxFramesInFlight];
+	std::atomic<std::uint64_t> mSlotFence[MaxFramesInFlight];
+
+	std::uint64_t mFrame = 0;
+	std::uint64_t mLastBeginNs = 0;
+	std::uint64_t mDeadlineNs = 0;
+
+	FrameTiming mLast;
+	FrameTiming mSum;
+	std::uint64_t mSumCount = 0;
+};
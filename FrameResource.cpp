@@ -1,15 +1,24 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT workerCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
+	WorkerCmdListAllocs.resize(workerCount);
+	for (auto& alloc : WorkerCmdListAllocs)
+	{
+		ThrowIfFailed(device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(alloc.GetAddressOf())));
+	}
+
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
     ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, 32767, true);
-	UICB = std::make_unique<UploadBuffer<UIConsts>>(device, 32767, true);
+	UIInstances = std::make_unique<UploadBuffer<UIInstance>>(device, MaxUIInstances, false);
+	UIDrawList = std::make_unique<UploadBuffer<std::uint32_t>>(device, MaxUIInstances, false);
 }
 
 FrameResource::~FrameResource()
@@ -3,6 +3,7 @@
 #include "Common/d3dUtil.h"
 #include "Common/MathHelper.h"
 #include "Common/UploadBuffer.h"
+#include "UIInstance.h"
 
 struct ObjectConstants
 {
@@ -48,34 +49,9 @@ struct Vertex
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT2 TexC;
 };
-struct MapTexture {
-	float _0 = 0;
-	float _1 = 0;
-	float _2 = 0;
-	float _3 = 0;
-	float _4 = 0;
-	float _5 = 0;
-	float _6 = 0;
-	float _7 = 0;
-	const static size_t size = 8;
-};
-struct VertexForMap
-{
-	const UINT x, y;
-    DirectX::XMFLOAT3 Pos;
-    DirectX::XMFLOAT3 Normal;
-	DirectX::XMFLOAT2 TexC;
-	MapTexture Geo;
-	VertexForMap(const UINT& _x, const UINT& _y, DirectX::XMFLOAT3 _pos, DirectX::XMFLOAT3 _normal, DirectX::XMFLOAT2 _tex) : 
-		x(_x), y(_y), Pos(_pos), Normal(_normal), TexC(_tex) {}
-};
 struct UIPoint {
 	DirectX::XMFLOAT2 Pos;
 };
-struct UIConsts {
-	DirectX::XMFLOAT4X4 World;
-	DirectX::XMFLOAT4 Color;
-};
 
 // Stores the resources needed for the CPU to build the command lists
 // for a frame.  
@@ -83,7 +59,7 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT workerCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
@@ -92,18 +68,29 @@ public:
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // One allocator per worker command list for parallel recording.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> WorkerCmdListAllocs;
+
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
     // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     //std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
-	std::unique_ptr<UploadBuffer<UIConsts>> UICB = nullptr;
+
+	// This frame's copy of the retained UI instances, slot by slot, and the
+	// UICount slots to draw, topmost first.
+	static const UINT MaxUIInstances = 32767;
+	std::unique_ptr<UploadBuffer<UIInstance>> UIInstances = nullptr;
+	std::unique_ptr<UploadBuffer<std::uint32_t>> UIDrawList = nullptr;
 
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
+    // Number of UI instances Update wrote for this frame.
+    size_t UICount = 0;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
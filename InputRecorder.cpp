@@ -0,0 +1,227 @@
+#include "InputRecorder.h"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const char Magic[4] = { 'Y', 'I', 'N', 'P' };
+
+	void WriteVarint(std::string& out, std::uint64_t v)
+	{
+		do
+		{
+			unsigned char byte = v & 0x7f;
+			v >>= 7;
+			if (v != 0) byte |= 0x80;
+			out.push_back((char)byte);
+		} while (v != 0);
+	}
+
+	void WriteSigned(std::string& out, std::int64_t v)
+	{
+		WriteVarint(out, ((std::uint64_t)v << 1) ^ (std::uint64_t)(v >> 63));
+	}
+
+	class Reader
+	{
+	public:
+		Reader(const std::string& data, size_t pos) : mData(data), mPos(pos) {}
+
+		bool Varint(std::uint64_t& v)
+		{
+			v = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				if (mPos >= mData.size()) return false;
+				unsigned char byte = (unsigned char)mData[mPos++];
+				v |= (std::uint64_t)(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0) return true;
+			}
+			return false;
+		}
+
+		bool Varint32(std::uint32_t& v)
+		{
+			std::uint64_t wide;
+			if (!Varint(wide) || wide > 0xffffffffull) return false;
+			v = (std::uint32_t)wide;
+			return true;
+		}
+
+		bool Signed(std::int64_t& v)
+		{
+			std::uint64_t u;
+			if (!Varint(u)) return false;
+			v = (std::int64_t)(u >> 1) ^ -(std::int64_t)(u & 1);
+			return true;
+		}
+
+		bool Byte(unsigned char& b)
+		{
+			if (mPos >= mData.size()) return false;
+			b = (unsigned char)mData[mPos++];
+			return true;
+		}
+
+	private:
+		const std::string& mData;
+		size_t mPos;
+	};
+
+	bool IsMouseEvent(InputEventType type)
+	{
+		return type == InputEventType::MouseDown || type == InputEventType::MouseUp || type == InputEventType::MouseMove;
+	}
+}
+
+void InputState::Apply(const InputEvent& e)
+{
+	switch (e.Type)
+	{
+	case InputEventType::MouseDown:
+	case InputEventType::MouseUp:
+	case InputEventType::MouseMove:
+		mButtons = e.Buttons;
+		mMouseX = e.X;
+		mMouseY = e.Y;
+		break;
+	case InputEventType::KeyDown:
+		if (e.Key < 256) mKeys[e.Key] = true;
+		break;
+	case InputEventType::KeyUp:
+		if (e.Key < 256) mKeys[e.Key] = false;
+		break;
+	default:
+		break;
+	}
+}
+
+void InputRecording::Add(std::uint32_t frameIndex, std::uint64_t timeUs, const InputEvent& e)
+{
+	if (Frames.empty() || Frames.back().Index != frameIndex)
+	{
+		Frames.emplace_back();
+		Frames.back().Index = frameIndex;
+		Frames.back().TimeUs = timeUs;
+	}
+	Frames.back().Events.push_back(e);
+
+	if (FrameCount <= frameIndex) FrameCount = frameIndex + 1;
+}
+
+bool InputRecording::Save(const std::string& path)const
+{
+	std::string out(Magic, sizeof(Magic));
+	WriteVarint(out, Version);
+	WriteVarint(out, (std::uint64_t)std::llround(FixedStep * 1e6));
+	WriteVarint(out, ClientWidth);
+	WriteVarint(out, ClientHeight);
+	WriteVarint(out, FrameCount);
+	WriteVarint(out, Frames.size());
+
+	std::uint32_t lastFrame = 0;
+	std::uint64_t lastTime = 0;
+	std::int32_t lastX = 0, lastY = 0;
+	for (const auto& f : Frames)
+	{
+		WriteVarint(out, f.Index - lastFrame);
+		WriteVarint(out, f.TimeUs - lastTime);
+		WriteVarint(out, f.Events.size());
+		lastFrame = f.Index;
+		lastTime = f.TimeUs;
+
+		for (const auto& e : f.Events)
+		{
+			out.push_back((char)e.Type);
+			if (IsMouseEvent(e.Type))
+			{
+				WriteVarint(out, e.Buttons);
+				WriteSigned(out, (std::int64_t)e.X - lastX);
+				WriteSigned(out, (std::int64_t)e.Y - lastY);
+				lastX = e.X;
+				lastY = e.Y;
+			}
+			else
+			{
+				WriteVarint(out, e.Key);
+			}
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+	file.write(out.data(), (std::streamsize)out.size());
+	return file.good();
+}
+
+bool InputRecording::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.size() < sizeof(Magic) || data.compare(0, sizeof(Magic), Magic, sizeof(Magic)) != 0) return false;
+
+	Reader r(data, sizeof(Magic));
+	std::uint64_t version, stepUs, records;
+	InputRecording rec;
+	if (!r.Varint(version) || version != Version) return false;
+	if (!r.Varint(stepUs) || stepUs == 0) return false;
+	if (!r.Varint32(rec.ClientWidth) || !r.Varint32(rec.ClientHeight) || !r.Varint32(rec.FrameCount)) return false;
+	if (!r.Varint(records) || records > rec.FrameCount || records > data.size()) return false;
+	rec.FixedStep = stepUs / 1e6;
+
+	std::uint32_t frame = 0;
+	std::uint64_t time = 0;
+	std::int64_t x = 0, y = 0;
+	rec.Frames.resize((size_t)records);
+	for (auto& f : rec.Frames)
+	{
+		std::uint32_t frameDelta;
+		std::uint64_t timeDelta, count;
+		if (!r.Varint32(frameDelta) || !r.Varint(timeDelta) || !r.Varint(count)) return false;
+
+		frame += frameDelta;
+		time += timeDelta;
+		if (frame >= rec.FrameCount) return false;
+		f.Index = frame;
+		f.TimeUs = time;
+
+		for (std::uint64_t i = 0; i < count; ++i)
+		{
+			unsigned char type;
+			if (!r.Byte(type) || type >= (unsigned char)InputEventType::Count) return false;
+
+			InputEvent e;
+			e.Type = (InputEventType)type;
+			if (IsMouseEvent(e.Type))
+			{
+				std::int64_t dx, dy;
+				if (!r.Varint32(e.Buttons) || !r.Signed(dx) || !r.Signed(dy)) return false;
+				x += dx;
+				y += dy;
+				e.X = (std::int32_t)x;
+				e.Y = (std::int32_t)y;
+			}
+			else if (!r.Varint32(e.Key))
+			{
+				return false;
+			}
+			f.Events.push_back(e);
+		}
+	}
+
+	*this = std::move(rec);
+	return true;
+}
+
+const std::vector<InputEvent>& InputPlayer::EventsFor(std::uint32_t frameIndex)
+{
+	const auto& frames = mRecording.Frames;
+	while (mNext < frames.size() && frames[mNext].Index < frameIndex) ++mNext;
+
+	if (mNext < frames.size() && frames[mNext].Index == frameIndex) return frames[mNext++].Events;
+	return mNone;
+}
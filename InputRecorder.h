@@ -0,0 +1,118 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Input as a stream of events instead of OS polling, so a session can be
+// recorded and replayed frame for frame.  Codes are the Win32 ones (virtual
+// key codes, MK_* button flags), which keeps the recording portable.
+
+enum class InputEventType : std::uint8_t
+{
+	MouseDown = 0,
+	MouseUp,
+	MouseMove,
+	KeyDown,
+	KeyUp,
+	Count
+};
+
+namespace InputCode
+{
+	// MK_LBUTTON, MK_RBUTTON, MK_MBUTTON
+	const std::uint32_t LeftButton = 0x0001;
+	const std::uint32_t RightButton = 0x0002;
+	const std::uint32_t MiddleButton = 0x0010;
+}
+
+struct InputEvent
+{
+	InputEventType Type = InputEventType::Count;
+
+	// Mouse events: button flags held after the event and the cursor position.
+	std::uint32_t Buttons = 0;
+	std::int32_t X = 0;
+	std::int32_t Y = 0;
+
+	// Key events: virtual key code.
+	std::uint32_t Key = 0;
+};
+
+// Key and button state as seen through the events applied so far.
+class InputState
+{
+public:
+	void Apply(const InputEvent& e);
+
+	bool IsKeyDown(std::uint32_t key)const { return key < 256 && mKeys[key]; }
+	bool IsButtonDown(std::uint32_t button)const { return (mButtons & button) != 0; }
+
+	std::int32_t MouseX()const { return mMouseX; }
+	std::int32_t MouseY()const { return mMouseY; }
+
+private:
+	std::bitset<256> mKeys;
+	std::uint32_t mButtons = 0;
+	std::int32_t mMouseX = 0;
+	std::int32_t mMouseY = 0;
+};
+
+// A recorded session: the events of every frame that had any, plus what a
+// replay needs to reproduce the run (frame count, fixed step, client size).
+//
+// File layout, all integers LEB128 varints unless noted:
+//   "YINP" (4 bytes), version, fixed step in microseconds, client width,
+//   client height, frame count, number of frame records, then per record
+//   the frame delta, the time delta in microseconds, the event count and the
+//   events.  An event is its type byte followed by buttons and zigzag x/y
+//   deltas for mouse events, or the key code for key events.
+class InputRecording
+{
+public:
+	struct Frame
+	{
+		std::uint32_t Index = 0;
+		std::uint64_t TimeUs = 0;
+		std::vector<InputEvent> Events;
+	};
+
+	static const std::uint32_t Version = 1;
+
+	double FixedStep = 1.0 / 60.0;
+	std::uint32_t ClientWidth = 800;
+	std::uint32_t ClientHeight = 600;
+
+	// Frames the recorded session ran, including the ones without events.
+	std::uint32_t FrameCount = 0;
+
+	std::vector<Frame> Frames;
+
+	// Frames have to be added in order.
+	void Add(std::uint32_t frameIndex, std::uint64_t timeUs, const InputEvent& e);
+
+	// Both return false if the file can't be opened or is not a valid recording.
+	bool Save(const std::string& path)const;
+	bool Load(const std::string& path);
+};
+
+// Walks a recording one frame at a time.
+class InputPlayer
+{
+public:
+	explicit InputPlayer(const InputRecording& recording) : mRecording(recording) {}
+
+	// Events of the given frame.  Frames have to be asked for in order.
+	const std::vector<InputEvent>& EventsFor(std::uint32_t frameIndex);
+
+	bool Finished(std::uint32_t frameIndex)const { return frameIndex >= mRecording.FrameCount; }
+
+	const InputRecording& Recording()const { return mRecording; }
+
+private:
+	const InputRecording& mRecording;
+	size_t mNext = 0;
+	std::vector<InputEvent> mNone;
+};
@@ -0,0 +1,247 @@
+#include "JobSystem.h"
+#include "Common/Profiler.h"
+
+#include <cassert>
+
+namespace
+{
+	// Which JobSystem queue the current thread owns, if any.
+	thread_local const JobSystem* tOwner = nullptr;
+	thread_local unsigned tQueueIndex = 0;
+
+	// Rounds of stealing attempts before an idle worker goes to sleep.
+	const int SpinCount = 64;
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	if (workerCount == 0)
+	{
+		unsigned hw = std::thread::hardware_concurrency();
+		workerCount = hw > 1 ? hw - 1 : 0;
+	}
+
+	// Queue 0 belongs to the creating thread (and any other non-worker thread).
+	for (unsigned i = 0; i < workerCount + 1; ++i) mQueues.push_back(std::make_unique<WorkQueue>());
+
+	tOwner = this;
+	tQueueIndex = 0;
+
+	for (unsigned i = 1; i < workerCount + 1; ++i)
+	{
+		mWorkers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for (auto& t : mWorkers) t.join();
+
+	if (tOwner == this) tOwner = nullptr;
+}
+
+unsigned JobSystem::CurrentQueue()const
+{
+	return tOwner == this ? tQueueIndex : 0;
+}
+
+void JobSystem::Schedule(Task* task)
+{
+	assert(task->Pending.load() == 0);
+
+	auto& q = *mQueues[CurrentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(q.Mutex);
+		q.Tasks.push_back(task);
+	}
+
+	++mQueued;
+	{
+		// Pairs with the predicate check in WorkerMain so a worker that is
+		// about to sleep cannot miss this task.
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWake.notify_one();
+}
+
+JobSystem::Task* JobSystem::Pop(unsigned index)
+{
+	auto& q = *mQueues[index];
+	std::lock_guard<std::mutex> lock(q.Mutex);
+	if (q.Tasks.empty()) return nullptr;
+
+	// Newest first, its data is most likely still in cache.
+	Task* task = q.Tasks.back();
+	q.Tasks.pop_back();
+	--mQueued;
+	return task;
+}
+
+JobSystem::Task* JobSystem::Steal(unsigned index)
+{
+	const size_t count = mQueues.size();
+	for (size_t i = 1; i < count; ++i)
+	{
+		auto& q = *mQueues[(index + i) % count];
+		std::lock_guard<std::mutex> lock(q.Mutex);
+		if (q.Tasks.empty()) continue;
+
+		// Oldest first, it tends to be the biggest piece of work.
+		Task* task = q.Tasks.front();
+		q.Tasks.pop_front();
+		--mQueued;
+		return task;
+	}
+	return nullptr;
+}
+
+void JobSystem::Execute(Task* task)
+{
+	TaskGroup* group = task->Group;
+
+	try
+	{
+		task->Work();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(group->ErrorMutex);
+		if (!group->Error) group->Error = std::current_exception();
+	}
+
+	for (Task* next : task->Successors)
+	{
+		if (next->Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) Schedule(next);
+	}
+
+	// Last, so that Wait cannot return before the successors were queued.
+	group->Pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Wait(TaskGroup& group)
+{
+	const unsigned index = CurrentQueue();
+	while (group.Pending.load(std::memory_order_acquire) > 0)
+	{
+		Task* task = Pop(index);
+		if (task == nullptr) task = Steal(index);
+
+		if (task != nullptr) Execute(task);
+		else std::this_thread::yield();
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(group.ErrorMutex);
+		std::swap(error, group.Error);
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& func)
+{
+	if (grain == 0) grain = 1;
+	if (count <= grain || mWorkers.empty())
+	{
+		if (count > 0) func(0, count);
+		return;
+	}
+
+	const size_t taskCount = (count + grain - 1) / grain;
+
+	TaskGroup group;
+	group.Pending = (int)taskCount;
+
+	std::deque<Task> tasks;
+	for (size_t i = 0; i < taskCount; ++i)
+	{
+		const size_t begin = i * grain;
+		const size_t end = std::min(count, begin + grain);
+
+		tasks.emplace_back();
+		auto& t = tasks.back();
+		t.Work = [&func, begin, end]() { func(begin, end); };
+		t.Group = &group;
+	}
+	for (auto& t : tasks) Schedule(&t);
+
+	Wait(group);
+}
+
+void JobSystem::WorkerMain(unsigned index)
+{
+	tOwner = this;
+	tQueueIndex = index;
+	Profiler::SetThreadName("Worker");
+
+	int idle = 0;
+	while (!mQuit.load(std::memory_order_relaxed))
+	{
+		Task* task = Pop(index);
+		if (task == nullptr) task = Steal(index);
+
+		if (task != nullptr)
+		{
+			Execute(task);
+			idle = 0;
+		}
+		else if (++idle < SpinCount)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			mWake.wait(lock, [this]() { return mQueued.load() > 0 || mQuit.load(); });
+			idle = 0;
+		}
+	}
+}
+
+size_t TaskGraph::Add(std::function<void()> work)
+{
+	mTasks.emplace_back();
+	mTasks.back().Work = std::move(work);
+	mDependencyCount.push_back(0);
+	return mTasks.size() - 1;
+}
+
+void TaskGraph::Precede(size_t before, size_t after)
+{
+	mTasks[before].Successors.push_back(&mTasks[after]);
+	++mDependencyCount[after];
+}
+
+void TaskGraph::Run(JobSystem& jobs)
+{
+	if (mTasks.empty()) return;
+
+	mGroup.Pending = (int)mTasks.size();
+	for (size_t i = 0; i < mTasks.size(); ++i)
+	{
+		mTasks[i].Pending = mDependencyCount[i];
+		mTasks[i].Group = &mGroup;
+	}
+
+	// Collect the roots first; scheduling one may already finish others.
+	std::vector<JobSystem::Task*> roots;
+	for (size_t i = 0; i < mTasks.size(); ++i)
+	{
+		if (mDependencyCount[i] == 0) roots.push_back(&mTasks[i]);
+	}
+	for (auto t : roots) jobs.Schedule(t);
+
+	jobs.Wait(mGroup);
+}
+
+void TaskGraph::Clear()
+{
+	mTasks.clear();
+	mDependencyCount.clear();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task scheduler.  Every worker owns a deque: it pushes and pops
+// its own work at the back and steals from the front of the other deques when
+// it runs dry.  Threads that wait on tasks keep executing work instead of
+// blocking, so tasks may wait on tasks they spawned.
+
+class JobSystem
+{
+public:
+	struct TaskGroup;
+
+	struct Task
+	{
+		std::function<void()> Work;
+
+		// Unfinished predecessors.  The task is scheduled when this hits zero.
+		std::atomic<int> Pending{ 0 };
+		std::vector<Task*> Successors;
+
+		TaskGroup* Group = nullptr;
+	};
+
+	// Counts the unfinished tasks of a batch and keeps the first exception
+	// thrown by one of them.
+	struct TaskGroup
+	{
+		std::atomic<int> Pending{ 0 };
+		std::mutex ErrorMutex;
+		std::exception_ptr Error;
+	};
+
+	// workerCount == 0 uses one worker per hardware thread besides the caller.
+	explicit JobSystem(unsigned workerCount = 0);
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	// Worker threads plus the thread that owns the JobSystem.
+	unsigned ThreadCount()const { return (unsigned)mQueues.size(); }
+
+	// Queues a task whose Pending count is already zero.
+	void Schedule(Task* task);
+
+	// Executes queued work until the group has finished, then rethrows the
+	// first exception raised by the group, if any.
+	void Wait(TaskGroup& group);
+
+	// Calls func(begin, end) on sub-ranges of [0, count) no larger than grain
+	// and returns when all of them are done.
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& func);
+
+private:
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Task*> Tasks;
+	};
+
+	void WorkerMain(unsigned index);
+	Task* Pop(unsigned index);
+	Task* Steal(unsigned index);
+	void Execute(Task* task);
+	unsigned CurrentQueue()const;
+
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+	std::atomic<int> mQueued{ 0 };
+	std::atomic<bool> mQuit{ false };
+};
+
+// A set of tasks with dependencies that is run to completion at once.
+// Build it with Add/Precede, then Run it; a graph can be run again after it
+// finished, so per-frame graphs only allocate the first time.
+class TaskGraph
+{
+public:
+	size_t Add(std::function<void()> work);
+
+	// "before" has to finish before "after" starts.
+	void Precede(size_t before, size_t after);
+
+	void Run(JobSystem& jobs);
+
+	void Clear();
+
+private:
+	std::deque<JobSystem::Task> mTasks;
+	std::vector<int> mDependencyCount;
+	JobSystem::TaskGroup mGroup;
+};
@@ -0,0 +1,116 @@
+#include "MapEditor.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+MapEditor::MapEditor(std::uint32_t mapSize)
+	: mTerrain(mapSize)
+{
+	XMStoreFloat4x4(&mView, XMMatrixIdentity());
+	SetViewport(mClientWidth, mClientHeight);
+	UpdateCamera(0.f);
+}
+
+void MapEditor::SetViewport(int width, int height)
+{
+	mClientWidth = width;
+	mClientHeight = height;
+
+	const float aspect = height > 0 ? (float)width / height : 1.f;
+	XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspect, 1.0f, 1000.0f);
+	XMStoreFloat4x4(&mProj, P);
+}
+
+void MapEditor::HandleEvent(const InputEvent& e, YTML1_1::Tree& ui)
+{
+	mInput.Apply(e);
+
+	switch (e.Type)
+	{
+	case InputEventType::KeyDown:
+		if (e.Key >= '1' && e.Key <= '4') mBrushLayer = e.Key - '1';
+		break;
+	case InputEventType::MouseDown:
+		if ((e.Buttons & InputCode::LeftButton) != 0)
+		{
+			if (auto hit = YTML1_1::HitTest(ui, (float)e.X, (float)e.Y)) hit->background_color = { 1.f, 0.f, 0.f, 1.f };
+		}
+		break;
+	case InputEventType::MouseUp:
+		if (auto hit = YTML1_1::HitTest(ui, (float)e.X, (float)e.Y)) hit->background_color = { 0.f, 0.f, 1.f, 1.f };
+		break;
+	default:
+		break;
+	}
+}
+
+void MapEditor::UpdateCamera(float dt)
+{
+	if (mInput.IsKeyDown('A')) mEyeOnMap.x -= 1.f * dt * mRadius;
+	if (mInput.IsKeyDown('D')) mEyeOnMap.x += 1.f * dt * mRadius;
+	if (mInput.IsKeyDown('W')) mEyeOnMap.y += 1.f * dt * mRadius;
+	if (mInput.IsKeyDown('S')) mEyeOnMap.y -= 1.f * dt * mRadius;
+
+	// Keep the view centered over the map.
+	const float limit = mTerrain.Vertices().back().Pos.x;
+	mEyeOnMap.x = std::min(std::max(mEyeOnMap.x, -limit), limit);
+	mEyeOnMap.y = std::min(std::max(mEyeOnMap.y, -limit), limit);
+
+	mEyePos.x = mEyeOnMap.x;
+	mEyePos.z = -0.000001f * mRadius + mEyeOnMap.y;
+	mEyePos.y = mRadius;
+
+	// Build the view matrix.
+	XMVECTOR pos = XMVectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
+	XMVECTOR target = XMVectorSet(mEyeOnMap.x, 0.f, mEyeOnMap.y, 0.f);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
+	XMStoreFloat4x4(&mView, view);
+}
+
+bool MapEditor::IsCameraMoving()const
+{
+	return mInput.IsKeyDown('A') || mInput.IsKeyDown('D') || mInput.IsKeyDown('W') || mInput.IsKeyDown('S');
+}
+
+size_t MapEditor::UpdateBrush()
+{
+	if (!mInput.IsButtonDown(InputCode::LeftButton)) return 0;
+
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj));
+
+	// Screen rect of the map from its two opposite corners.
+	const XMFLOAT3& first = mTerrain.Vertices().front().Pos;
+	const XMFLOAT3& last = mTerrain.Vertices().back().Pos;
+
+	XMFLOAT4 pos = { first.x, 0.f, first.z, 1.f };
+	XMVECTOR v = XMVector4Transform(XMVectorSet(pos.x, pos.y, pos.z, pos.w), viewProj);
+	XMStoreFloat4(&pos, v);
+	XMFLOAT2 npos_start = { (pos.x / pos.w + 1.f) / 2.f * mClientWidth, (-pos.y / pos.w + 1.f) / 2.f * mClientHeight };
+
+	pos = { last.x, 0.f, last.z, 1.f };
+	v = XMVector4Transform(XMVectorSet(pos.x, pos.y, pos.z, pos.w), viewProj);
+	XMStoreFloat4(&pos, v);
+	XMFLOAT2 npos_end = { (pos.x / pos.w + 1.f) / 2.f * mClientWidth, (-pos.y / pos.w + 1.f) / 2.f * mClientHeight };
+
+	XMFLOAT4 rect = { npos_start.x, npos_start.y, npos_end.x - npos_start.x, npos_end.y - npos_start.y };
+	if (rect.z < 0) {
+		rect.x += rect.z;
+		rect.z = -rect.z;
+	}
+	if (rect.w < 0) {
+		rect.y += rect.w;
+		rect.w = -rect.w;
+	}
+
+	const float mx = (float)mInput.MouseX();
+	const float my = (float)mInput.MouseY();
+	if (mx >= rect.x && my >= rect.y && mx <= rect.x + rect.z && my <= rect.y + rect.w) {
+		XMFLOAT2 nmp = { (mx - rect.x) / rect.z, 1 - (my - rect.y) / rect.w };
+
+		return mTerrain.Brush(nmp, BrushRange, (int)mBrushLayer);
+	}
+	return 0;
+}
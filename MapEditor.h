@@ -0,0 +1,58 @@
+#pragma once
+
+#include "InputRecorder.h"
+#include "TerrainMap.h"
+#include "YTML1_1.hpp"
+
+// The editing side of BlendApp without the device: the top-down camera, the
+// terrain brush and UI clicks, all driven by input events.  BlendApp runs its
+// frames through it, and so does the headless replay, so both do the same
+// work for the same recording.
+class MapEditor
+{
+public:
+	// Brush radius in map vertices.
+	static constexpr float BrushRange = 9.f;
+
+	explicit MapEditor(std::uint32_t mapSize = 256);
+
+	// Rebuilds the projection for the client area.
+	void SetViewport(int width, int height);
+
+	// Applies one input event: key and button state, brush layer keys and
+	// clicks on the UI.
+	void HandleEvent(const InputEvent& e, YTML1_1::Tree& ui);
+
+	// Moves the camera with the held WASD keys and rebuilds the view.
+	void UpdateCamera(float dt);
+
+	// True while a camera key is held, so the next frame moves the view.
+	bool IsCameraMoving()const;
+
+	// One dab under the cursor while the left button is held.  Returns the
+	// number of vertices it changed.
+	size_t UpdateBrush();
+
+	TerrainMap& Terrain() { return mTerrain; }
+	const TerrainMap& Terrain()const { return mTerrain; }
+	const InputState& Input()const { return mInput; }
+
+	std::uint32_t BrushLayer()const { return mBrushLayer; }
+	const DirectX::XMFLOAT3& EyePos()const { return mEyePos; }
+	const DirectX::XMFLOAT4X4& View()const { return mView; }
+	const DirectX::XMFLOAT4X4& Proj()const { return mProj; }
+
+private:
+	TerrainMap mTerrain;
+	InputState mInput;
+	std::uint32_t mBrushLayer = 0;
+
+	int mClientWidth = 800;
+	int mClientHeight = 600;
+
+	DirectX::XMFLOAT2 mEyeOnMap = { 0.f, 0.f };
+	float mRadius = 50.0f;
+	DirectX::XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4X4 mView;
+	DirectX::XMFLOAT4X4 mProj;
+};
@@ -1,11 +1,20 @@
 #include "Struct.hlsl"
 
-cbuffer cbPerObject : register(b0)
+// Mirrors UIInstance in UIInstance.h.
+struct UIInstance
 {
-    float4x4 gWorld;
-	float4 gColor;
+	float4 Rect;
+	uint FillColor;
+	uint BorderColor;
+	uint BorderWidths;
+	float CornerRadius;
 };
 
+StructuredBuffer<UIInstance> gUIInstances : register(t0);
+
+// Slots of gUIInstances to draw, topmost first.
+StructuredBuffer<uint> gUIDrawList : register(t1);
+
 struct VertexIn
 {
 	float2 PosL    : POSITION;
@@ -14,30 +23,72 @@ struct VertexIn
 struct VertexOut
 {
 	float4 PosH    : SV_POSITION;
-	float4 Color : COLOR;
+	nointerpolation float4 Rect : RECT;
+	nointerpolation uint3 Packed : PACKED;
+	nointerpolation float Radius : RADIUS;
 };
 
-VertexOut VS(VertexIn vin)
+float4 UnpackColor(uint c)
+{
+	return float4(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, c >> 24) / 255.f;
+}
+
+// Left, top, right, bottom in pixels.
+float4 UnpackBorderWidths(uint w)
+{
+	return float4(w & 0xff, (w >> 8) & 0xff, (w >> 16) & 0xff, w >> 24) / 4.f;
+}
+
+// Signed distance to a box centered on the origin with half extents h and
+// corner radius r; negative inside.
+float RoundedBoxDistance(float2 p, float2 h, float r)
+{
+	float2 q = abs(p) - h + r;
+	return length(max(q, 0.f)) + min(max(q.x, q.y), 0.f) - r;
+}
+
+// One instance of the unit quad per element; the pixel shader cuts the
+// corners and splits border from fill.
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout = (VertexOut)0.0f;
-	
-	float2 _2D_POS = vin.PosL;
-	
-	vout.Color = gColor;
-	
-	_2D_POS = mul(float4(vin.PosL, 0.f, 1.f), gWorld).xy;
-	//vout.Color.x += gWorld[0].w / 32;
-	_2D_POS.x += gWorld[0].w;
-	_2D_POS.y += gWorld[1].w;
-	
-	vout.PosH = float4(_2D_POS / gRenderTargetSize * float2(2,-2) + float2(-1, 1), 0.f, 1.0f);
-	
+
+	UIInstance inst = gUIInstances[gUIDrawList[instanceID]];
+	vout.Rect = inst.Rect;
+	vout.Packed = uint3(inst.FillColor, inst.BorderColor, inst.BorderWidths);
+	vout.Radius = inst.CornerRadius;
+
+	float2 pos = inst.Rect.xy + vin.PosL * max(inst.Rect.zw, 0.f);
+	vout.PosH = float4(pos / gRenderTargetSize * float2(2, -2) + float2(-1, 1), 0.f, 1.0f);
+
     return vout;
 }
 
+// ShadeUIInstance in UIInstance.h is the CPU reference of this; keep the two
+// in step.
 float4 PS(VertexOut pin) : SV_Target
 {
-    return pin.Color;
-}
+	float2 h = pin.Rect.zw * 0.5f;
+	float radius = min(max(pin.Radius, 0.f), min(h.x, h.y));
+	float outer = RoundedBoxDistance(pin.PosH.xy - pin.Rect.xy - h, h, radius);
 
+	// A hard outer edge: anything blended here would hide what is under the
+	// element from the depth test.
+	if (outer > 0.f) discard;
 
+	float t = 1.f;
+	if (pin.Packed.z != 0)
+	{
+		float4 b = UnpackBorderWidths(pin.Packed.z);
+		float2 ih = h - (b.xy + b.zw) * 0.5f;
+		float inner = 1e9f;
+		if (ih.x > 0.f && ih.y > 0.f)
+		{
+			float ir = min(max(radius - max(max(b.x, b.y), max(b.z, b.w)), 0.f), min(ih.x, ih.y));
+			inner = RoundedBoxDistance(pin.PosH.xy - pin.Rect.xy - b.xy - ih, ih, ir);
+		}
+		t = saturate(0.5f - inner);
+	}
+
+	return lerp(UnpackColor(pin.Packed.y), UnpackColor(pin.Packed.x), t);
+}
@@ -0,0 +1,87 @@
+#include "TerrainMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+TerrainMap::TerrainMap(std::uint32_t size, float worldExtent)
+	: mSize(size), mWorldExtent(worldExtent)
+{
+	const float center = (size - 1) / 2.f;
+	const float texScale = size > 1 ? 2.f / (size - 1) : 0.f;
+
+	mVertices.reserve((size_t)size * size);
+	for (std::uint32_t i = 0; i < size; ++i)
+	{
+		for (std::uint32_t j = 0; j < size; ++j)
+		{
+			VertexForMap v = VertexForMap(i, j,
+				DirectX::XMFLOAT3((i - center) / size * worldExtent, 0, (j - center) / size * worldExtent),
+				DirectX::XMFLOAT3(),
+				DirectX::XMFLOAT2(i * texScale, j * texScale));
+			v.Geo._0 = 1;
+			mVertices.push_back(v);
+		}
+	}
+
+	MarkAllDirty();
+}
+
+size_t TerrainMap::Brush(const DirectX::XMFLOAT2& pos, float range, int layer)
+{
+	if (layer < 0 || layer >= (int)MapTexture::size || range <= 0.f) return 0;
+
+	const float last = (float)(mSize - 1);
+	const float cx = pos.x * last;
+	const float cy = pos.y * last;
+
+	size_t min_x = 0, max_x = mSize, min_y = 0, max_y = mSize;
+
+	if (cx - range > 0) min_x = (size_t)(cx - range);
+	if (cy - range > 0) min_y = (size_t)(cy - range);
+
+	if (cx + range < mSize) max_x = (size_t)std::max(0.f, cx + range + 1.f);
+	if (cy + range < mSize) max_y = (size_t)std::max(0.f, cy + range + 1.f);
+
+	size_t changed = 0;
+	size_t first = mVertices.size(), end = 0;
+	for (size_t _x = min_x; _x < max_x; ++_x)
+	{
+		for (size_t _y = min_y; _y < max_y; ++_y)
+		{
+			const size_t index = _y + _x * mSize;
+			auto& v = mVertices[index];
+			float dist = std::sqrt((v.x - cx) * (v.x - cx) + (v.y - cy) * (v.y - cy));
+			if (dist <= range)
+			{
+				float* geo = (float*)& v.Geo;
+				geo[layer] += 1.f - dist / range;
+				float all = 0;
+				for (size_t i = 0; i < MapTexture::size; ++i) all += geo[i];
+				for (size_t i = 0; i < MapTexture::size; ++i) geo[i] /= all;
+
+				first = std::min(first, index);
+				end = index + 1;
+				++changed;
+			}
+		}
+	}
+
+	if (changed > 0)
+	{
+		if (mDirty.Empty()) mDirty = { first, end };
+		else mDirty = { std::min(mDirty.Begin, first), std::max(mDirty.End, end) };
+	}
+	return changed;
+}
+
+TerrainMap::DirtyRange TerrainMap::TakeDirtyRange()
+{
+	DirtyRange range = mDirty;
+	mDirty = DirtyRange();
+	return range;
+}
+
+void TerrainMap::MarkAllDirty()
+{
+	mDirty = { 0, mVertices.size() };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The paintable ground: a Size x Size grid of vertices that each carry blend
+// weights for eight ground textures.  Nothing here touches the device, so the
+// map can be built, brushed and measured without a window; the app copies
+// the dirty part of Vertices() into its vertex upload buffer every frame.
+
+struct MapTexture {
+	float _0 = 0;
+	float _1 = 0;
+	float _2 = 0;
+	float _3 = 0;
+	float _4 = 0;
+	float _5 = 0;
+	float _6 = 0;
+	float _7 = 0;
+	const static size_t size = 8;
+};
+struct VertexForMap
+{
+	const std::uint32_t x, y;
+    DirectX::XMFLOAT3 Pos;
+    DirectX::XMFLOAT3 Normal;
+	DirectX::XMFLOAT2 TexC;
+	MapTexture Geo;
+	VertexForMap(const std::uint32_t& _x, const std::uint32_t& _y, DirectX::XMFLOAT3 _pos, DirectX::XMFLOAT3 _normal, DirectX::XMFLOAT2 _tex) :
+		x(_x), y(_y), Pos(_pos), Normal(_normal), TexC(_tex) {}
+};
+
+class TerrainMap
+{
+public:
+	// Vertex range [Begin, End) that changed since the last TakeDirtyRange.
+	struct DirtyRange
+	{
+		size_t Begin = 0;
+		size_t End = 0;
+
+		bool Empty()const { return Begin >= End; }
+		size_t Count()const { return Empty() ? 0 : End - Begin; }
+	};
+
+	// size vertices per side spread over worldExtent units, centered on the
+	// origin.  Every vertex starts fully on texture 0.
+	explicit TerrainMap(std::uint32_t size = 256, float worldExtent = 40.f);
+
+	std::uint32_t Size()const { return mSize; }
+	float WorldExtent()const { return mWorldExtent; }
+
+	const std::vector<VertexForMap>& Vertices()const { return mVertices; }
+
+	// Triangle list over the grid, two triangles per cell.
+	template<typename Index>
+	std::vector<Index> BuildIndices()const
+	{
+		std::vector<Index> indices;
+		indices.reserve((size_t)(mSize - 1) * (mSize - 1) * 6);
+		for (std::uint32_t i = 0; i + 1 < mSize; ++i)
+		{
+			for (std::uint32_t j = 0; j + 1 < mSize; ++j)
+			{
+				indices.push_back((Index)(i * mSize + j));
+				indices.push_back((Index)(i * mSize + j + 1));
+				indices.push_back((Index)(i * mSize + j + mSize));
+
+				indices.push_back((Index)(i * mSize + j + 1));
+				indices.push_back((Index)(i * mSize + j + mSize + 1));
+				indices.push_back((Index)(i * mSize + j + mSize));
+			}
+		}
+		return indices;
+	}
+
+	// One brush dab.  pos is in [0, 1] over the map, range is in vertices.
+	// Adds 1 - dist / range of texture layer to every vertex within range and
+	// renormalizes its weights.  Returns the number of vertices changed.
+	size_t Brush(const DirectX::XMFLOAT2& pos, float range, int layer);
+
+	bool IsDirty()const { return !mDirty.Empty(); }
+
+	// Returns and clears the vertices changed since the last call.
+	DirtyRange TakeDirtyRange();
+
+	// Marks the whole map for upload, for example after the buffer was recreated.
+	void MarkAllDirty();
+
+private:
+	std::uint32_t mSize;
+	float mWorldExtent;
+	std::vector<VertexForMap> mVertices;
+	DirtyRange mDirty;
+};
@@ -0,0 +1,109 @@
+#include "UICuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	std::uint32_t Alpha(std::uint32_t color) { return color >> 24; }
+
+	bool HasBorder(const UIInstance& inst) { return inst.BorderWidths != 0; }
+}
+
+void UICuller::SetViewport(float width, float height)
+{
+	mWidth = std::max(width, 0.f);
+	mHeight = std::max(height, 0.f);
+}
+
+void UICuller::SetTileSize(int size)
+{
+	mTileSize = std::max(size, 1);
+}
+
+void UICuller::Begin()
+{
+	mStats = UICullStats();
+	mTilesX = (int)std::ceil(mWidth / mTileSize);
+	mTilesY = (int)std::ceil(mHeight / mTileSize);
+	mCovered.assign((size_t)mTilesX * mTilesY, 0);
+}
+
+bool UICuller::Accept(const UIInstance& inst)
+{
+	const auto& r = inst.Rect;
+	if (r.z <= 0.f || r.w <= 0.f ||
+		(Alpha(inst.FillColor) == 0 && (!HasBorder(inst) || Alpha(inst.BorderColor) == 0)))
+	{
+		++mStats.Invisible;
+		return false;
+	}
+	if (r.x + r.z <= 0.f || r.y + r.w <= 0.f || r.x >= mWidth || r.y >= mHeight)
+	{
+		++mStats.Offscreen;
+		return false;
+	}
+	return true;
+}
+
+void UICuller::Finish(const std::vector<UIInstance>& emitted, std::vector<std::uint32_t>& drawOrder)
+{
+	drawOrder.clear();
+	drawOrder.reserve(emitted.size());
+
+	for (size_t i = emitted.size(); i-- > 0;)
+	{
+		const UIInstance& inst = emitted[i];
+		const auto& r = inst.Rect;
+		if (mOcclusion)
+		{
+			if (TilesCovered(r.x, r.y, r.x + r.z, r.y + r.w))
+			{
+				++mStats.Occluded;
+				continue;
+			}
+
+			// The rounded corners are left out: the rect minus them is the
+			// union of a horizontal and a vertical band.
+			if (Alpha(inst.FillColor) == 255 && (!HasBorder(inst) || Alpha(inst.BorderColor) == 255))
+			{
+				const float radius = std::min(std::max(inst.CornerRadius, 0.f), std::min(r.z, r.w) * 0.5f);
+				CoverTiles(r.x + radius, r.y, r.x + r.z - radius, r.y + r.w);
+				if (radius > 0.f) CoverTiles(r.x, r.y + radius, r.x + r.z, r.y + r.w - radius);
+			}
+		}
+		drawOrder.push_back((std::uint32_t)i);
+	}
+	mStats.Emitted = drawOrder.size();
+}
+
+void UICuller::CoverTiles(float x0, float y0, float x1, float y1)
+{
+	// A tile the viewport cuts short only needs covering up to its edge.
+	const float s = (float)mTileSize;
+	const int tx0 = std::min(mTilesX, std::max(0, (int)std::ceil(x0 / s)));
+	const int ty0 = std::max(0, (int)std::ceil(y0 / s));
+	const int tx1 = x1 >= mWidth ? mTilesX : std::min(mTilesX, (int)std::floor(x1 / s));
+	const int ty1 = y1 >= mHeight ? mTilesY : std::min(mTilesY, (int)std::floor(y1 / s));
+
+	for (int ty = ty0; ty < ty1; ++ty)
+		std::fill_n(mCovered.data() + (size_t)ty * mTilesX + tx0, std::max(0, tx1 - tx0), (std::uint8_t)1);
+}
+
+bool UICuller::TilesCovered(float x0, float y0, float x1, float y1)const
+{
+	const float s = (float)mTileSize;
+	const int tx0 = std::max(0, (int)std::floor(x0 / s));
+	const int ty0 = std::max(0, (int)std::floor(y0 / s));
+	const int tx1 = std::min(mTilesX, (int)std::ceil(x1 / s));
+	const int ty1 = std::min(mTilesY, (int)std::ceil(y1 / s));
+	if (tx0 >= tx1 || ty0 >= ty1) return false;
+
+	for (int ty = ty0; ty < ty1; ++ty)
+	{
+		const std::uint8_t* row = &mCovered[(size_t)ty * mTilesX];
+		for (int tx = tx0; tx < tx1; ++tx)
+			if (!row[tx]) return false;
+	}
+	return true;
+}
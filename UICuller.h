@@ -0,0 +1,69 @@
+#pragma once
+
+#include "UIInstance.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Drops UI instances that would not change the image before they reach the
+// upload buffer: ones outside the viewport, without area or fully
+// transparent, and optionally ones hidden under opaque elements drawn on top
+// of them.  Occlusion is tracked on a coarse grid of screen tiles; a tile
+// counts as covered only when an opaque element covers all of it, so the
+// test is conservative.
+
+struct UICullStats
+{
+	size_t Emitted = 0;
+	size_t Offscreen = 0;
+	size_t Invisible = 0;
+	size_t Occluded = 0;
+
+	size_t Culled()const { return Offscreen + Invisible + Occluded; }
+};
+
+class UICuller
+{
+public:
+	static const int DefaultTileSize = 16;
+
+	void SetViewport(float width, float height);
+
+	void SetOcclusion(bool enabled) { mOcclusion = enabled; }
+	bool Occlusion()const { return mOcclusion; }
+
+	// In pixels, at least 1.
+	void SetTileSize(int size);
+
+	// Starts a frame and clears its stats.
+	void Begin();
+
+	// The per-element tests, done while emitting: false for instances
+	// outside the viewport, without area or without a visible pixel.
+	bool Accept(const UIInstance& inst);
+
+	// Takes the accepted instances in emission order, bottom first, and
+	// writes the indices of the ones not occluded to drawOrder topmost first,
+	// the order the UI draw wants them in.
+	void Finish(const std::vector<UIInstance>& emitted, std::vector<std::uint32_t>& drawOrder);
+
+	// Of the last frame.
+	const UICullStats& Stats()const { return mStats; }
+
+private:
+	// Tiles fully inside the pixel rect [x0, x1) x [y0, y1).
+	void CoverTiles(float x0, float y0, float x1, float y1);
+	bool TilesCovered(float x0, float y0, float x1, float y1)const;
+
+	float mWidth = 0.f;
+	float mHeight = 0.f;
+	bool mOcclusion = true;
+	int mTileSize = DefaultTileSize;
+
+	int mTilesX = 0;
+	int mTilesY = 0;
+	std::vector<std::uint8_t> mCovered;
+
+	UICullStats mStats;
+};
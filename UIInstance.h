@@ -0,0 +1,95 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// One UI rectangle as the UI shader reads it from a structured buffer, 32
+// bytes instead of a 4x4 matrix and a color in a 256 byte constant slot.
+struct UIInstance
+{
+	// x, y, width, height in pixels.
+	DirectX::XMFLOAT4 Rect;
+
+	// RGBA8, red in the low byte.
+	std::uint32_t FillColor;
+	std::uint32_t BorderColor;
+
+	// Left, top, right, bottom border width in quarter pixels, one byte each
+	// starting at the low byte, so up to 63.75 pixels.
+	std::uint32_t BorderWidths;
+
+	// In pixels, the same for all four corners.  Clamped to half the shorter
+	// side when drawn.
+	float CornerRadius;
+};
+static_assert(sizeof(UIInstance) == 32, "UI.hlsl expects 32 byte instances");
+
+inline std::uint32_t PackUIColor(const DirectX::XMFLOAT4& c)
+{
+	auto channel = [](float v) { return (std::uint32_t)(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f); };
+	return channel(c.x) | channel(c.y) << 8 | channel(c.z) << 16 | channel(c.w) << 24;
+}
+
+inline std::uint32_t PackUIBorderWidths(float left, float top, float right, float bottom)
+{
+	auto quarter = [](float v) { return (std::uint32_t)(std::min(std::max(v, 0.f), 63.75f) * 4.f + 0.5f); };
+	return quarter(left) | quarter(top) << 8 | quarter(right) << 16 | quarter(bottom) << 24;
+}
+
+inline DirectX::XMFLOAT4 UnpackUIColor(std::uint32_t c)
+{
+	return { (c & 0xff) / 255.f, (c >> 8 & 0xff) / 255.f, (c >> 16 & 0xff) / 255.f, (c >> 24) / 255.f };
+}
+
+// Left, top, right, bottom in pixels.
+inline DirectX::XMFLOAT4 UnpackUIBorderWidths(std::uint32_t w)
+{
+	return { (w & 0xff) / 4.f, (w >> 8 & 0xff) / 4.f, (w >> 16 & 0xff) / 4.f, (w >> 24) / 4.f };
+}
+
+// Signed distance from (px, py) to a box centered on the origin with half
+// extents (hx, hy) and corner radius r; negative inside.
+inline float UIRoundedBoxDistance(float px, float py, float hx, float hy, float r)
+{
+	const float qx = std::fabs(px) - hx + r;
+	const float qy = std::fabs(py) - hy + r;
+	const float ox = std::max(qx, 0.f), oy = std::max(qy, 0.f);
+	return std::sqrt(ox * ox + oy * oy) + std::min(std::max(qx, qy), 0.f) - r;
+}
+
+// CPU reference of the UI pixel shader, step for step: the color of the pixel
+// centered at (x, y), or false where UI.hlsl discards it.  The outer edge is
+// hard so the depth test keeps working; the border to fill edge is blended
+// over one pixel.
+inline bool ShadeUIInstance(const UIInstance& inst, float x, float y, DirectX::XMFLOAT4& color)
+{
+	const float hx = inst.Rect.z * 0.5f, hy = inst.Rect.w * 0.5f;
+	const float radius = std::min(std::max(inst.CornerRadius, 0.f), std::min(hx, hy));
+	const float outer = UIRoundedBoxDistance(x - inst.Rect.x - hx, y - inst.Rect.y - hy, hx, hy, radius);
+	if (outer > 0.f) return false;
+
+	float t = 1.f;
+	if (inst.BorderWidths != 0)
+	{
+		// The inner corners keep the outer arc's center, as CSS does for
+		// even borders.
+		const DirectX::XMFLOAT4 b = UnpackUIBorderWidths(inst.BorderWidths);
+		const float ihx = hx - (b.x + b.z) * 0.5f, ihy = hy - (b.y + b.w) * 0.5f;
+		float inner = 1e9f;
+		if (ihx > 0.f && ihy > 0.f)
+		{
+			const float widest = std::max(std::max(b.x, b.y), std::max(b.z, b.w));
+			const float ir = std::min(std::max(radius - widest, 0.f), std::min(ihx, ihy));
+			inner = UIRoundedBoxDistance(x - inst.Rect.x - b.x - ihx, y - inst.Rect.y - b.y - ihy, ihx, ihy, ir);
+		}
+		t = std::min(std::max(0.5f - inner, 0.f), 1.f);
+	}
+
+	const DirectX::XMFLOAT4 fill = UnpackUIColor(inst.FillColor);
+	const DirectX::XMFLOAT4 border = UnpackUIColor(inst.BorderColor);
+	color = { border.x + (fill.x - border.x) * t, border.y + (fill.y - border.y) * t,
+		border.z + (fill.z - border.z) * t, border.w + (fill.w - border.w) * t };
+	return true;
+}
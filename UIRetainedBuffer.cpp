@@ -0,0 +1,138 @@
+#include "UIRetainedBuffer.h"
+
+#include <cstring>
+
+UIRetainedBuffer::UIRetainedBuffer(std::uint32_t capacity, int copies)
+	: mCapacity(capacity), mCopies(std::min(std::max(copies, 1), MaxCopies)),
+	mInstances(capacity), mSlots(capacity), mDirtyMask(capacity, 0)
+{
+}
+
+void UIRetainedBuffer::BeginFrame()
+{
+	++mFrame;
+	mStats = UIRetainedStats();
+
+	if (mMaxMoves > 0 && mSpan > 64 && mFree.size() > mSpan / 4) Compact();
+}
+
+std::uint32_t UIRetainedBuffer::Update(std::uint64_t key, const UIInstance& inst)
+{
+	auto it = mSlotOf.find(key);
+	if (it == mSlotOf.end())
+	{
+		const std::uint32_t slot = Allocate();
+		if (slot == InvalidSlot) return InvalidSlot;
+
+		mSlotOf.emplace(key, slot);
+		mSlots[slot] = { key, mFrame, true };
+		mInstances[slot] = inst;
+		MarkDirty(slot);
+		++mStats.Added;
+		return slot;
+	}
+
+	const std::uint32_t slot = it->second;
+	mSlots[slot].Frame = mFrame;
+	if (std::memcmp(&mInstances[slot], &inst, sizeof(UIInstance)) != 0)
+	{
+		mInstances[slot] = inst;
+		MarkDirty(slot);
+		++mStats.Changed;
+	}
+	return slot;
+}
+
+bool UIRetainedBuffer::SetDrawList(std::vector<std::uint32_t>& drawList)
+{
+	if (drawList == mDrawList) return false;
+	mDrawList.swap(drawList);
+	++mDrawListVersion;
+	return true;
+}
+
+void UIRetainedBuffer::EndFrame()
+{
+	size_t freed = 0;
+	for (std::uint32_t slot = 0; slot < mSpan; ++slot)
+	{
+		Slot& s = mSlots[slot];
+		if (!s.Live || s.Frame == mFrame) continue;
+
+		s.Live = false;
+		mSlotOf.erase(s.Key);
+		mFree.push_back(slot);
+		++freed;
+	}
+
+	mStats.Freed = freed;
+	mStats.Live = mSlotOf.size();
+	mStats.Span = mSpan;
+}
+
+void UIRetainedBuffer::InvalidateCopies()
+{
+	for (int c = 0; c < mCopies; ++c)
+	{
+		mDirty[c].clear();
+		mCopyDrawListVersion[c] = 0;
+	}
+	std::fill(mDirtyMask.begin(), mDirtyMask.end(), (std::uint8_t)0);
+	for (std::uint32_t slot = 0; slot < mSpan; ++slot)
+		if (mSlots[slot].Live) MarkDirty(slot);
+}
+
+void UIRetainedBuffer::MarkDirty(std::uint32_t slot)
+{
+	std::uint8_t& mask = mDirtyMask[slot];
+	for (int c = 0; c < mCopies; ++c)
+	{
+		const std::uint8_t bit = (std::uint8_t)(1u << c);
+		if (mask & bit) continue;
+		mask |= bit;
+		mDirty[c].push_back(slot);
+	}
+}
+
+std::uint32_t UIRetainedBuffer::Allocate()
+{
+	if (!mFree.empty())
+	{
+		const std::uint32_t slot = mFree.back();
+		mFree.pop_back();
+		return slot;
+	}
+	return mSpan < mCapacity ? mSpan++ : InvalidSlot;
+}
+
+void UIRetainedBuffer::Compact()
+{
+	// Fill the lowest holes from the top of the span.
+	std::sort(mFree.begin(), mFree.end());
+	size_t low = 0;
+	std::uint32_t top = mSpan;
+	size_t moves = 0;
+	while (moves < mMaxMoves)
+	{
+		while (top > 0 && !mSlots[top - 1].Live) --top;
+		if (top == 0 || low >= mFree.size() || mFree[low] >= top - 1) break;
+
+		const std::uint32_t from = top - 1, to = mFree[low++];
+		mSlots[to] = mSlots[from];
+		mSlots[from].Live = false;
+		mInstances[to] = mInstances[from];
+		mSlotOf[mSlots[to].Key] = to;
+		MarkDirty(to);
+		++moves;
+	}
+	while (top > 0 && !mSlots[top - 1].Live) --top;
+	mSpan = top;
+
+	mFree.clear();
+	for (std::uint32_t slot = 0; slot < mSpan; ++slot)
+		if (!mSlots[slot].Live) mFree.push_back(slot);
+	// Lowest on top of the stack, so new elements fill the front first.
+	std::reverse(mFree.begin(), mFree.end());
+
+	mStats.Moved = moves;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "UIInstance.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// CPU side of the retained UI instance buffer.  Every element keeps its
+// instance in a stable slot across frames; Update diffs the new instance
+// against the stored one and only a changed slot is marked dirty.  The GPU
+// copies, one per frame resource, are brought up to date with Sync, which
+// hands out the dirty slots as coalesced ranges, so the upload of a frame is
+// proportional to what changed since that copy was last synced.
+//
+// Draw order is kept apart from the slots as a list of slot indices, which
+// is only uploaded when it changed.
+//
+// Slots of elements that were not updated in a frame are freed at the end of
+// it and reused for new elements.  Once enough of the used span is free the
+// top slots are moved down into the holes, a bounded number per frame.
+
+struct UIRetainedStats
+{
+	size_t Live = 0;
+	size_t Span = 0;
+	size_t Changed = 0;
+	size_t Added = 0;
+	size_t Freed = 0;
+	size_t Moved = 0;
+};
+
+class UIRetainedBuffer
+{
+public:
+	static const std::uint32_t InvalidSlot = 0xffffffff;
+	static const int MaxCopies = 8;
+
+	// capacity slots, mirrored into copies GPU buffers.
+	UIRetainedBuffer(std::uint32_t capacity, int copies);
+	UIRetainedBuffer(const UIRetainedBuffer& rhs) = delete;
+	UIRetainedBuffer& operator=(const UIRetainedBuffer& rhs) = delete;
+
+	// Starts a frame; this is where freed slots get compacted.
+	void BeginFrame();
+
+	// Stores the instance of the element with this key and returns its slot,
+	// InvalidSlot when the buffer is full.  A slot stays valid until the next
+	// BeginFrame.
+	std::uint32_t Update(std::uint64_t key, const UIInstance& inst);
+
+	// Slot indices in draw order.  Returns true if the list changed.
+	bool SetDrawList(std::vector<std::uint32_t>& drawList);
+	const std::vector<std::uint32_t>& DrawList()const { return mDrawList; }
+
+	// Frees the slots of elements not updated this frame.
+	void EndFrame();
+
+	// Calls write(firstSlot, instances, count) for every range copy is
+	// missing.  Returns the instances written.
+	template<typename Func>
+	size_t Sync(int copy, Func&& write);
+
+	// Calls write(drawList, count) if copy has an older draw list.  Returns the
+	// entries written.
+	template<typename Func>
+	size_t SyncDrawList(int copy, Func&& write);
+
+	// Forgets what every copy holds, for buffers that were recreated.
+	void InvalidateCopies();
+
+	// Of the last frame.
+	const UIRetainedStats& Stats()const { return mStats; }
+
+	std::uint32_t Capacity()const { return mCapacity; }
+	const UIInstance* Instances()const { return mInstances.data(); }
+
+	// Moves at most this many instances per frame when compacting; 0 turns
+	// compaction off.
+	void SetMaxMovesPerFrame(size_t moves) { mMaxMoves = moves; }
+
+private:
+	struct Slot
+	{
+		std::uint64_t Key = 0;
+		std::uint64_t Frame = 0;
+		bool Live = false;
+	};
+
+	void MarkDirty(std::uint32_t slot);
+	std::uint32_t Allocate();
+	void Compact();
+
+	const std::uint32_t mCapacity;
+	const int mCopies;
+
+	std::vector<UIInstance> mInstances;
+	std::vector<Slot> mSlots;
+	std::unordered_map<std::uint64_t, std::uint32_t> mSlotOf;
+	std::vector<std::uint32_t> mFree;
+	// Slots in [0, mSpan) have been used; every slot above is free.
+	std::uint32_t mSpan = 0;
+	std::uint64_t mFrame = 0;
+
+	// Bit c of a slot's mask is set while copy c is missing it; then the
+	// slot is in mDirty[c] too.
+	std::vector<std::uint8_t> mDirtyMask;
+	std::vector<std::uint32_t> mDirty[MaxCopies];
+
+	std::vector<std::uint32_t> mDrawList;
+	std::uint64_t mDrawListVersion = 1;
+	std::uint64_t mCopyDrawListVersion[MaxCopies] = {};
+
+	size_t mMaxMoves = 256;
+	UIRetainedStats mStats;
+};
+
+template<typename Func>
+size_t UIRetainedBuffer::Sync(int copy, Func&& write)
+{
+	auto& dirty = mDirty[copy];
+	if (dirty.empty()) return 0;
+
+	std::sort(dirty.begin(), dirty.end());
+	const std::uint8_t bit = (std::uint8_t)(1u << copy);
+	size_t written = 0;
+	for (size_t i = 0; i < dirty.size();)
+	{
+		// Short gaps are written through; the clean slots in them are
+		// already correct, and one copy beats two.
+		size_t j = i + 1;
+		while (j < dirty.size() && dirty[j] - dirty[j - 1] <= 4) ++j;
+
+		const std::uint32_t first = dirty[i];
+		const std::uint32_t count = dirty[j - 1] - first + 1;
+		write(first, &mInstances[first], (size_t)count);
+		written += count;
+		for (size_t k = i; k < j; ++k) mDirtyMask[dirty[k]] &= (std::uint8_t)~bit;
+		i = j;
+	}
+	dirty.clear();
+	return written;
+}
+
+template<typename Func>
+size_t UIRetainedBuffer::SyncDrawList(int copy, Func&& write)
+{
+	if (mCopyDrawListVersion[copy] == mDrawListVersion) return 0;
+	mCopyDrawListVersion[copy] = mDrawListVersion;
+	if (!mDrawList.empty()) write(mDrawList.data(), mDrawList.size());
+	return mDrawList.size();
+}
@@ -1,4 +1,8 @@
+#pragma once
+
 #include <DirectXMath.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <functional>
@@ -7,7 +11,10 @@
 #include <fstream>
 #include <string>
 #include <string_view>
-#include <charconv>
+
+#include "YTMLSelector.hpp"
+#include "YTMLValue.hpp"
+#include "YTMLFlex.hpp"
 
 extern void OutputDebugStringA(const char* lpOutputString);
 
@@ -19,6 +26,8 @@ inline namespace YTML1_1
 		RatioHorizontalAlign = 0b100,
 		RatioVerticalAlign = 0b1000,
 		Enable = 0b10000,
+		// A property layout reads changed since the last RunYTML1_1.
+		LayoutDirty = 0b100000,
 	};
 
 	enum class ElementHorizontalAlign {
@@ -76,10 +85,53 @@ inline namespace YTML1_1
 		};
 	};
 
-	extern struct Element;
+	// Lengths as a style writes them.  RunYTML1_1 resolves them into size,
+	// margin, border, border_radius and font_size.
+	struct ElementLengths {
+		Length width = { 0.f, LengthUnit::Auto };
+		Length height = { 0.f, LengthUnit::Auto };
+		BoxLengths margin, border;
+		Length border_radius;
+		// Inherited unless set.
+		Length font_size = { 1.f, LengthUnit::Em };
+
+		bool operator==(const ElementLengths& rhs)const
+		{
+			return width == rhs.width && height == rhs.height && margin == rhs.margin && border == rhs.border &&
+				border_radius == rhs.border_radius && font_size == rhs.font_size;
+		}
+	};
+
+	// What relative lengths resolve against: the content box and font size of
+	// the parent, the font size of the root and the viewport, the root's size.
+	struct LengthBasis {
+		float width = 0.f;
+		float height = 0.f;
+		float font = 0.f;
+		float root_font = 0.f;
+		float viewport_w = 0.f;
+		float viewport_h = 0.f;
+	};
+
+	// Parts of the basis an element's resolved lengths depend on.
+	enum LengthDependency : uint8_t {
+		DependsParentWidth = 0b1,
+		DependsParentHeight = 0b10,
+		DependsParentFont = 0b100,
+		DependsRootFont = 0b1000,
+		DependsViewport = 0b10000,
+	};
+
+	struct Element;
+	struct ChildLayout;
 
 	
-	inline void ReadCSS(const std::string& path, std::unordered_map<std::string, std::string>& style)
+	inline void ParseCSS(const std::string& str, StyleSheet& style)
+	{
+		style.Parse(str);
+	}
+
+	inline void ReadCSS(const std::string& path, StyleSheet& style)
 	{
 		std::ifstream file(path);
 
@@ -87,78 +139,11 @@ inline namespace YTML1_1
 
 		file.close();
 
-		size_t size = 0, i = 0, j = 0, k, meta_start;
-		std::string obj;
-		for (i = 0; i < str.size(); ++i) if (const char c = str.at(i); c != '\r' && c != '\n' && c != '\t') ++size;
-		obj.resize(size);
-		for (i = 0; i < str.size(); ++i) if (const char c = str.at(i); c != '\r' && c != '\n' && c != '\t') obj.at(j++) = c;
-
-
-
-		//std::cout << obj << std::endl;
-
-		size_t start = 0;
-		std::vector<std::string_view> sv;
-		for (i = 0; i < obj.size(); ++i)
-		{
-			if (obj.at(i) == '}')
-			{
-				std::string_view s(&obj.at(start), i - start);
-				for (j = 0; j < s.size(); ++j)
-				{
-					if (s.at(j) == '{')
-					{
-						std::string_view meta(&s.at(0), j);
-						std::string_view data(&s.at(j + 1), s.size() - j - 1);
-
-						sv.clear();
-
-						meta_start = -1;
-						for (k = 0; k < meta.size(); ++k)
-						{
-							if (meta.at(k) == ',')
-							{
-								if (meta_start != -1)
-								{
-									sv.push_back(std::string_view(&meta.at(meta_start), k - meta_start));
-									meta_start = -1;
-								}
-							}
-							else if (meta_start == -1) meta_start = k;
-						}
-						if (meta_start != -1)
-						{
-							sv.push_back(std::string_view(&meta.at(meta_start), meta.size() - meta_start));
-							meta_start = -1;
-						}
-
-						for (const auto& hs : sv)
-						{
-							size_t x, y;
-							//Both Trip
-							for (x = 0; x < hs.size(); ++x)
-							{
-								if (hs[x] != ' ') break;
-							}
-							for (y = hs.size(); y > 1; --y)
-							{
-								if (hs[y - 1] != ' ') break;
-							}
-							style[std::string(hs.substr(x, y - x))] = data;
-							//std::cout << hs.substr(x, y - x) << ", ";
-						}
-
-						//std::cout << "~" << data << std::endl;
-						break;
-					}
-				}
-				//std::cout << s << std::endl;
-				start = i + 1;
-			}
-		}
+		ParseCSS(str, style);
 	}
 
 	struct Element {
+		// Resolved by layout from lengths, in pixels.
 		FourDirection margin, border;
 
 		FloatSize size = { 0.f, 0.f };
@@ -166,314 +151,189 @@ inline namespace YTML1_1
 		ElementVerticalAlign valign = ElementVerticalAlign::Top;
 		ElementParentClipDirection pclip = ElementParentClipDirection::Horizontal;
 		FloatRect size_in_display;
+		// Display offsets, on top of size_in_display and never read by
+		// layout: translate moves the element and what is in it, scroll moves
+		// what is in it the other way, as scrolling a pane down moves its
+		// content up.  See EmitYTML1_1 and HitTest.
+		DirectX::XMFLOAT2 translate = { 0.f, 0.f };
+		DirectX::XMFLOAT2 scroll = { 0.f, 0.f };
 
 		size_t eid = -1;
 		uint16_t flags = 16;
 
+		// The basis lengths were last resolved against, and the parts of it
+		// they depend on; layout resolves again only when one of those
+		// changed.  Next to what layout reads anyway.
+		uint8_t length_dependencies = 0;
+		bool lengths_resolved = false;
+		float font_size = 16.f;
+		LengthBasis resolved_basis;
+
+		// As written; see resolved_basis.
+		ElementLengths lengths;
+		ElementDisplay display = ElementDisplay::Block;
+		FlexStyle flex;
+		// Lays the children out in place of the flow or flexbox when set, as
+		// a VirtualList does; not owned.
+		ChildLayout* child_layout = nullptr;
+
+		// The size of a flex container with an auto width or height, by the
+		// width and height of the basis it was measured in, for the run of
+		// RunYTML1_1 that measured it; 0 is none.
+		struct Measurement {
+			uint32_t pass = 0;
+			float width = 0.f;
+			float height = 0.f;
+			FloatSize size;
+		};
+		Measurement measured[2];
+		uint8_t next_measured = 0;
+
 		std::string head;
+		// As written in the markup; tuple also holds the declarations applied.
+		std::unordered_map<std::string, std::string> attributes;
 		std::unordered_map<std::string, std::string> tuple;
 		DirectX::XMFLOAT4 background_color = {1.f, 1.f, 1.f, 1.f};
 		DirectX::XMFLOAT4 border_color = { 0.f, 0.f, 0.f, 1.f };
+		float border_radius = 0.f;
 		
 		Element() {
 			margin.flt4 = { 0.f, 0.f, 0.f, 0.f };
 			border.flt4 = { 0.f, 0.f, 0.f, 0.f };
 		}
 
-		void tupleChanged(const std::string& key, std::unordered_map<std::string, std::string>& style) {
-			std::cout << "{" << key << ":" << tuple[key]  << "}" << std::endl;
-			const auto& value = tuple[key];
-			bool isWidth = key == "width";
-			bool isHeight = key == "height";
-			if (isWidth || isHeight)
-			{
-				size_t i, j, len;
-				len = key.size();
-				//Both Trip
-				for (i = 0; i < value.size(); ++i)
-				{
-					if (value[i] != ' ') break;
-				}
-				for (j = value.size(); j > 1; --j)
-				{
-					if (value[j - 1] != ' ') break;
-				}
+		// Back to the element before any attribute or rule was applied.  The
+		// markup and the identity stay, and so do the flags not set by style.
+		// Resolved lengths are left to layout.
+		void ResetStyle() {
+			lengths = ElementLengths();
+			display = ElementDisplay::Block;
+			flex = FlexStyle();
+			halign = ElementHorizontalAlign::Left;
+			valign = ElementVerticalAlign::Top;
+			pclip = ElementParentClipDirection::Horizontal;
+			background_color = { 1.f, 1.f, 1.f, 1.f };
+			border_color = { 0.f, 0.f, 0.f, 1.f };
+			flags &= ~(uint16_t)(ElementFlag::RatioSizeWidth | ElementFlag::RatioSizeHeight | ElementFlag::RatioHorizontalAlign | ElementFlag::RatioVerticalAlign);
+			tuple = attributes;
+		}
 
-				//Parse suffix %, px
-				if (value[j - 2] == 'p' && value[j - 1] == 'x')
-				{
-					//std::cout << "|" << value.substr(i, j - i - 1) << "~px" << std::endl;
-					if (isWidth)
-					{
-						std::from_chars(&value.at(i), &value.at(j - 1), size.w);
-						//std::cout << value.substr(i, j - i - 1) << " = " << size.w << std::endl;
-						//this->size.w = std::stof(std::string_view(&value.at(i), j - i - 1));
-						flags &= ~(uint64_t)ElementFlag::RatioSizeWidth;
-					}
-					else if (isHeight)
-					{
-						std::from_chars(&value.at(i), &value.at(j - 1), size.h);
-						//std::cout << value.substr(i, j - i - 1) << " = " << size.h << std::endl;
-						flags &= ~(uint64_t)ElementFlag::RatioSizeHeight;
-					}
-				}
-				else if (value[len - 1] == '%')
-				{
-					//std::cout << "|" << value.substr(i, j - i) << "~%" << std::endl;
-					if (isWidth)
-					{
-						std::from_chars(&value.at(i), &value.at(j - 1), this->size.w);
-						this->size.w /= 100.f;
-						this->flags |= (uint64_t)ElementFlag::RatioSizeWidth;
-					}
-					else if (isHeight)
-					{
-						std::from_chars(&value.at(i), &value.at(j - 1), this->size.h);
-						this->size.h /= 100.f;
-						this->flags |= (uint64_t)ElementFlag::RatioSizeHeight;
-					}
-				}
+		// class, id and style are left to ApplyStyle.
+		void ApplyAttributes() {
+			for (const auto& a : attributes) tupleChanged(a.first);
+		}
 
-				//std::cout << "|" << value.substr(i, j - i + 1) << "|" << value.substr(j - i, 1) << std::endl;
+		void tupleChanged(const std::string& key) {
+			tupleChanged(key, tuple[key]);
+		}
 
+		// value is tuple[key].
+		void tupleChanged(const std::string& key, const std::string& value) {
+#ifdef YTML_TRACE
+			std::cout << "{" << key << ":" << value  << "}" << std::endl;
+#endif
+			if (key == "width" || key == "height")
+			{
+				Length l;
+				if (!ParseLength(value, l)) return;
+				const bool isWidth = key == "width";
+				(isWidth ? lengths.width : lengths.height) = l;
+				const uint16_t ratio = isWidth ? ElementFlag::RatioSizeWidth : ElementFlag::RatioSizeHeight;
+				if (l.unit == LengthUnit::Percent) flags |= ratio;
+				else flags &= ~ratio;
 			}
 			else if (key == "margin")
 			{
-				std::vector<std::string_view> sv;
-				SplitByBlank(sv, value);
-				int i = 0;
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(0);
-					std::from_chars(v.data(), v.data() + v.size(), this->margin.left);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(1);
-					std::from_chars(v.data(), v.data() + v.size(), this->margin.top);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(2);
-					std::from_chars(v.data(), v.data() + v.size(), this->margin.right);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(3);
-					std::from_chars(v.data(), v.data() + v.size(), this->margin.bottom);
-				}
+				ParseBox(value, lengths.margin);
 			}
 			else if (key == "border")
 			{
-				std::vector<std::string_view> sv;
-				SplitByBlank(sv, value);
-				int i = 0;
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(0);
-					std::from_chars(v.data(), v.data() + v.size(), this->border.left);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(1);
-					std::from_chars(v.data(), v.data() + v.size(), this->border.top);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(2);
-					std::from_chars(v.data(), v.data() + v.size(), this->border.right);
-				}
-				if (i++ < sv.size())
-				{
-					const auto& v = sv.at(3);
-					std::from_chars(v.data(), v.data() + v.size(), this->border.bottom);
-				}
+				ParseBox(value, lengths.border);
 			}
-			else if (key == "style")
+			else if (key == "border-radius")
 			{
-				ReadStyle(value, style);
+				// One radius for all corners, the first given.
+				std::string_view rest = value;
+				ParseLength(NextValueToken(rest), lengths.border_radius);
 			}
-			else if (key == "class")
+			else if (key == "font-size")
 			{
-				std::vector<std::string_view> sv;
-				SplitByBlank(sv, value);
-
-				for (const auto& s : sv)
-				{
-					if (auto itr = style.find("." + std::string(s)); itr != style.end())
-					{
-						ReadStyle(itr->second, style);
-					}
-				}
-
+				ParseLength(value, lengths.font_size);
 			}
-			else if (key == "id")
+			else if (key == "display")
 			{
-				std::vector<std::string_view> sv;
-				SplitByBlank(sv, value);
-
-				for (const auto& s : sv)
-				{
-					if (auto itr = style.find("#" + std::string(s)); itr != style.end())
-					{
-						ReadStyle(itr->second, style);
-					}
-				}
+				ParseDisplay(value, display);
+			}
+			else if (key == "flex-direction")
+			{
+				ParseFlexDirection(value, flex.direction);
+			}
+			else if (key == "flex-wrap")
+			{
+				ParseFlexWrap(value, flex.wrap);
+			}
+			else if (key == "justify-content")
+			{
+				ParseFlexJustify(value, flex.justify);
+			}
+			else if (key == "align-items")
+			{
+				ParseFlexAlign(value, flex.align);
+			}
+			else if (key == "gap")
+			{
+				ParseGap(value, flex);
+			}
+			else if (key == "row-gap")
+			{
+				ParseLength(value, flex.row_gap);
+			}
+			else if (key == "column-gap")
+			{
+				ParseLength(value, flex.column_gap);
+			}
+			else if (key == "flex")
+			{
+				ParseFlexShorthand(value, flex);
+			}
+			else if (key == "flex-grow")
+			{
+				ParseNumberValue(value, flex.grow);
+			}
+			else if (key == "flex-shrink")
+			{
+				ParseNumberValue(value, flex.shrink);
+			}
+			else if (key == "flex-basis")
+			{
+				ParseLength(value, flex.basis);
 			}
 			else if (key == "background-color")
 			{
-				size_t i, j, len;
-				len = key.size();
-				//Both Trip
-				for (i = 0; i < value.size(); ++i)
-				{
-					if (value[i] != ' ') break;
-				}
-				for (j = value.size(); j > 1; --j)
-				{
-					if (value[j - 1] != ' ') break;
-				}
-				if (value[i] == '#')
-				{
-					std::string s = value.substr(i + 1, j - i - 1);
-
-					int hex = 0;
-
-					sscanf_s(s.c_str(), "%x", &hex);
-					
-					background_color = DirectX::XMFLOAT4(
-					(hex & 0xff) / 255.f,
-					((hex >> 8) & 0xff) / 255.f,
-					((hex >> 16) & 0xff) / 255.f, 1.f);
-
-				}
+				ParseColor(value, background_color);
 			}
 			else if (key == "border-color")
 			{
-				size_t i, j, len;
-				len = key.size();
-				//Both Trip
-				for (i = 0; i < value.size(); ++i)
-				{
-					if (value[i] != ' ') break;
-				}
-				for (j = value.size(); j > 1; --j)
-				{
-					if (value[j - 1] != ' ') break;
-				}
-				if (value[i] == '#')
-				{
-					std::string s = value.substr(i + 1, j - i - 1);
-
-					int hex = 0;
-
-					sscanf_s(s.c_str(), "%x", &hex);
-
-					border_color = DirectX::XMFLOAT4(
-						(hex & 0xff) / 255.f,
-						((hex >> 8) & 0xff) / 255.f,
-						((hex >> 16) & 0xff) / 255.f, 1.f);
-
-				}
+				ParseColor(value, border_color);
 			}
 		}
 
-		void ReadStyle(const std::string str, std::unordered_map<std::string, std::string>& style)
+		// A property without a value is only recorded in the tuple.
+		void ApplyDeclarations(const std::vector<StyleDeclaration>& declarations)
 		{
-			std::vector<std::string_view> sv;
-			size_t start = -1;
-			for (size_t i = 0; i < str.size(); ++i)
+			for (const auto& d : declarations)
 			{
-				if (str.at(i) == ';')
-				{
-					if (start != -1)
-					{
-						sv.push_back(std::string_view(&str.at(start), i - start));
-						start = -1;
-					}
-				}
-				else if (start == -1) start = i;
-			}
-			if (start != -1)
-			{
-				sv.push_back(std::string_view(&str.at(start), str.size() - start));
-				start = -1;
+				std::string& value = tuple[d.property];
+				value = d.value;
+				if (d.hasValue) tupleChanged(d.property, value);
 			}
+		}
 
-			for (const auto& s : sv)
-			{
-				for (start = 0; start < s.size(); ++start) if (s.at(start) == ':') break;
-				if (start != s.size())
-				{
-					size_t i = 0, j = 0, size;
-					std::string header, trailer;
-					std::string_view sv;
-
-
-					size = 0;
-					for (i = 0; i < start; ++i) if (s.at(i) != '\n' && s.at(i) != '\r') ++size;
-					header.resize(size);
-					j = 0;
-					for (i = 0; i < start; ++i) if (s.at(i) != '\n' && s.at(i) != '\r') header.at(j++) = s.at(i);
-
-					for (i = 0; i < header.size(); ++i)
-					{
-						if (header[i] != ' ') break;
-					}
-					for (j = header.size(); j > 1; --j)
-					{
-						if (header[j - 1] != ' ') break;
-					}
-
-					header = std::string_view(&header.at(i), j - i);
-
-
-					size = 0;
-					for (i = start + 1; i < s.size(); ++i) if (s.at(i) != '\n' && s.at(i) != '\r') ++size;
-					trailer.resize(size);
-					j = 0;
-					for (i = start + 1; i < s.size(); ++i) if (s.at(i) != '\n' && s.at(i) != '\r') trailer.at(j++) = s.at(i);
-
-					for (i = 0; i < trailer.size(); ++i)
-					{
-						if (trailer[i] != ' ') break;
-					}
-					for (j = trailer.size(); j > 1; --j)
-					{
-						if (trailer[j - 1] != ' ') break;
-					}
-
-					trailer = std::string_view(&trailer.at(i), j - i);
-
-					tuple[header] = trailer;
-					tupleChanged(header, style);
-					//std::cout << "{" << header << "~" << trailer << "}" << std::endl;
-				}
-				else
-				{
-					size_t size = 0, i, j = 0;
-					std::string header;
-
-					size = 0;
-					for (i = 0; i < start; ++i) if (s.at(i) != '\n' && s.at(i) != '\r') ++size;
-					header.resize(size);
-					j = 0;
-					for (i = 0; i < start; ++i) if (s.at(i) != '\n' && s.at(i) != '\r') header.at(j++) = s.at(i);
-
-					for (i = 0; i < header.size(); ++i)
-					{
-						if (header[i] != ' ') break;
-					}
-					for (j = header.size(); j > 1; --j)
-					{
-						if (header[j - 1] != ' ') break;
-					}
-
-					header = std::string_view(&header.at(i), j - i);
-					//std::cout << "[" << header << "]" << std::endl;
-					tuple[header] = "";
-				}
-			}
+		void ReadStyle(const std::string& str)
+		{
+			thread_local std::vector<StyleDeclaration> declarations;
+			ParseDeclarations(str, declarations);
+			ApplyDeclarations(declarations);
 		}
 
 	};
@@ -482,6 +342,7 @@ inline namespace YTML1_1
 	struct Tree {
 		Element value;
 		std::vector<Tree*> child;
+		Tree* parent = nullptr;
 
 		[[nodiscard]] Element* operator-> () {
 			return &value;
@@ -569,78 +430,610 @@ inline namespace YTML1_1
 		}
 	}
 
-	inline void RunYTML1_1(YTML1_1::Tree& MainDisplay, const std::function<void(Element&, bool&)>& user_func)
+	struct LayoutStats {
+		size_t elements = 0;
+		// Elements whose lengths were resolved again rather than kept.
+		size_t resolved = 0;
+		// Flex containers sized by their content, and the times such a size
+		// was asked for again in the same run and found already measured.
+		size_t measured = 0;
+		size_t measure_hits = 0;
+	};
+
+	// What one RunYTML1_1 threads through the tree.
+	struct LayoutPass {
+		const std::function<void(Element&, bool&)>& user_func;
+		bool& run;
+		LayoutStats& stats;
+		// Tells this run's measurements from those of earlier ones.
+		uint32_t id;
+		// Set by RunYTML1_1Parallel: takes the children of a placed node, to
+		// lay out elsewhere, and returns true, or returns false to have them
+		// laid out right away.  See YTMLParallel.hpp.
+		std::function<bool(Tree& node, const FloatRect& rect, const LengthBasis& basis)> defer = nullptr;
+	};
+
+	// The layout of the children of an element that manages them itself.
+	struct ChildLayout {
+		virtual ~ChildLayout() = default;
+
+		// Lays out the children of node, already placed in the basis its
+		// parent gives it, and calls pass.user_func on the ones placed.
+		virtual void LayoutChildren(Tree& node, const LengthBasis& basis, LayoutPass& pass) = 0;
+	};
+
+	// px of l.  Percentages are of percent_of, em of em; what the result
+	// depends on is added to dependencies.
+	inline float ResolveLength(const Length& l, float percent_of, uint8_t percent_dependency, float em, uint8_t em_dependencies,
+		const LengthBasis& basis, uint8_t& dependencies)
+	{
+		switch (l.unit)
+		{
+		case LengthUnit::Percent:
+			dependencies |= percent_dependency;
+			return l.value * percent_of / 100.f;
+		case LengthUnit::Em:
+			dependencies |= em_dependencies;
+			return l.value * em;
+		case LengthUnit::Rem:
+			dependencies |= DependsRootFont;
+			return l.value * basis.root_font;
+		case LengthUnit::Vw:
+			dependencies |= DependsViewport;
+			return l.value * basis.viewport_w / 100.f;
+		case LengthUnit::Vh:
+			dependencies |= DependsViewport;
+			return l.value * basis.viewport_h / 100.f;
+		default:
+			return l.value;
+		}
+	}
+
+	// Like CSS: width and every side of margin and border take percentages of
+	// the parent's content width, height of its content height and
+	// border-radius of the element's own width.  em is the element's font
+	// size, except in font-size itself, where it is the parent's.
+	inline void ResolveLengths(Element& e, const LengthBasis& basis)
+	{
+		const ElementLengths& l = e.lengths;
+		uint8_t font = 0;
+		e.font_size = ResolveLength(l.font_size, basis.font, DependsParentFont, basis.font, DependsParentFont, basis, font);
+		const float em = e.font_size;
+
+		uint8_t width = 0, dependencies = font;
+		e.size.w = ResolveLength(l.width, basis.width, DependsParentWidth, em, font, basis, width);
+		e.size.h = ResolveLength(l.height, basis.height, DependsParentHeight, em, font, basis, dependencies);
+		auto side = [&](const Length& s) { return ResolveLength(s, basis.width, DependsParentWidth, em, font, basis, dependencies); };
+		e.margin.left = side(l.margin.left);
+		e.margin.top = side(l.margin.top);
+		e.margin.right = side(l.margin.right);
+		e.margin.bottom = side(l.margin.bottom);
+		e.border.left = side(l.border.left);
+		e.border.top = side(l.border.top);
+		e.border.right = side(l.border.right);
+		e.border.bottom = side(l.border.bottom);
+		e.border_radius = ResolveLength(l.border_radius, e.size.w, width, em, font, basis, dependencies);
+
+		e.resolved_basis = basis;
+		e.length_dependencies = dependencies | width;
+		e.lengths_resolved = true;
+	}
+
+	// False if e was restyled or a part of the basis its lengths depend on
+	// changed since they were resolved.
+	inline bool LengthsCurrent(const Element& e, const LengthBasis& basis)
+	{
+		if (!e.lengths_resolved || (e.flags & ElementFlag::LayoutDirty)) return false;
+		const LengthBasis& r = e.resolved_basis;
+		const uint8_t d = e.length_dependencies;
+		if (d == 0) return true;
+		return !((d & DependsParentWidth) && r.width != basis.width) &&
+			!((d & DependsParentHeight) && r.height != basis.height) &&
+			!((d & DependsParentFont) && r.font != basis.font) &&
+			!((d & DependsRootFont) && r.root_font != basis.root_font) &&
+			!((d & DependsViewport) && (r.viewport_w != basis.viewport_w || r.viewport_h != basis.viewport_h));
+	}
+
+	inline void ResolveIfStale(Element& e, const LengthBasis& basis, LayoutStats& stats)
+	{
+		if (LengthsCurrent(e, basis)) return;
+		ResolveLengths(e, basis);
+		++stats.resolved;
+	}
+
+	// The basis of the children of flex container e, whose parent gives it
+	// basis.  An auto width or height is the space e was given rather than
+	// the size its content makes it, so its children resolve and measure the
+	// same when e is measured as when they are arranged.
+	inline LengthBasis FlexInnerBasis(const Element& e, const LengthBasis& basis)
+	{
+		LengthBasis inner = basis;
+		inner.width = (AutoLength(e.lengths.width) ? basis.width : e.size.w) - e.border.left - e.border.right;
+		inner.height = (AutoLength(e.lengths.height) ? basis.height : e.size.h) - e.border.top - e.border.bottom;
+		inner.font = e.font_size;
+		return inner;
+	}
+
+	// A flex item on its way through FlexCompute.  Sizes and margins are
+	// along the container's main and cross axes; positions are of the border
+	// box, from the container's content box.
+	struct FlexItem {
+		Tree* node;
+		float base, main, cross;
+		float main_before, main_after, cross_before, cross_after;
+		float main_pos, cross_pos;
+		bool auto_cross;
+	};
+
+	struct FlexLine {
+		size_t first, last;
+	};
+
+	// Scratch for FlexCompute, used as stacks: a call pushes above what its
+	// callers left and pops back when done, so nested containers share them.
+	inline std::vector<FlexItem>& FlexItems()
+	{
+		thread_local std::vector<FlexItem> items;
+		return items;
+	}
+
+	inline std::vector<FlexLine>& FlexLines()
+	{
+		thread_local std::vector<FlexLine> lines;
+		return lines;
+	}
+
+	inline FloatSize MeasureYTML1_1(Tree& node, const LengthBasis& basis, LayoutPass& pass);
+
+	// Lays the children of node out as flex items in a content box of main by
+	// cross, the main not being definite while an auto size is measured, in
+	// which case items keep their base sizes and pack at the start.  Leaves
+	// the items on FlexItems(), in document order, above where it stood on
+	// entry; returns the content size they take.
+	inline FloatSize FlexCompute(Tree& node, const LengthBasis& inner, float main, float cross, bool main_definite, bool cross_definite,
+		LayoutPass& pass)
 	{
-		YTML1_1::LoopTree_L([&](YTML1_1::Element & t, YTML1_1::FloatRect r, bool& run)
+		const Element& e = node.value;
+		const FlexStyle& f = e.flex;
+		const bool row = FlexRow(f.direction), reverse = FlexReverse(f.direction), wrap = f.wrap == FlexWrap::Wrap;
+		uint8_t unused = 0;
+		// column-gap is of the width, row-gap of the height, whichever runs
+		// along the main axis.
+		const float main_gap = ResolveLength(row ? f.column_gap : f.row_gap, row ? inner.width : inner.height, 0, inner.font, 0, inner, unused);
+		const float cross_gap = ResolveLength(row ? f.row_gap : f.column_gap, row ? inner.height : inner.width, 0, inner.font, 0, inner, unused);
+
+		// Hypothetical sizes: flex-basis, else the size the item is given or
+		// measured at.
+		std::vector<FlexItem>& items = FlexItems();
+		const size_t first = items.size();
+		const bool stretched = f.align == FlexAlign::Stretch && !wrap && cross_definite;
+		for (Tree* c : node.child)
+		{
+			Element& ce = c->value;
+			// Content is measured only for a size nothing else gives: an auto
+			// main size without a flex-basis, or an auto cross size not
+			// stretched to the container's.
+			const bool auto_main = AutoLength(ce.flex.basis) && AutoLength(row ? ce.lengths.width : ce.lengths.height);
+			const bool auto_cross = AutoLength(row ? ce.lengths.height : ce.lengths.width);
+			FloatSize measured;
+			if (auto_main || (auto_cross && !stretched)) measured = MeasureYTML1_1(*c, inner, pass);
+			else
 			{
-				YTML1_1::FloatRect rect = r;
-				switch (t.halign)
-				{
-				case YTML1_1::ElementHorizontalAlign::Left:
-					rect.x += t.margin.left;
-					rect.w -= t.margin.left;
-					break;
-				case YTML1_1::ElementHorizontalAlign::Center:
-					rect.x += (r.w - t.size.w) / 2;
-					rect.w -= t.size.w;
-					break;
-				case YTML1_1::ElementHorizontalAlign::Right:
-					rect.w -= t.margin.right;
-					break;
-				}
-				switch (t.valign)
-				{
-				case YTML1_1::ElementVerticalAlign::Top:
-					rect.y += t.margin.top;
-					rect.h -= t.margin.top;
-					break;
-				case YTML1_1::ElementVerticalAlign::Middle:
-					rect.y += (r.h - t.size.h) / 2;
-					rect.h -= t.size.h;
-					break;
-				case YTML1_1::ElementVerticalAlign::Bottom:
-					rect.h -= t.margin.bottom;
-					break;
-				}
+				ResolveIfStale(ce, inner, pass.stats);
+				measured = ce.size;
+			}
+			const FourDirection& m = ce.margin;
+			FlexItem it;
+			it.node = c;
+			it.base = AutoLength(ce.flex.basis) ? (row ? measured.w : measured.h) :
+				ResolveLength(ce.flex.basis, row ? inner.width : inner.height, 0, ce.font_size, 0, inner, unused);
+			it.main = it.base;
+			it.cross = row ? measured.h : measured.w;
+			// Reversed, the main axis runs from the far side, and so do its margins.
+			it.main_before = row ? (reverse ? m.right : m.left) : (reverse ? m.bottom : m.top);
+			it.main_after = row ? (reverse ? m.left : m.right) : (reverse ? m.top : m.bottom);
+			it.cross_before = row ? m.top : m.left;
+			it.cross_after = row ? m.bottom : m.right;
+			it.auto_cross = auto_cross;
+			items.push_back(it);
+		}
+		const size_t end = items.size();
 
-				//[Will]Check Overflow
-				rect.w = t.size.w;
-				rect.h = t.size.h;
-				//
-				t.size_in_display = rect;
-				user_func(t, run);
+		std::vector<FlexLine>& lines = FlexLines();
+		const size_t first_line = lines.size();
+		for (size_t i = first; i < end;)
+		{
+			FlexLine line = { i, i };
+			for (float used = 0.f; i < end; ++i)
+			{
+				const FlexItem& it = items[i];
+				const float outer = it.main_before + it.base + it.main_after + (i > line.first ? main_gap : 0.f);
+				if (wrap && i > line.first && used + outer > main) break;
+				used += outer;
+			}
+			line.last = i;
+			lines.push_back(line);
+		}
+
+		float content_main = 0.f, line_pos = 0.f;
+		for (size_t l = first_line; l < lines.size(); ++l)
+		{
+			const FlexLine line = lines[l];
+			const size_t count = line.last - line.first;
 
-				//Parent Clip
-				switch (t.pclip)
+			// Grow into the free space, or shrink out of the overflow in
+			// proportion to flex-shrink times the base size.
+			float used = main_gap * (count - 1), grow = 0.f, shrink = 0.f;
+			for (size_t i = line.first; i < line.last; ++i)
+			{
+				const FlexItem& it = items[i];
+				const FlexStyle& s = it.node->value.flex;
+				used += it.main_before + it.base + it.main_after;
+				grow += s.grow;
+				shrink += s.shrink * it.base;
+			}
+			const float free = main_definite ? main - used : 0.f;
+			if ((free > 0.f && grow > 0.f) || (free < 0.f && shrink > 0.f))
+			{
+				used = main_gap * (count - 1);
+				for (size_t i = line.first; i < line.last; ++i)
 				{
-				case ElementParentClipDirection::Horizontal:
-					switch (t.halign)
-					{
-					case YTML1_1::ElementHorizontalAlign::Left:
-						r.x += t.margin.left + rect.w;
-						r.w -= t.margin.left + rect.w;
-						break;
-					case YTML1_1::ElementHorizontalAlign::Right:
-						r.w -= t.margin.right + rect.w;
-						break;
-					}
-					break;
-				case ElementParentClipDirection::Vertical:
-					switch (t.valign)
-					{
-					case YTML1_1::ElementVerticalAlign::Top:
-						r.y += t.margin.top + rect.h;
-						r.h -= t.margin.top + rect.h;
-						break;
-					case YTML1_1::ElementVerticalAlign::Bottom:
-						r.h -= t.margin.bottom + rect.h;
-						break;
-					}
-					break;
+					FlexItem& it = items[i];
+					const FlexStyle& s = it.node->value.flex;
+					it.main = free > 0.f ? it.base + free * s.grow / grow : std::max(0.f, it.base + free * s.shrink * it.base / shrink);
+					used += it.main_before + it.main + it.main_after;
 				}
-				return r;
-			},
-			MainDisplay);
+			}
+
+			// A single line fills a definite container's cross size.
+			float line_cross = 0.f;
+			if (!wrap && cross_definite) line_cross = cross;
+			else
+			{
+				for (size_t i = line.first; i < line.last; ++i)
+					line_cross = std::max(line_cross, items[i].cross_before + items[i].cross + items[i].cross_after);
+			}
+
+			float left = main_definite ? main - used : 0.f, offset = 0.f, between = 0.f;
+			FlexJustify justify = f.justify;
+			// Overflowing, the space-* modes fall back like CSS.
+			if (left < 0.f && justify == FlexJustify::SpaceBetween) justify = FlexJustify::Start;
+			if (left < 0.f && (justify == FlexJustify::SpaceAround || justify == FlexJustify::SpaceEvenly)) justify = FlexJustify::Center;
+			switch (justify)
+			{
+			case FlexJustify::Start: break;
+			case FlexJustify::End: offset = left; break;
+			case FlexJustify::Center: offset = left / 2.f; break;
+			case FlexJustify::SpaceBetween: between = count > 1 ? left / (count - 1) : 0.f; break;
+			case FlexJustify::SpaceAround: between = left / count; offset = between / 2.f; break;
+			case FlexJustify::SpaceEvenly: between = left / (count + 1); offset = between; break;
+			}
+
+			const float extent = main_definite ? main : used;
+			float pos = offset;
+			for (size_t i = line.first; i < line.last; ++i)
+			{
+				FlexItem& it = items[i];
+				it.main_pos = pos + it.main_before;
+				pos = it.main_pos + it.main + it.main_after + main_gap + between;
+				if (reverse) it.main_pos = extent - it.main_pos - it.main;
+
+				if (it.auto_cross && f.align == FlexAlign::Stretch) it.cross = std::max(0.f, line_cross - it.cross_before - it.cross_after);
+				const float room = line_cross - it.cross_before - it.cross - it.cross_after;
+				it.cross_pos = line_pos + it.cross_before;
+				if (f.align == FlexAlign::End) it.cross_pos += room;
+				else if (f.align == FlexAlign::Center) it.cross_pos += room / 2.f;
+			}
+			content_main = std::max(content_main, used);
+			line_pos += line_cross + (l + 1 < lines.size() ? cross_gap : 0.f);
+		}
+		lines.resize(first_line);
+		return row ? FloatSize{ content_main, line_pos } : FloatSize{ line_pos, content_main };
+	}
+
+	// The border box size of node in basis, the one its parent gives it.  A
+	// flex container with an auto width or height takes it from its content;
+	// that is measured once per run for each basis it is asked for in, as
+	// nested containers ask again when they are arranged.  Other elements
+	// are the size their lengths make them.
+	inline FloatSize MeasureYTML1_1(Tree& node, const LengthBasis& basis, LayoutPass& pass)
+	{
+		Element& e = node.value;
+		ResolveIfStale(e, basis, pass.stats);
+		const bool auto_w = AutoLength(e.lengths.width), auto_h = AutoLength(e.lengths.height);
+		if (e.display != ElementDisplay::Flex || e.child_layout || !(auto_w || auto_h)) return e.size;
+
+		for (const Element::Measurement& m : e.measured)
+		{
+			if (m.pass == pass.id && m.width == basis.width && m.height == basis.height)
+			{
+				++pass.stats.measure_hits;
+				return m.size;
+			}
+		}
+		++pass.stats.measured;
+
+		const LengthBasis inner = FlexInnerBasis(e, basis);
+		const bool row = FlexRow(e.flex.direction);
+		const size_t first = FlexItems().size();
+		const FloatSize content = FlexCompute(node, inner, row ? inner.width : inner.height, row ? inner.height : inner.width,
+			!(row ? auto_w : auto_h), !(row ? auto_h : auto_w), pass);
+		FlexItems().resize(first);
+
+		FloatSize size = e.size;
+		if (auto_w) size.w = content.w + e.border.left + e.border.right;
+		if (auto_h) size.h = content.h + e.border.top + e.border.bottom;
+		Element::Measurement& m = e.measured[e.next_measured];
+		e.next_measured ^= 1;
+		m.pass = pass.id;
+		m.width = basis.width;
+		m.height = basis.height;
+		m.size = size;
+		return size;
+	}
+
+	inline void LayoutChildren(Tree& node, FloatRect rect, const LengthBasis& basis, LayoutPass& pass);
+
+	// Arranges the children of flex container node, already placed in the
+	// basis its parent gives it, and lays out theirs.
+	inline void LayoutFlexChildren(Tree& node, const LengthBasis& basis, LayoutPass& pass)
+	{
+		const Element& e = node.value;
+		const LengthBasis inner = FlexInnerBasis(e, basis);
+		const FloatRect& d = e.size_in_display;
+		const float x = d.x + e.border.left, y = d.y + e.border.top;
+		const float w = d.w - e.border.left - e.border.right, h = d.h - e.border.top - e.border.bottom;
+		const bool row = FlexRow(e.flex.direction);
+
+		std::vector<FlexItem>& items = FlexItems();
+		const size_t first = items.size();
+		FlexCompute(node, inner, row ? w : h, row ? h : w, true, true, pass);
+		for (size_t i = first; pass.run && i < first + node.child.size(); ++i)
+		{
+			// A copy; laying out the item's children pushes onto items.
+			const FlexItem it = items[i];
+			Element& c = it.node->value;
+			FloatRect& r = c.size_in_display;
+			r.x = x + (row ? it.main_pos : it.cross_pos);
+			r.y = y + (row ? it.cross_pos : it.main_pos);
+			r.w = row ? it.main : it.cross;
+			r.h = row ? it.cross : it.main;
+			c.flags &= ~(uint16_t)ElementFlag::LayoutDirty;
+			++pass.stats.elements;
+			pass.user_func(c, pass.run);
+			if (!pass.run) break;
+
+			// Children of an item start from its margin box.
+			const FloatRect margin_box = { r.x - c.margin.left, r.y - c.margin.top,
+				r.w + c.margin.left + c.margin.right, r.h + c.margin.top + c.margin.bottom };
+			if (!pass.defer || !pass.defer(*it.node, margin_box, inner)) LayoutChildren(*it.node, margin_box, inner, pass);
+		}
+		items.resize(first);
+	}
+
+	// Places t in r, the space its parent has left, and returns what is left
+	// after it.
+	inline FloatRect PlaceElement(Element& t, FloatRect r, const std::function<void(Element&, bool&)>& user_func, bool& run)
+	{
+		YTML1_1::FloatRect rect = r;
+		switch (t.halign)
+		{
+		case YTML1_1::ElementHorizontalAlign::Left:
+			rect.x += t.margin.left;
+			rect.w -= t.margin.left;
+			break;
+		case YTML1_1::ElementHorizontalAlign::Center:
+			rect.x += (r.w - t.size.w) / 2;
+			rect.w -= t.size.w;
+			break;
+		case YTML1_1::ElementHorizontalAlign::Right:
+			rect.w -= t.margin.right;
+			break;
+		}
+		switch (t.valign)
+		{
+		case YTML1_1::ElementVerticalAlign::Top:
+			rect.y += t.margin.top;
+			rect.h -= t.margin.top;
+			break;
+		case YTML1_1::ElementVerticalAlign::Middle:
+			rect.y += (r.h - t.size.h) / 2;
+			rect.h -= t.size.h;
+			break;
+		case YTML1_1::ElementVerticalAlign::Bottom:
+			rect.h -= t.margin.bottom;
+			break;
+		}
+
+		//[Will]Check Overflow
+		rect.w = t.size.w;
+		rect.h = t.size.h;
+		//
+		t.size_in_display = rect;
+		t.flags &= ~(uint16_t)ElementFlag::LayoutDirty;
+		user_func(t, run);
+
+		//Parent Clip
+		switch (t.pclip)
+		{
+		case ElementParentClipDirection::Horizontal:
+			switch (t.halign)
+			{
+			case YTML1_1::ElementHorizontalAlign::Left:
+				r.x += t.margin.left + rect.w;
+				r.w -= t.margin.left + rect.w;
+				break;
+			case YTML1_1::ElementHorizontalAlign::Right:
+				r.w -= t.margin.right + rect.w;
+				break;
+			}
+			break;
+		case ElementParentClipDirection::Vertical:
+			switch (t.valign)
+			{
+			case YTML1_1::ElementVerticalAlign::Top:
+				r.y += t.margin.top + rect.h;
+				r.h -= t.margin.top + rect.h;
+				break;
+			case YTML1_1::ElementVerticalAlign::Bottom:
+				r.h -= t.margin.bottom + rect.h;
+				break;
+			}
+			break;
+		}
+		return r;
+	}
+
+	inline void LayoutYTML1_1(Tree& node, FloatRect& rect, const LengthBasis& basis, LayoutPass& pass)
+	{
+		Element& t = node.value;
+		ResolveIfStale(t, basis, pass.stats);
+		++pass.stats.elements;
+		if (t.display == ElementDisplay::Flex && (AutoLength(t.lengths.width) || AutoLength(t.lengths.height)))
+			t.size = MeasureYTML1_1(node, basis, pass);
+		FloatRect r = PlaceElement(t, rect, pass.user_func, pass.run);
+		if (!pass.run) return;
+
+		// Children start where their parent was placed from.
+		if (!pass.defer || !pass.defer(node, rect, basis)) LayoutChildren(node, rect, basis, pass);
+		rect = r;
+	}
+
+	// Lays out the children of node, placed in rect and basis.
+	inline void LayoutChildren(Tree& node, FloatRect rect, const LengthBasis& basis, LayoutPass& pass)
+	{
+		const Element& t = node.value;
+		if (t.child_layout)
+		{
+			t.child_layout->LayoutChildren(node, basis, pass);
+			return;
+		}
+		if (node.child.empty()) return;
+		if (t.display == ElementDisplay::Flex)
+		{
+			LayoutFlexChildren(node, basis, pass);
+			return;
+		}
+
+		LengthBasis inner = basis;
+		inner.width = t.size_in_display.w - t.border.left - t.border.right;
+		inner.height = t.size_in_display.h - t.border.top - t.border.bottom;
+		inner.font = t.font_size;
+		for (Tree* c : node.child)
+		{
+			LayoutYTML1_1(*c, rect, inner, pass);
+			if (!pass.run) return;
+		}
+	}
+
+	// A LayoutPass::id; never 0, which is no run at all, see Element::measured.
+	inline uint32_t NextLayoutPass()
+	{
+		static std::atomic<uint32_t> passes{ 0 };
+		uint32_t id = ++passes;
+		if (id == 0) id = ++passes;
+		return id;
+	}
+
+	inline FloatRect RootRect(const Tree& MainDisplay)
+	{
+		return { 0.f, 0.f, MainDisplay.value.size.w, MainDisplay.value.size.h };
+	}
+
+	// Places the root in its own size, which is also the viewport, and
+	// returns the basis of its children.  The root's lengths are not resolved.
+	inline LengthBasis PlaceRoot(Tree& MainDisplay, LayoutPass& pass)
+	{
+		Element& root = MainDisplay.value;
+		PlaceElement(root, RootRect(MainDisplay), pass.user_func, pass.run);
+		++pass.stats.elements;
+
+		LengthBasis viewport;
+		viewport.width = viewport.viewport_w = root.size.w;
+		viewport.height = viewport.viewport_h = root.size.h;
+		viewport.font = viewport.root_font = root.font_size;
+		return viewport;
+	}
+
+	// Lays out the tree in MainDisplay's size, which is also the viewport,
+	// and calls user_func on every element placed.  Relative lengths are
+	// resolved here and kept until what they depend on changes, so a resize
+	// only resolves the elements that depend on the viewport or on a parent
+	// whose size changed.  Elements with display: flex arrange their children
+	// as flex items, measuring those that size to their content first.
+	inline void RunYTML1_1(YTML1_1::Tree& MainDisplay, const std::function<void(Element&, bool&)>& user_func, LayoutStats* stats = nullptr)
+	{
+		LayoutStats s;
+		bool run = true;
+		LayoutPass pass = { user_func, run, s, NextLayoutPass() };
+		const LengthBasis viewport = PlaceRoot(MainDisplay, pass);
+		if (run) LayoutChildren(MainDisplay, RootRect(MainDisplay), viewport, pass);
+		if (stats) *stats = s;
+	}
+
+	// Where node is shown: its display rect moved by its translate and by the
+	// translate and scroll of its ancestors.
+	inline FloatRect DisplayRect(const Tree& node)
+	{
+		FloatRect r = node.value.size_in_display;
+		r.x += node.value.translate.x;
+		r.y += node.value.translate.y;
+		for (const Tree* p = node.parent; p != nullptr; p = p->parent)
+		{
+			r.x += p->value.translate.x - p->value.scroll.x;
+			r.y += p->value.translate.y - p->value.scroll.y;
+		}
+		return r;
+	}
+
+	// (dx, dy) is what the ancestors of node move it by.
+	inline void EmitSubtree(Tree& node, float dx, float dy, const std::function<void(Element&, const FloatRect&, bool&)>& user_func, bool& run)
+	{
+		Element& e = node.value;
+		dx += e.translate.x;
+		dy += e.translate.y;
+		const FloatRect& d = e.size_in_display;
+		user_func(e, { d.x + dx, d.y + dy, d.w, d.h }, run);
+		if (!run) return;
+		dx -= e.scroll.x;
+		dy -= e.scroll.y;
+		for (Tree* c : node.child)
+		{
+			EmitSubtree(*c, dx, dy, user_func, run);
+			if (!run) return;
+		}
+	}
+
+	// Calls user_func on every element of a laid out tree, in document order,
+	// with the rect it is shown in, its DisplayRect.  Scrolling or moving a
+	// pane only needs this again, not layout.
+	inline void EmitYTML1_1(YTML1_1::Tree& MainDisplay, const std::function<void(Element&, const FloatRect&, bool&)>& user_func)
+	{
+		bool run = true;
+		EmitSubtree(MainDisplay, 0.f, 0.f, user_func, run);
+	}
+
+	// (x, y) is the point with the offsets of node's ancestors taken off.
+	inline Element* HitTestSubtree(Tree& node, float x, float y)
+	{
+		Element& e = node.value;
+		x -= e.translate.x;
+		y -= e.translate.y;
+		const float cx = x + e.scroll.x, cy = y + e.scroll.y;
+		for (size_t i = node.child.size(); i-- > 0;)
+			if (Element* hit = HitTestSubtree(*node.child[i], cx, cy)) return hit;
+
+		const FloatRect& d = e.size_in_display;
+		if ((e.flags & ElementFlag::Enable) && x >= d.x && y >= d.y && x <= d.x + d.w && y <= d.y + d.h) return &e;
+		return nullptr;
+	}
+
+	// Topmost enabled element whose DisplayRect contains (x, y), or nullptr.
+	// Later siblings and children are drawn over earlier ones, so the tree is
+	// searched back to front.
+	inline Element* HitTest(YTML1_1::Tree& MainDisplay, float x, float y)
+	{
+		return HitTestSubtree(MainDisplay, x, y);
 	}
 
 	inline bool PossibleVariablename(const char& c)
@@ -648,7 +1041,7 @@ inline namespace YTML1_1
 		return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 	}
 
-	inline void ParseInnerBracket(YTML1_1::Element & e, const std::string_view& s, std::unordered_map<std::string, std::string>& style)
+	inline void ParseInnerBracket(YTML1_1::Element & e, const std::string_view& s)
 	{
 		std::string_view header = "";
 		std::string key;
@@ -703,8 +1096,9 @@ inline namespace YTML1_1
 						if (str_open) {
 							//Get value
 
-							e.tuple[key] = s.substr(str_index, i - str_index);
-							e.tupleChanged(key, style);
+							e.attributes[key] = s.substr(str_index, i - str_index);
+							e.tuple[key] = e.attributes[key];
+							e.tupleChanged(key);
 
 							wait_for_equal_sign = true;
 							last = i + 1;
@@ -720,23 +1114,114 @@ inline namespace YTML1_1
 		else
 		{
 			header = s;
+			e.head = header;
 		}
 	}
 
-	inline void ReadYTML1_1(const std::string& path, YTML1_1::Tree& MainDisplay, std::unordered_map<std::string, std::string>& style, size_t& biggest_id)
+	// Tag, id and classes of e as selectors see them.
+	inline void ReadSelectorElement(SelectorElement& subject, const YTML1_1::Element& e)
 	{
-		std::ifstream file(path);
-		std::vector<size_t> ind;
-		
-		std::vector<YTML1_1::Tree*> Parent;
-		Parent.push_back(&MainDisplay);
+		subject.tag = e.head;
+		subject.id = std::string_view();
+		subject.classes.clear();
+		if (auto itr = e.attributes.find("id"); itr != e.attributes.end())
+		{
+			const std::string& id = itr->second;
+			const size_t i = id.find_first_not_of(' ');
+			if (i != std::string::npos) subject.id = std::string_view(id).substr(i, id.find(' ', i) - i);
+		}
+		if (auto itr = e.attributes.find("class"); itr != e.attributes.end()) SplitByBlank(subject.classes, itr->second);
+	}
 
+	// Styles e from the rules matched, then from its style attribute, which
+	// wins over every rule.  The other attributes are already applied.
+	inline void ApplyRules(YTML1_1::Element& e, const std::vector<const StyleRule*>& rules)
+	{
+		for (const StyleRule* rule : rules) e.ApplyDeclarations(rule->properties);
 
-		if (file.bad()) return;
+		if (auto itr = e.attributes.find("style"); itr != e.attributes.end()) e.ReadStyle(itr->second);
+	}
 
-		std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	inline void ApplyStyle(YTML1_1::Element& e, StyleMatcher& matcher)
+	{
+		ReadSelectorElement(matcher.Subject(), e);
+		ApplyRules(e, matcher.Match());
+	}
 
-		file.close();
+	// A walk of the style pass down a tree, on one thread.
+	struct StylePass {
+		StyleMatcher matcher;
+		StyleCache& cache;
+		std::string key;
+		size_t hits = 0;
+
+		StylePass(const StyleSheet& sheet, StyleCache& cache) : matcher(sheet), cache(cache) {}
+
+		// Makes the children of node the elements styled next.  node and its
+		// ancestors go into the matcher, root first; the root itself is not
+		// an element of the document.
+		void Enter(const Tree& node)
+		{
+			std::vector<const Tree*> path;
+			for (const Tree* p = &node; p->parent != nullptr; p = p->parent) path.push_back(p);
+			for (auto itr = path.rbegin(); itr != path.rend(); ++itr)
+			{
+				ReadSelectorElement(matcher.Subject(), (*itr)->value);
+				matcher.Push();
+			}
+		}
+
+		SelectorStats Stats()const
+		{
+			SelectorStats s = matcher.Stats();
+			s.elements += hits;
+			s.cacheHits = hits;
+			return s;
+		}
+	};
+
+	// Styles the element of node, whose parent's context is parent, and
+	// returns its own context.
+	inline const StyleContext* StyleElement(Tree& node, const StyleContext* parent, StylePass& pass)
+	{
+		ReadSelectorElement(pass.matcher.Subject(), node.value);
+		bool hit = false;
+		const StyleContext& context = pass.cache.Match(parent, pass.matcher, pass.key, hit);
+		if (hit) ++pass.hits;
+		ApplyRules(node.value, context.rules);
+		return &context;
+	}
+
+	inline void StyleSubtree(Tree& node, const StyleContext* parent, StylePass& pass)
+	{
+		const StyleContext* context = StyleElement(node, parent, pass);
+		if (node.child.empty()) return;
+
+		pass.matcher.Push();
+		for (Tree* c : node.child) StyleSubtree(*c, context, pass);
+		pass.matcher.Pop();
+	}
+
+	// The style pass: applies the stylesheet to the elements below
+	// MainDisplay, from its child first on.  Their attributes are already
+	// applied; nothing of an element is needed to style another but the tag,
+	// id and classes of its ancestors.
+	inline void StyleYTML1_1(YTML1_1::Tree& MainDisplay, const StyleSheet& style, SelectorStats* stats = nullptr, size_t first = 0)
+	{
+		StyleCache cache;
+		StylePass pass(style, cache);
+		for (size_t i = first; i < MainDisplay.child.size(); ++i) StyleSubtree(*MainDisplay.child[i], nullptr, pass);
+		if (stats) *stats = pass.Stats();
+	}
+
+	// Builds the tree of a document below MainDisplay, applying the
+	// attributes but not the stylesheet.
+	inline void BuildYTML1_1(const std::string& str, YTML1_1::Tree& MainDisplay, size_t& biggest_id)
+	{
+		std::vector<size_t> ind;
+		
+		std::vector<YTML1_1::Tree*> Parent;
+		Parent.push_back(&MainDisplay);
 
 		bool forward_close = false;
 		bool back_close = false;
@@ -768,8 +1253,9 @@ inline namespace YTML1_1
 					YTML1_1::Tree* e = new YTML1_1::Tree();
 					e->value.eid = biggest_id++;
 
-					ParseInnerBracket(e->value, std::string_view(&str.at(*ind.crbegin()), i - *ind.crbegin() - 1), style);
+					ParseInnerBracket(e->value, std::string_view(&str.at(*ind.crbegin()), i - *ind.crbegin() - 1));
 					//std::cout << "( " << e->value.size.w << ", " << e->value.size.h << " )" << std::endl;
+					e->parent = *Parent.rbegin();
 					(*Parent.rbegin())->child.push_back(e);
 				}
 				else
@@ -778,9 +1264,10 @@ inline namespace YTML1_1
 					YTML1_1::Tree* e = new YTML1_1::Tree();
 					e->value.eid = biggest_id++;
 
-					ParseInnerBracket(e->value, std::string_view(&str.at(*ind.crbegin()), i - *ind.crbegin()), style);
+					ParseInnerBracket(e->value, std::string_view(&str.at(*ind.crbegin()), i - *ind.crbegin()));
 					//std::cout << "( " << e->value.size.w << ", " << e->value.size.h << " )" << std::endl;
 
+					e->parent = *Parent.rbegin();
 					(*Parent.rbegin())->child.push_back(e);
 					Parent.push_back(e);
 
@@ -799,4 +1286,25 @@ inline namespace YTML1_1
 		}
 	}
 
+	inline void ParseYTML1_1(const std::string& str, YTML1_1::Tree& MainDisplay, const StyleSheet& style, size_t& biggest_id, SelectorStats* stats = nullptr)
+	{
+		const size_t first = MainDisplay.child.size();
+		BuildYTML1_1(str, MainDisplay, biggest_id);
+		StyleYTML1_1(MainDisplay, style, stats, first);
+	}
+
+
+	inline void ReadYTML1_1(const std::string& path, YTML1_1::Tree& MainDisplay, const StyleSheet& style, size_t& biggest_id)
+	{
+		std::ifstream file(path);
+
+		if (file.bad()) return;
+
+		std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		file.close();
+
+		ParseYTML1_1(str, MainDisplay, style, biggest_id);
+	}
+
 }
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "YTMLValue.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+// Flexbox properties for YTML.  display: flex lays an element's children out
+// in lines along a main axis, row or column, growing and shrinking them to
+// fill each line and aligning them across it; everything else keeps the
+// original flow of RunYTML1_1, where the algorithm lives.  Lines are packed
+// at the cross start (align-content is not supported) and only
+// align-items, not align-self, aligns items.
+
+inline namespace YTML1_1
+{
+	enum class ElementDisplay : std::uint8_t {
+		Block, Flex
+	};
+
+	enum class FlexDirection : std::uint8_t {
+		Row, RowReverse, Column, ColumnReverse
+	};
+
+	enum class FlexWrap : std::uint8_t {
+		NoWrap, Wrap
+	};
+
+	enum class FlexJustify : std::uint8_t {
+		Start, End, Center, SpaceBetween, SpaceAround, SpaceEvenly
+	};
+
+	enum class FlexAlign : std::uint8_t {
+		Start, End, Center, Stretch
+	};
+
+	struct FlexStyle {
+		// Of a container.
+		FlexDirection direction = FlexDirection::Row;
+		FlexWrap wrap = FlexWrap::NoWrap;
+		FlexJustify justify = FlexJustify::Start;
+		FlexAlign align = FlexAlign::Stretch;
+		Length row_gap, column_gap;
+
+		// Of an item.
+		float grow = 0.f;
+		float shrink = 1.f;
+		Length basis = { 0.f, LengthUnit::Auto };
+
+		bool operator==(const FlexStyle& rhs)const
+		{
+			return direction == rhs.direction && wrap == rhs.wrap && justify == rhs.justify && align == rhs.align &&
+				row_gap == rhs.row_gap && column_gap == rhs.column_gap && grow == rhs.grow && shrink == rhs.shrink && basis == rhs.basis;
+		}
+	};
+
+	inline bool FlexRow(FlexDirection d)
+	{
+		return d == FlexDirection::Row || d == FlexDirection::RowReverse;
+	}
+
+	inline bool FlexReverse(FlexDirection d)
+	{
+		return d == FlexDirection::RowReverse || d == FlexDirection::ColumnReverse;
+	}
+
+	inline bool ParseDisplay(std::string_view s, ElementDisplay& out)
+	{
+		static constexpr ValueKeyword<ElementDisplay> keywords[] = {
+			{ "block", ElementDisplay::Block }, { "flex", ElementDisplay::Flex },
+		};
+		return ParseKeyword(s, keywords, out);
+	}
+
+	inline bool ParseFlexDirection(std::string_view s, FlexDirection& out)
+	{
+		static constexpr ValueKeyword<FlexDirection> keywords[] = {
+			{ "row", FlexDirection::Row }, { "row-reverse", FlexDirection::RowReverse },
+			{ "column", FlexDirection::Column }, { "column-reverse", FlexDirection::ColumnReverse },
+		};
+		return ParseKeyword(s, keywords, out);
+	}
+
+	inline bool ParseFlexWrap(std::string_view s, FlexWrap& out)
+	{
+		static constexpr ValueKeyword<FlexWrap> keywords[] = {
+			{ "nowrap", FlexWrap::NoWrap }, { "wrap", FlexWrap::Wrap },
+		};
+		return ParseKeyword(s, keywords, out);
+	}
+
+	inline bool ParseFlexJustify(std::string_view s, FlexJustify& out)
+	{
+		static constexpr ValueKeyword<FlexJustify> keywords[] = {
+			{ "flex-start", FlexJustify::Start }, { "start", FlexJustify::Start },
+			{ "flex-end", FlexJustify::End }, { "end", FlexJustify::End },
+			{ "center", FlexJustify::Center }, { "space-between", FlexJustify::SpaceBetween },
+			{ "space-around", FlexJustify::SpaceAround }, { "space-evenly", FlexJustify::SpaceEvenly },
+		};
+		return ParseKeyword(s, keywords, out);
+	}
+
+	inline bool ParseFlexAlign(std::string_view s, FlexAlign& out)
+	{
+		static constexpr ValueKeyword<FlexAlign> keywords[] = {
+			{ "flex-start", FlexAlign::Start }, { "start", FlexAlign::Start },
+			{ "flex-end", FlexAlign::End }, { "end", FlexAlign::End },
+			{ "center", FlexAlign::Center }, { "stretch", FlexAlign::Stretch },
+		};
+		return ParseKeyword(s, keywords, out);
+	}
+
+	// gap: a row gap and optionally a column gap, the same when left out.
+	inline bool ParseGap(std::string_view s, FlexStyle& out)
+	{
+		Length row, column;
+		if (!ParseLength(NextValueToken(s), row)) return false;
+		const std::string_view second = NextValueToken(s);
+		if (second.empty()) column = row;
+		else if (!ParseLength(second, column) || !NextValueToken(s).empty()) return false;
+		out.row_gap = row;
+		out.column_gap = column;
+		return true;
+	}
+
+	// flex: none, auto, or grow [shrink] [basis]; a lone grow has a basis of
+	// 0 so items share the whole line.
+	inline bool ParseFlexShorthand(std::string_view s, FlexStyle& out)
+	{
+		const std::string_view t = TrimValue(s);
+		const bool none = SameValueName(t, "none");
+		if (none || SameValueName(t, "auto"))
+		{
+			out.grow = out.shrink = none ? 0.f : 1.f;
+			out.basis = { 0.f, LengthUnit::Auto };
+			return true;
+		}
+
+		float grow = 0.f, shrink = 1.f;
+		Length basis = { 0.f, LengthUnit::Px };
+		if (!ParseNumberValue(NextValueToken(s), grow)) return false;
+		std::string_view token = NextValueToken(s);
+		if (!token.empty() && ParseNumberValue(token, shrink)) token = NextValueToken(s);
+		if (!token.empty() && (!ParseLength(token, basis) || !NextValueToken(s).empty())) return false;
+		out.grow = grow;
+		out.shrink = shrink;
+		out.basis = basis;
+		return true;
+	}
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "YTML1_1.hpp"
+#include "JobSystem.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Parallel layout and style for YTML.  Once an element is placed, the layout
+// below it depends only on the rect and basis it was placed in, so
+// RunYTML1_1Parallel hands the subtrees below placed elements, alone or with
+// their siblings', to JobSystem tasks of at least grain elements, which idle
+// workers steal, and every element joins the tasks it handed out before it
+// returns.  Each element goes through the same arithmetic as in RunYTML1_1,
+// so the rects come out bit-identical whatever the thread count or the order
+// tasks ran in.  user_func is called once layout is done, on the calling
+// thread and in the order RunYTML1_1 calls it; when it stops the run, the
+// rest of the tree is laid out all the same.
+//
+// Style goes the same way: an element is styled from the tag, id and classes
+// of its ancestors alone, so StyleYTML1_1Parallel styles subtrees in tasks,
+// each seeding its own StyleMatcher with the ancestors, and all of them share
+// one StyleCache.  Every element gets the rules StyleYTML1_1 would give it,
+// in the same order; only the cache hits, and the matching work they saved,
+// depend on the schedule.
+
+inline namespace YTML1_1
+{
+	// How many descendants node has, counting no further than limit.
+	inline size_t CountDescendants(const Tree& node, size_t limit)
+	{
+		size_t n = 0;
+		for (const Tree* c : node.child)
+		{
+			if (++n >= limit) return n;
+			n += CountDescendants(*c, limit - n);
+			if (n >= limit) return n;
+		}
+		return n;
+	}
+
+	inline void AddLayoutStats(LayoutStats& to, const LayoutStats& from)
+	{
+		to.elements += from.elements;
+		to.resolved += from.resolved;
+		to.measured += from.measured;
+		to.measure_hits += from.measure_hits;
+	}
+
+	struct ParallelLayout {
+		JobSystem& jobs;
+		uint32_t id;
+		size_t grain;
+	};
+
+	// Lays out the children of node, placed in rect and basis, and joins the
+	// tasks it hands the subtrees below them to.  Subtrees too small for a
+	// task of their own, like the rows of a grid, go in batches of at least
+	// grain elements; big ones are split again in their task.
+	inline void LayoutChildrenParallel(Tree& node, const FloatRect& rect, const LengthBasis& basis, const ParallelLayout& p, LayoutStats& stats)
+	{
+		struct Subtree {
+			Tree* node;
+			FloatRect rect;
+			LengthBasis basis;
+			bool split;
+		};
+		struct Batch {
+			size_t first, last;
+			LayoutStats stats;
+		};
+		std::vector<Subtree> subtrees;
+		std::vector<Batch> batches;
+		size_t batched = 0;
+
+		static const std::function<void(Element&, bool&)> nop = [](Element&, bool&) {};
+		bool run = true;
+		LayoutPass pass = { nop, run, stats, p.id };
+		pass.defer = [&](Tree& n, const FloatRect& r, const LengthBasis& b)
+		{
+			const size_t count = CountDescendants(n, p.grain);
+			subtrees.push_back({ &n, r, b, count >= p.grain });
+			batched += count;
+			if (batched >= p.grain)
+			{
+				batches.push_back({ batches.empty() ? 0 : batches.back().last, subtrees.size(), LayoutStats() });
+				batched = 0;
+			}
+			return true;
+		};
+		LayoutChildren(node, rect, basis, pass);
+
+		auto layout = [&p](const Subtree& s, LayoutStats& to)
+		{
+			if (s.split)
+			{
+				LayoutChildrenParallel(*s.node, s.rect, s.basis, p, to);
+				return;
+			}
+			bool run = true;
+			LayoutPass serial = { nop, run, to, p.id };
+			LayoutChildren(*s.node, s.rect, s.basis, serial);
+		};
+
+		// What did not fill a batch is laid out here, meanwhile.
+		const size_t rest = batches.empty() ? 0 : batches.back().last;
+		JobSystem::TaskGroup group;
+		group.Pending = (int)batches.size();
+		std::vector<JobSystem::Task> tasks(batches.size());
+		for (size_t i = 0; i < batches.size(); ++i)
+		{
+			Batch& batch = batches[i];
+			tasks[i].Work = [&subtrees, &batch, &layout]()
+			{
+				for (size_t k = batch.first; k < batch.last; ++k) layout(subtrees[k], batch.stats);
+			};
+			tasks[i].Group = &group;
+			p.jobs.Schedule(&tasks[i]);
+		}
+		for (size_t k = rest; k < subtrees.size(); ++k) layout(subtrees[k], stats);
+		if (!batches.empty()) p.jobs.Wait(group);
+
+		// In document order, so the sums do not depend on the schedule.
+		for (const Batch& batch : batches) AddLayoutStats(stats, batch.stats);
+	}
+
+	inline void AddSelectorStats(SelectorStats& to, const SelectorStats& from)
+	{
+		to.elements += from.elements;
+		to.candidates += from.candidates;
+		to.bloomRejects += from.bloomRejects;
+		to.matches += from.matches;
+		to.cacheHits += from.cacheHits;
+	}
+
+	struct ParallelStyle {
+		JobSystem& jobs;
+		const StyleSheet& sheet;
+		StyleCache& cache;
+		size_t grain;
+	};
+
+	// Styles the children of node from first on with pass, which has node
+	// entered, and joins the tasks it hands some of them to; context is
+	// node's.  As in LayoutChildrenParallel, small subtrees go in batches of
+	// at least grain elements and big ones are split again in their task.
+	// stats gets what the tasks counted; pass counts the rest.
+	inline void StyleChildrenParallel(Tree& node, size_t first, const StyleContext* context, StylePass& pass, const ParallelStyle& p,
+		SelectorStats& stats)
+	{
+		struct Subtree {
+			Tree* node;
+			bool split;
+		};
+		struct Batch {
+			size_t first, last;
+			SelectorStats stats;
+		};
+		std::vector<Subtree> subtrees;
+		std::vector<Batch> batches;
+		size_t batched = 0;
+		for (size_t i = first; i < node.child.size(); ++i)
+		{
+			Tree* c = node.child[i];
+			const size_t count = 1 + CountDescendants(*c, p.grain);
+			subtrees.push_back({ c, count > p.grain });
+			batched += count;
+			if (batched >= p.grain)
+			{
+				batches.push_back({ batches.empty() ? 0 : batches.back().last, subtrees.size(), SelectorStats() });
+				batched = 0;
+			}
+		}
+
+		auto style = [context, &p](const Subtree& s, StylePass& to, SelectorStats& nested)
+		{
+			if (!s.split)
+			{
+				StyleSubtree(*s.node, context, to);
+				return;
+			}
+			const StyleContext* own = StyleElement(*s.node, context, to);
+			to.matcher.Push();
+			StyleChildrenParallel(*s.node, 0, own, to, p, nested);
+			to.matcher.Pop();
+		};
+
+		// What did not fill a batch is styled here, meanwhile.
+		const size_t rest = batches.empty() ? 0 : batches.back().last;
+		JobSystem::TaskGroup group;
+		group.Pending = (int)batches.size();
+		std::vector<JobSystem::Task> tasks(batches.size());
+		for (size_t i = 0; i < batches.size(); ++i)
+		{
+			Batch& batch = batches[i];
+			tasks[i].Work = [&node, &subtrees, &batch, &style, &p]()
+			{
+				StylePass own(p.sheet, p.cache);
+				own.Enter(node);
+				SelectorStats nested;
+				for (size_t k = batch.first; k < batch.last; ++k) style(subtrees[k], own, nested);
+				batch.stats = own.Stats();
+				AddSelectorStats(batch.stats, nested);
+			};
+			tasks[i].Group = &group;
+			p.jobs.Schedule(&tasks[i]);
+		}
+		for (size_t k = rest; k < subtrees.size(); ++k) style(subtrees[k], pass, stats);
+		if (!batches.empty()) p.jobs.Wait(group);
+
+		for (const Batch& batch : batches) AddSelectorStats(stats, batch.stats);
+	}
+
+	// StyleYTML1_1 spread over jobs' workers in tasks of at least grain
+	// elements.
+	inline void StyleYTML1_1Parallel(YTML1_1::Tree& MainDisplay, const StyleSheet& style, JobSystem& jobs, SelectorStats* stats = nullptr,
+		size_t first = 0, size_t grain = 512)
+	{
+		// Alone, splitting the tree up only costs.
+		if (jobs.ThreadCount() == 1)
+		{
+			StyleYTML1_1(MainDisplay, style, stats, first);
+			return;
+		}
+
+		StyleCache cache;
+		StylePass pass(style, cache);
+		SelectorStats s;
+		StyleChildrenParallel(MainDisplay, first, nullptr, pass, { jobs, style, cache, grain > 0 ? grain : 1 }, s);
+		AddSelectorStats(s, pass.Stats());
+		if (stats) *stats = s;
+	}
+
+	// ParseYTML1_1 with the style pass of StyleYTML1_1Parallel.
+	inline void ParseYTML1_1Parallel(const std::string& str, YTML1_1::Tree& MainDisplay, const StyleSheet& style, size_t& biggest_id, JobSystem& jobs,
+		SelectorStats* stats = nullptr)
+	{
+		const size_t first = MainDisplay.child.size();
+		BuildYTML1_1(str, MainDisplay, biggest_id);
+		StyleYTML1_1Parallel(MainDisplay, style, jobs, stats, first);
+	}
+
+	inline void ReadYTML1_1Parallel(const std::string& path, YTML1_1::Tree& MainDisplay, const StyleSheet& style, size_t& biggest_id, JobSystem& jobs)
+	{
+		std::ifstream file(path);
+
+		if (file.bad()) return;
+
+		std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		file.close();
+
+		ParseYTML1_1Parallel(str, MainDisplay, style, biggest_id, jobs);
+	}
+
+	// RunYTML1_1 with layout spread over jobs' workers in tasks of at least
+	// grain elements.
+	inline void RunYTML1_1Parallel(YTML1_1::Tree& MainDisplay, JobSystem& jobs, const std::function<void(Element&, bool&)>& user_func,
+		LayoutStats* stats = nullptr, size_t grain = 512)
+	{
+		static const std::function<void(Element&, bool&)> nop = [](Element&, bool&) {};
+		LayoutStats s;
+		bool run = true;
+		LayoutPass pass = { nop, run, s, NextLayoutPass() };
+		const LengthBasis viewport = PlaceRoot(MainDisplay, pass);
+		// Alone, splitting the tree up only costs.
+		if (jobs.ThreadCount() == 1) LayoutChildren(MainDisplay, RootRect(MainDisplay), viewport, pass);
+		else LayoutChildrenParallel(MainDisplay, RootRect(MainDisplay), viewport, { jobs, pass.id, grain > 0 ? grain : 1 }, s);
+
+		RawLoopTree_L(user_func, MainDisplay, run);
+		if (stats) *stats = s;
+	}
+}
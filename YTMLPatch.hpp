@@ -0,0 +1,290 @@
+#pragma once
+
+#include "YTML1_1.hpp"
+#include "YTMLRestyle.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Hot reload of a live YTML tree.  A changed stylesheet restyles only the
+// elements its changed rules can match; a changed document is diffed against
+// the live tree and patched in place, so unchanged nodes keep their eid,
+// computed style and layout, and a new node costs only its own restyle.  Both
+// record their invalidations in a StyleInvalidator; Flush it afterwards.
+
+inline namespace YTML1_1
+{
+	struct TreePatchStats {
+		size_t kept = 0;
+		size_t added = 0;
+		size_t removed = 0;
+		size_t attributesChanged = 0;
+	};
+
+	inline bool SameRule(const StyleRule& a, const StyleRule& b)
+	{
+		if (a.declarations != b.declarations || a.combinators != b.combinators || a.compounds.size() != b.compounds.size()) return false;
+		for (size_t k = 0; k < a.compounds.size(); ++k)
+		{
+			const auto& x = a.compounds[k];
+			const auto& y = b.compounds[k];
+			if (x.tag != y.tag || x.id != y.id || x.classes != y.classes) return false;
+		}
+		return true;
+	}
+
+	// Invalidates the elements of tree that a rule found in only one of the
+	// sheets can match.  Rules are compared in order; only the run between the
+	// common head and tail of the two lists counts as changed, which keeps the
+	// relative order of everything else, so no other tie can flip.  Returns
+	// the number of elements invalidated.
+	inline size_t InvalidateChangedRules(Tree& tree, const StyleSheet& before, const StyleSheet& after, StyleInvalidator& invalidator)
+	{
+		const auto& a = before.Rules();
+		const auto& b = after.Rules();
+		size_t head = 0, tail = 0;
+		while (head < a.size() && head < b.size() && SameRule(a[head], b[head])) ++head;
+		while (tail < a.size() - head && tail < b.size() - head && SameRule(a[a.size() - 1 - tail], b[b.size() - 1 - tail])) ++tail;
+
+		// Every element a rule matches has the identifier the rule is indexed
+		// by, so those are enough to find them.
+		std::unordered_set<std::uint64_t> keys;
+		bool universal = false;
+		auto collect = [&](const std::vector<StyleRule>& rules, size_t end)
+		{
+			for (size_t i = head; i < end; ++i)
+			{
+				const auto& subject = rules[i].compounds.back();
+				if (!subject.id.empty()) keys.insert(SelectorHash('#', subject.id));
+				else if (!subject.classes.empty()) keys.insert(SelectorHash('.', subject.classes.front()));
+				else if (!subject.tag.empty()) keys.insert(SelectorHash('<', subject.tag));
+				else universal = true;
+			}
+		};
+		collect(a, a.size() - tail);
+		collect(b, b.size() - tail);
+		if (keys.empty() && !universal) return 0;
+
+		size_t invalidated = 0;
+		SelectorElement e;
+		std::vector<Tree*> stack(tree.child.rbegin(), tree.child.rend());
+		while (!stack.empty())
+		{
+			Tree* node = stack.back();
+			stack.pop_back();
+			stack.insert(stack.end(), node->child.rbegin(), node->child.rend());
+
+			ReadSelectorElement(e, node->value);
+			bool hit = universal || keys.count(SelectorHash('<', e.tag)) != 0 || (!e.id.empty() && keys.count(SelectorHash('#', e.id)) != 0);
+			for (size_t k = 0; !hit && k < e.classes.size(); ++k) hit = keys.count(SelectorHash('.', e.classes[k])) != 0;
+			if (!hit) continue;
+
+			invalidator.InvalidateElement(*node);
+			++invalidated;
+		}
+		return invalidated;
+	}
+
+	inline std::string_view ElementKey(const Element& e)
+	{
+		auto itr = e.attributes.find("id");
+		return itr != e.attributes.end() ? std::string_view(itr->second) : std::string_view();
+	}
+
+	inline size_t CountTree(const Tree& tree)
+	{
+		size_t n = 1;
+		for (const Tree* c : tree.child) n += CountTree(*c);
+		return n;
+	}
+
+	inline void PatchAttributes(Tree& live, const Element& fresh, StyleInvalidator& invalidator, TreePatchStats& stats)
+	{
+		if (live->attributes == fresh.attributes) return;
+
+		std::vector<std::string> removed;
+		for (const auto& a : live->attributes)
+			if (fresh.attributes.find(a.first) == fresh.attributes.end()) removed.push_back(a.first);
+		for (const auto& key : removed) invalidator.RemoveAttribute(live, key);
+		for (const auto& a : fresh.attributes) invalidator.SetAttribute(live, a.first, a.second);
+		++stats.attributesChanged;
+	}
+
+	// Same markup at this level, and as many children.
+	inline bool SameNode(const Tree& a, const Tree& b)
+	{
+		return a.child.size() == b.child.size() && a.value.head == b.value.head && a.value.attributes == b.value.attributes;
+	}
+
+	inline void PatchTreeChildren(Tree& live, Tree& fresh, StyleInvalidator& invalidator, size_t& biggest_id, TreePatchStats& stats)
+	{
+		// What a ChildLayout shows, like the slots of a VirtualList, is its own.
+		if (live->child_layout) return;
+
+		// Above this many cells the unkeyed middle is only paired up by tag.
+		const size_t MaxLcsCells = 4096;
+
+		std::vector<Tree*> old = std::move(live.child);
+		live.child.clear();
+		const size_t none = old.size();
+		std::vector<size_t> matchOf(fresh.child.size(), none);
+		std::vector<bool> used(old.size(), false);
+
+		// Children with an id pair up by it.
+		std::unordered_map<std::string_view, size_t> keyed;
+		for (size_t i = 0; i < old.size(); ++i)
+			if (auto key = ElementKey(old[i]->value); !key.empty()) keyed.emplace(key, i);
+		std::vector<size_t> a, b;
+		for (size_t j = 0; j < fresh.child.size(); ++j)
+		{
+			const Tree& f = *fresh.child[j];
+			auto key = ElementKey(f.value);
+			if (key.empty())
+			{
+				b.push_back(j);
+				continue;
+			}
+			auto itr = keyed.find(key);
+			if (itr != keyed.end() && !used[itr->second] && old[itr->second]->value.head == f.value.head)
+			{
+				matchOf[j] = itr->second;
+				used[itr->second] = true;
+			}
+		}
+		for (size_t i = 0; i < old.size(); ++i)
+			if (ElementKey(old[i]->value).empty()) a.push_back(i);
+
+		// The rest in order: the common head and tail, then the longest common
+		// subsequence of what is between.
+		size_t head = 0, tail = 0;
+		while (head < a.size() && head < b.size() && SameNode(*old[a[head]], *fresh.child[b[head]])) ++head;
+		while (tail < a.size() - head && tail < b.size() - head &&
+			SameNode(*old[a[a.size() - 1 - tail]], *fresh.child[b[b.size() - 1 - tail]])) ++tail;
+		for (size_t k = 0; k < head; ++k) matchOf[b[k]] = a[k];
+		for (size_t k = 1; k <= tail; ++k) matchOf[b[b.size() - k]] = a[a.size() - k];
+
+		const size_t n = a.size() - head - tail, m = b.size() - head - tail;
+		if (n > 0 && m > 0 && n * m <= MaxLcsCells)
+		{
+			std::vector<std::uint16_t> lcs((n + 1) * (m + 1), 0);
+			auto at = [&](size_t i, size_t j) -> std::uint16_t& { return lcs[i * (m + 1) + j]; };
+			for (size_t i = n; i-- > 0;)
+				for (size_t j = m; j-- > 0;)
+					at(i, j) = SameNode(*old[a[head + i]], *fresh.child[b[head + j]]) ? at(i + 1, j + 1) + 1 : std::max(at(i + 1, j), at(i, j + 1));
+			for (size_t i = 0, j = 0; i < n && j < m;)
+			{
+				if (SameNode(*old[a[head + i]], *fresh.child[b[head + j]])) matchOf[b[head + j++]] = a[head + i++];
+				else if (at(i + 1, j) >= at(i, j + 1)) ++i;
+				else ++j;
+			}
+		}
+		for (size_t j : b)
+			if (matchOf[j] != none) used[matchOf[j]] = true;
+
+		// Left over in the middle: changed nodes, paired in order by tag so
+		// their attributes are patched rather than the node replaced.
+		size_t cursor = head;
+		for (size_t k = head; k < b.size() - tail; ++k)
+		{
+			const size_t j = b[k];
+			if (matchOf[j] != none) continue;
+			for (size_t q = cursor; q < a.size() - tail; ++q)
+			{
+				if (used[a[q]] || old[a[q]]->value.head != fresh.child[j]->value.head) continue;
+				matchOf[j] = a[q];
+				used[a[q]] = true;
+				cursor = q + 1;
+				break;
+			}
+		}
+
+		bool structural = false;
+		size_t last = 0;
+		for (size_t j = 0; j < fresh.child.size(); ++j)
+		{
+			Tree*& f = fresh.child[j];
+			if (matchOf[j] != none)
+			{
+				Tree& node = *old[matchOf[j]];
+				structural |= matchOf[j] < last;
+				last = matchOf[j];
+				PatchAttributes(node, f->value, invalidator, stats);
+				PatchTreeChildren(node, *f, invalidator, biggest_id, stats);
+				live.child.push_back(&node);
+				++stats.kept;
+				continue;
+			}
+
+			// New, adopted from the fresh tree with ids of the live one.
+			Tree* node = f;
+			f = nullptr;
+			node->parent = &live;
+			std::vector<Tree*> stack = { node };
+			while (!stack.empty())
+			{
+				Tree* t = stack.back();
+				stack.pop_back();
+				t->value.eid = biggest_id++;
+				t->value.flags |= ElementFlag::LayoutDirty;
+				stack.insert(stack.end(), t->child.begin(), t->child.end());
+				++stats.added;
+			}
+			invalidator.InvalidateTree(*node);
+			live.child.push_back(node);
+			structural = true;
+		}
+
+		for (size_t i = 0; i < old.size(); ++i)
+		{
+			if (used[i]) continue;
+			stats.removed += CountTree(*old[i]);
+			delete old[i];
+			structural = true;
+		}
+		if (structural) live->flags |= ElementFlag::LayoutDirty;
+	}
+
+	// Makes live look like fresh, a new parse of the document, keeping every
+	// node the two have in common.  Children are matched by id where they have
+	// one; the others in order, identical ones first and then by tag.
+	// Nodes only in fresh are moved over with new ids from biggest_id; fresh
+	// is left with what was not taken.
+	inline void PatchTree(Tree& live, Tree& fresh, StyleInvalidator& invalidator, size_t& biggest_id, TreePatchStats* stats = nullptr)
+	{
+		// Pending invalidations may point at nodes about to be removed.
+		invalidator.Flush();
+
+		TreePatchStats s;
+		PatchTreeChildren(live, fresh, invalidator, biggest_id, s);
+		if (stats) *stats = s;
+	}
+
+	// Reparses a document and patches live with it.  The new parse is not
+	// styled: kept nodes keep their style, and new or changed ones are
+	// restyled by the invalidator.
+	inline void ReloadYTML1_1(const std::string& str, Tree& live, StyleInvalidator& invalidator, size_t& biggest_id, TreePatchStats* stats = nullptr)
+	{
+		const StyleSheet unstyled;
+		Tree fresh;
+		size_t id = 1;
+		ParseYTML1_1(str, fresh, unstyled, id);
+		PatchTree(live, fresh, invalidator, biggest_id, stats);
+	}
+
+	// Replaces the rules of sheet, which invalidator has to be using, and
+	// invalidates what the changed ones can match.  Returns the number of
+	// elements invalidated.
+	inline size_t ReloadCSS(const std::string& str, StyleSheet& sheet, Tree& tree, StyleInvalidator& invalidator)
+	{
+		StyleSheet fresh;
+		fresh.Parse(str);
+		const size_t invalidated = InvalidateChangedRules(tree, sheet, fresh, invalidator);
+		sheet = std::move(fresh);
+		return invalidated;
+	}
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "YTML1_1.hpp"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Attribute changes on a parsed YTML tree, with incremental restyle.  Every
+// mutation records the elements whose style it can change: the element
+// itself, its children or its whole subtree, depending on where the changed
+// id or class appears in the stylesheet's selectors.  Without sibling
+// combinators no mutation reaches a sibling.  Flush restyles only those
+// elements and sets ElementFlag::LayoutDirty on the ones whose layout
+// properties came out different.
+
+inline namespace YTML1_1
+{
+	struct RestyleStats {
+		size_t mutations = 0;
+		size_t restyled = 0;
+		size_t layoutDirty = 0;
+	};
+
+	class StyleInvalidator
+	{
+	public:
+		explicit StyleInvalidator(const StyleSheet& sheet) : mSheet(sheet) {}
+
+		void SetAttribute(Tree& node, const std::string& key, const std::string& value)
+		{
+			auto& attributes = node->attributes;
+			auto itr = attributes.find(key);
+			if (itr != attributes.end() && itr->second == value) return;
+
+			const std::string old = itr != attributes.end() ? itr->second : std::string();
+			attributes[key] = value;
+			Changed(node, key, old, value);
+		}
+
+		void RemoveAttribute(Tree& node, const std::string& key)
+		{
+			auto& attributes = node->attributes;
+			auto itr = attributes.find(key);
+			if (itr == attributes.end()) return;
+
+			const std::string old = std::move(itr->second);
+			attributes.erase(itr);
+			Changed(node, key, old, std::string());
+		}
+
+		void AddClass(Tree& node, std::string_view cls)
+		{
+			std::vector<std::string_view> classes;
+			if (auto itr = node->attributes.find("class"); itr != node->attributes.end())
+			{
+				SplitByBlank(classes, itr->second);
+				if (std::find(classes.begin(), classes.end(), cls) != classes.end()) return;
+			}
+
+			std::string value;
+			for (const auto& c : classes) value.append(c).append(" ");
+			value.append(cls);
+			SetAttribute(node, "class", value);
+		}
+
+		void RemoveClass(Tree& node, std::string_view cls)
+		{
+			auto itr = node->attributes.find("class");
+			if (itr == node->attributes.end()) return;
+
+			std::vector<std::string_view> classes;
+			SplitByBlank(classes, itr->second);
+			std::string value;
+			for (const auto& c : classes)
+			{
+				if (c == cls) continue;
+				if (!value.empty()) value.append(" ");
+				value.append(c);
+			}
+			SetAttribute(node, "class", value);
+		}
+
+		// The style attribute; it only ever restyles its own element.
+		void SetStyle(Tree& node, const std::string& style)
+		{
+			SetAttribute(node, "style", style);
+		}
+
+		// Restyles node, e.g. after a rule that matches it changed.
+		void InvalidateElement(Tree& node)
+		{
+			Invalidate(node, InvalidateSelf);
+		}
+
+		// Restyles node and everything under it.
+		void InvalidateTree(Tree& node)
+		{
+			Invalidate(node, InvalidateSubtree);
+		}
+
+		bool Pending()const { return !mOrder.empty(); }
+
+		// Restyles the elements invalidated since the last flush.
+		void Flush()
+		{
+			mStats = RestyleStats();
+			mStats.mutations = mMutations;
+			mMutations = 0;
+			if (mOrder.empty()) return;
+
+			StyleMatcher matcher(mSheet);
+			std::vector<Tree*> path;
+			for (Tree* node : mOrder)
+			{
+				const std::uint8_t scope = mPending[node];
+				if (Covered(*node, scope)) continue;
+
+				// The ancestors go into the matcher, root first; the root itself
+				// is not an element of the document.
+				path.clear();
+				for (Tree* p = node->parent; p != nullptr && p->parent != nullptr; p = p->parent) path.push_back(p);
+				for (auto itr = path.rbegin(); itr != path.rend(); ++itr)
+				{
+					ReadSelectorElement(matcher.Subject(), (*itr)->value);
+					matcher.Push();
+				}
+
+				if (scope & InvalidateSubtree)
+				{
+					RestyleSubtree(*node, matcher);
+				}
+				else
+				{
+					if (scope & InvalidateSelf) Restyle(*node, matcher);
+					if (scope & InvalidateChildren)
+					{
+						ReadSelectorElement(matcher.Subject(), node->value);
+						matcher.Push();
+						for (Tree* c : node->child) Restyle(*c, matcher);
+						matcher.Pop();
+					}
+				}
+				while (matcher.Depth() > 0) matcher.Pop();
+			}
+			mPending.clear();
+			mOrder.clear();
+		}
+
+		// Of the last flush.
+		const RestyleStats& Stats()const { return mStats; }
+
+	private:
+		// What layout reads of an element.
+		struct LayoutInputs {
+			ElementLengths lengths;
+			ElementDisplay display;
+			FlexStyle flex;
+			ElementHorizontalAlign halign;
+			ElementVerticalAlign valign;
+			ElementParentClipDirection pclip;
+			uint16_t ratio;
+
+			explicit LayoutInputs(const Element& e) :
+				lengths(e.lengths), display(e.display), flex(e.flex), halign(e.halign), valign(e.valign), pclip(e.pclip),
+				ratio(e.flags & (ElementFlag::RatioSizeWidth | ElementFlag::RatioSizeHeight | ElementFlag::RatioHorizontalAlign | ElementFlag::RatioVerticalAlign)) {}
+
+			bool operator==(const LayoutInputs& rhs)const
+			{
+				return lengths == rhs.lengths && display == rhs.display && flex == rhs.flex && halign == rhs.halign && valign == rhs.valign && pclip == rhs.pclip && ratio == rhs.ratio;
+			}
+		};
+
+		void Changed(Tree& node, const std::string& key, const std::string& oldValue, const std::string& newValue)
+		{
+			++mMutations;
+
+			// Other attributes are not seen by selectors; they only set
+			// properties of their own element.
+			std::uint8_t scope = InvalidateSelf;
+			if (key == "class")
+			{
+				std::vector<std::string_view> before, after;
+				SplitByBlank(before, oldValue);
+				SplitByBlank(after, newValue);
+				for (const auto& c : before)
+					if (std::find(after.begin(), after.end(), c) == after.end()) scope |= mSheet.Invalidation('.', c);
+				for (const auto& c : after)
+					if (std::find(before.begin(), before.end(), c) == before.end()) scope |= mSheet.Invalidation('.', c);
+			}
+			else if (key == "id")
+			{
+				std::vector<std::string_view> before, after;
+				SplitByBlank(before, oldValue);
+				SplitByBlank(after, newValue);
+				if (!before.empty()) scope |= mSheet.Invalidation('#', before.front());
+				if (!after.empty()) scope |= mSheet.Invalidation('#', after.front());
+			}
+			Invalidate(node, scope);
+		}
+
+		void Invalidate(Tree& node, std::uint8_t scope)
+		{
+			auto& pending = mPending[&node];
+			if (pending == 0) mOrder.push_back(&node);
+			pending |= scope;
+		}
+
+		// True if an invalidation further up already restyles all of scope.
+		bool Covered(const Tree& node, std::uint8_t scope)const
+		{
+			for (const Tree* p = node.parent; p != nullptr; p = p->parent)
+			{
+				auto itr = mPending.find(const_cast<Tree*>(p));
+				if (itr == mPending.end()) continue;
+				if (itr->second & InvalidateSubtree) return true;
+				if (p == node.parent && (itr->second & InvalidateChildren) && scope == InvalidateSelf) return true;
+			}
+			return false;
+		}
+
+		void Restyle(Tree& node, StyleMatcher& matcher)
+		{
+			Element& e = node.value;
+			if (node.parent == nullptr) return;
+
+			const LayoutInputs before(e);
+			e.ResetStyle();
+			e.ApplyAttributes();
+			ApplyStyle(e, matcher);
+			++mStats.restyled;
+			if (!(LayoutInputs(e) == before))
+			{
+				e.flags |= ElementFlag::LayoutDirty;
+				++mStats.layoutDirty;
+			}
+		}
+
+		void RestyleSubtree(Tree& node, StyleMatcher& matcher)
+		{
+			Restyle(node, matcher);
+			if (node.child.empty()) return;
+
+			const bool element = node.parent != nullptr;
+			if (element)
+			{
+				ReadSelectorElement(matcher.Subject(), node.value);
+				matcher.Push();
+			}
+			for (Tree* c : node.child) RestyleSubtree(*c, matcher);
+			if (element) matcher.Pop();
+		}
+
+		const StyleSheet& mSheet;
+		std::unordered_map<Tree*, std::uint8_t> mPending;
+		// mPending's keys in invalidation order.
+		std::vector<Tree*> mOrder;
+		size_t mMutations = 0;
+		RestyleStats mStats;
+	};
+}
@@ -0,0 +1,579 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// CSS selectors for YTML: type (or *), #id and .class compounds joined by
+// descendant (whitespace) and child (>) combinators.  Rules are indexed by
+// their rightmost compound and matched right to left; the ancestors of the
+// element being styled are kept in a counting Bloom filter, so most rules
+// whose ancestor part cannot match are rejected without walking up the tree.
+// A StyleCache remembers the rules matched under a chain of ancestors, so
+// elements that look alike in alike places are matched once.
+
+inline namespace YTML1_1
+{
+	enum class SelectorCombinator : std::uint8_t {
+		Descendant, Child
+	};
+
+	// Elements whose style may change when an id or class is added to or
+	// removed from an element.
+	enum SelectorInvalidation : std::uint8_t {
+		InvalidateSelf = 0b1,
+		InvalidateChildren = 0b10,
+		InvalidateSubtree = 0b100,
+	};
+
+	struct SelectorCompound {
+		std::string tag;	// empty for *
+		std::string id;
+		std::vector<std::string> classes;
+	};
+
+	// One property: value of a declaration block.  A property without a
+	// colon still shows up in the tuple, with no value.
+	struct StyleDeclaration {
+		std::string property;
+		std::string value;
+		bool hasValue = true;
+	};
+
+	// Splits a declaration block at ';' into trimmed properties and values.
+	// Line breaks are dropped and blank declarations skipped.
+	inline void ParseDeclarations(std::string_view s, std::vector<StyleDeclaration>& out)
+	{
+		out.clear();
+		auto text = [](std::string_view part, std::string& to)
+		{
+			to.clear();
+			for (const char c : part) if (c != '\n' && c != '\r') to.push_back(c);
+			const size_t first = to.find_first_not_of(' ');
+			if (first == std::string::npos)
+			{
+				to.clear();
+				return;
+			}
+			to.erase(to.find_last_not_of(' ') + 1);
+			to.erase(0, first);
+		};
+
+		size_t start = 0;
+		while (start < s.size())
+		{
+			size_t end = s.find(';', start);
+			if (end == std::string_view::npos) end = s.size();
+			const std::string_view part = s.substr(start, end - start);
+			start = end + 1;
+			if (part.find_first_not_of(" \r\n") == std::string_view::npos) continue;
+
+			StyleDeclaration& d = out.emplace_back();
+			const size_t colon = part.find(':');
+			d.hasValue = colon != std::string_view::npos;
+			text(part.substr(0, colon), d.property);
+			if (d.hasValue) text(part.substr(colon + 1), d.value);
+		}
+	}
+
+	struct StyleRule {
+		// Left to right; combinators[i] sits between compounds[i] and
+		// compounds[i + 1].
+		std::vector<SelectorCompound> compounds;
+		std::vector<SelectorCombinator> combinators;
+
+		// ids << 16 | classes << 8 | types, so rules sort by it directly.
+		std::uint32_t specificity = 0;
+		// Source order, the tie break between equal specificities.
+		std::uint32_t order = 0;
+
+		// Identifiers every matching element must have among its ancestors.
+		std::uint64_t ancestorHashes[4] = {};
+		std::uint32_t ancestorHashCount = 0;
+
+		std::string declarations;
+		// declarations, split once for every element the rule matches.
+		std::vector<StyleDeclaration> properties;
+	};
+
+	// What a selector sees of an element.  The views point into the element's
+	// head and attributes.
+	struct SelectorElement {
+		std::string_view tag;
+		std::string_view id;
+		std::vector<std::string_view> classes;
+	};
+
+	struct SelectorStats {
+		size_t elements = 0;
+		size_t candidates = 0;
+		size_t bloomRejects = 0;
+		size_t matches = 0;
+		// Elements whose rules came from a StyleCache; counted in elements
+		// but not in the rest.
+		size_t cacheHits = 0;
+	};
+
+	// FNV-1a, seeded with the kind of identifier ('<' tag, '#' id, '.' class)
+	// so a class and a tag of the same name hash apart.
+	inline std::uint64_t SelectorHash(char kind, std::string_view name)
+	{
+		std::uint64_t h = 14695981039346656037ull;
+		h = (h ^ (std::uint8_t)kind) * 1099511628211ull;
+		for (const char c : name) h = (h ^ (std::uint8_t)c) * 1099511628211ull;
+		return h;
+	}
+
+	inline bool SelectorNameChar(char c)
+	{
+		return c == '_' || c == '-' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	// Parses one selector of a comma separated list.  Returns false for
+	// anything beyond the supported subset (pseudo classes, attributes,
+	// sibling combinators), whose rules are then dropped as a browser would.
+	inline bool ParseSelector(std::string_view s, StyleRule& rule)
+	{
+		rule.compounds.clear();
+		rule.combinators.clear();
+
+		size_t i = 0;
+		bool pendingChild = false, pendingSpace = false, open = false;
+		while (i < s.size())
+		{
+			const char c = s[i];
+			if (c == ' ')
+			{
+				pendingSpace = open;
+				++i;
+				continue;
+			}
+			if (c == '>')
+			{
+				if (rule.compounds.empty() || pendingChild) return false;
+				pendingChild = true;
+				open = false;
+				++i;
+				continue;
+			}
+
+			if (!open)
+			{
+				if (!rule.compounds.empty())
+					rule.combinators.push_back(pendingChild ? SelectorCombinator::Child : SelectorCombinator::Descendant);
+				else if (pendingChild)
+					return false;
+				rule.compounds.emplace_back();
+				pendingChild = false;
+				open = true;
+			}
+			else if (pendingSpace)
+			{
+				rule.combinators.push_back(SelectorCombinator::Descendant);
+				rule.compounds.emplace_back();
+			}
+			pendingSpace = false;
+
+			SelectorCompound& compound = rule.compounds.back();
+			if (c == '*')
+			{
+				++i;
+				continue;
+			}
+
+			const char kind = c == '.' || c == '#' ? c : 0;
+			const size_t start = kind ? i + 1 : i;
+			size_t end = start;
+			while (end < s.size() && SelectorNameChar(s[end])) ++end;
+			if (end == start) return false;
+
+			std::string name(s.substr(start, end - start));
+			if (kind == '.') compound.classes.push_back(std::move(name));
+			else if (kind == '#') compound.id = std::move(name);
+			else if (compound.tag.empty()) compound.tag = std::move(name);
+			else return false;
+			i = end;
+		}
+		if (rule.compounds.empty() || pendingChild) return false;
+
+		std::uint32_t ids = 0, classes = 0, types = 0;
+		for (const auto& compound : rule.compounds)
+		{
+			ids += compound.id.empty() ? 0 : 1;
+			classes += (std::uint32_t)compound.classes.size();
+			types += compound.tag.empty() ? 0 : 1;
+		}
+		rule.specificity = std::min(ids, 255u) << 16 | std::min(classes, 255u) << 8 | std::min(types, 255u);
+
+		// The most selective identifiers of the ancestor compounds first.
+		rule.ancestorHashCount = 0;
+		auto addHash = [&](char kind, const std::string& name)
+		{
+			if (!name.empty() && rule.ancestorHashCount < 4) rule.ancestorHashes[rule.ancestorHashCount++] = SelectorHash(kind, name);
+		};
+		for (size_t k = rule.compounds.size() - 1; k-- > 0;)
+		{
+			const auto& compound = rule.compounds[k];
+			addHash('#', compound.id);
+			for (const auto& cls : compound.classes) addHash('.', cls);
+			addHash('<', compound.tag);
+		}
+		return true;
+	}
+
+	class StyleSheet
+	{
+	public:
+		// Appends the rules of a stylesheet; later rules win ties.
+		void Parse(const std::string& str)
+		{
+			// Line breaks and tabs are blanks, as in the declarations.
+			std::string obj(str);
+			for (auto& c : obj) if (c == '\r' || c == '\n' || c == '\t') c = ' ';
+
+			size_t start = 0;
+			for (size_t i = 0; i < obj.size(); ++i)
+			{
+				if (obj[i] != '}') continue;
+
+				const std::string_view block(obj.data() + start, i - start);
+				start = i + 1;
+				const size_t brace = block.find('{');
+				if (brace == std::string_view::npos) continue;
+
+				const std::string_view meta = block.substr(0, brace);
+				const std::string_view data = block.substr(brace + 1);
+				size_t first = 0;
+				while (first <= meta.size())
+				{
+					size_t last = meta.find(',', first);
+					if (last == std::string_view::npos) last = meta.size();
+					AddRule(meta.substr(first, last - first), data);
+					first = last + 1;
+				}
+			}
+		}
+
+		void Clear()
+		{
+			mRules.clear();
+			mById.clear();
+			mByClass.clear();
+			mByType.clear();
+			mUniversal.clear();
+			mInvalidation.clear();
+			mMentioned.clear();
+			mOrder = 0;
+		}
+
+		const std::vector<StyleRule>& Rules()const { return mRules; }
+
+		// SelectorInvalidation bits for the identifier; 0 when no rule
+		// mentions it.
+		std::uint8_t Invalidation(char kind, std::string_view name)const
+		{
+			auto itr = mInvalidation.find(SelectorHash(kind, name));
+			return itr != mInvalidation.end() ? itr->second : 0;
+		}
+
+		// Whether a selector has the identifier; an element matches the same
+		// rules whatever identifiers it has that none has.
+		bool Mentions(char kind, std::string_view name)const
+		{
+			return mMentioned.count(SelectorHash(kind, name)) != 0;
+		}
+
+	private:
+		friend class StyleMatcher;
+
+		void AddRule(std::string_view selector, std::string_view declarations)
+		{
+			StyleRule rule;
+			if (!ParseSelector(selector, rule)) return;
+			rule.order = mOrder++;
+			rule.declarations = declarations;
+			ParseDeclarations(declarations, rule.properties);
+
+			// Indexed under one identifier of the subject compound, the one
+			// the fewest elements are expected to have.
+			const auto index = (std::uint32_t)mRules.size();
+			const auto& subject = rule.compounds.back();
+			if (!subject.id.empty()) mById[SelectorHash('#', subject.id)].push_back(index);
+			else if (!subject.classes.empty()) mByClass[SelectorHash('.', subject.classes.front())].push_back(index);
+			else if (!subject.tag.empty()) mByType[SelectorHash('<', subject.tag)].push_back(index);
+			else mUniversal.push_back(index);
+
+			// An identifier in the subject restyles its element; one left of
+			// a combinator restyles what the combinator reaches, the children
+			// when a child combinator leads straight to the subject and the
+			// whole subtree otherwise.
+			const size_t last = rule.compounds.size() - 1;
+			for (size_t k = 0; k <= last; ++k)
+			{
+				const std::uint8_t scope = k == last ? InvalidateSelf :
+					k + 1 == last && rule.combinators[k] == SelectorCombinator::Child ? InvalidateChildren : InvalidateSubtree;
+				const auto& compound = rule.compounds[k];
+				if (!compound.id.empty()) mInvalidation[SelectorHash('#', compound.id)] |= scope;
+				for (const auto& cls : compound.classes) mInvalidation[SelectorHash('.', cls)] |= scope;
+
+				if (!compound.tag.empty()) mMentioned.insert(SelectorHash('<', compound.tag));
+				if (!compound.id.empty()) mMentioned.insert(SelectorHash('#', compound.id));
+				for (const auto& cls : compound.classes) mMentioned.insert(SelectorHash('.', cls));
+			}
+			mRules.push_back(std::move(rule));
+		}
+
+		std::vector<StyleRule> mRules;
+		// Keyed by SelectorHash; a collision only adds candidates.
+		std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> mById, mByClass, mByType;
+		std::vector<std::uint32_t> mUniversal;
+		std::unordered_map<std::uint64_t, std::uint8_t> mInvalidation;
+		// Every identifier of every selector, by SelectorHash.
+		std::unordered_set<std::uint64_t> mMentioned;
+		std::uint32_t mOrder = 0;
+	};
+
+	// Matches the rules of a stylesheet during one walk down a tree.  The
+	// caller fills Subject() for every element, calls Match, and brackets the
+	// children of an element with Push and Pop.
+	class StyleMatcher
+	{
+	public:
+		static const size_t BloomSize = 4096;
+
+		explicit StyleMatcher(const StyleSheet& sheet) : mSheet(sheet), mBloom(BloomSize, 0) {}
+
+		// The element to match next, at the current depth.  Its storage is
+		// reused between elements.
+		SelectorElement& Subject()
+		{
+			if (mDepth == mPath.size()) mPath.emplace_back();
+			return mPath[mDepth];
+		}
+
+		// Rules matching Subject(), in the order to apply them: by
+		// specificity, then source order.
+		const std::vector<const StyleRule*>& Match()
+		{
+			++mStats.elements;
+			mMatched.clear();
+			mCandidates.clear();
+
+			const SelectorElement& e = Subject();
+			auto collect = [&](const std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>& index, char kind, std::string_view name)
+			{
+				if (auto itr = index.find(SelectorHash(kind, name)); itr != index.end())
+					mCandidates.insert(mCandidates.end(), itr->second.begin(), itr->second.end());
+			};
+			if (!e.id.empty()) collect(mSheet.mById, '#', e.id);
+			for (const auto& cls : e.classes) collect(mSheet.mByClass, '.', cls);
+			if (!e.tag.empty()) collect(mSheet.mByType, '<', e.tag);
+			mCandidates.insert(mCandidates.end(), mSheet.mUniversal.begin(), mSheet.mUniversal.end());
+
+			// A class listed twice on the element yields a rule twice.
+			std::sort(mCandidates.begin(), mCandidates.end());
+			mCandidates.erase(std::unique(mCandidates.begin(), mCandidates.end()), mCandidates.end());
+			mStats.candidates += mCandidates.size();
+
+			for (const auto index : mCandidates)
+			{
+				const StyleRule& rule = mSheet.mRules[index];
+				if (!MayHaveAncestors(rule))
+				{
+					++mStats.bloomRejects;
+					continue;
+				}
+				if (CompoundMatches(rule.compounds.back(), e) && AncestorsMatch(rule, rule.compounds.size() - 1, mDepth))
+					mMatched.push_back(&rule);
+			}
+			mStats.matches += mMatched.size();
+
+			std::sort(mMatched.begin(), mMatched.end(), [](const StyleRule* a, const StyleRule* b)
+				{
+					return a->specificity != b->specificity ? a->specificity < b->specificity : a->order < b->order;
+				});
+			return mMatched;
+		}
+
+		// Makes Subject() the parent of the elements that follow.
+		void Push()
+		{
+			Subject();
+			UpdateBloom(mPath[mDepth], 1);
+			++mDepth;
+		}
+
+		void Pop()
+		{
+			if (mDepth == 0) return;
+			--mDepth;
+			UpdateBloom(mPath[mDepth], -1);
+		}
+
+		size_t Depth()const { return mDepth; }
+
+		const StyleSheet& Sheet()const { return mSheet; }
+
+		const SelectorStats& Stats()const { return mStats; }
+
+	private:
+		static size_t BloomIndex(std::uint64_t h, int k)
+		{
+			return (size_t)(k == 0 ? h : h >> 32) & (BloomSize - 1);
+		}
+
+		void UpdateBloom(const SelectorElement& e, int delta)
+		{
+			auto update = [&](char kind, std::string_view name)
+			{
+				if (name.empty()) return;
+				const std::uint64_t h = SelectorHash(kind, name);
+				for (int k = 0; k < 2; ++k)
+				{
+					// Saturated counters stay put; they only cost precision.
+					auto& counter = mBloom[BloomIndex(h, k)];
+					if (counter != 0xffff) counter = (std::uint16_t)(counter + delta);
+				}
+			};
+			update('<', e.tag);
+			update('#', e.id);
+			for (const auto& cls : e.classes) update('.', cls);
+		}
+
+		bool MayHaveAncestors(const StyleRule& rule)const
+		{
+			for (std::uint32_t k = 0; k < rule.ancestorHashCount; ++k)
+			{
+				const std::uint64_t h = rule.ancestorHashes[k];
+				if (mBloom[BloomIndex(h, 0)] == 0 || mBloom[BloomIndex(h, 1)] == 0) return false;
+			}
+			return true;
+		}
+
+		static bool CompoundMatches(const SelectorCompound& c, const SelectorElement& e)
+		{
+			if (!c.tag.empty() && c.tag != e.tag) return false;
+			if (!c.id.empty() && c.id != e.id) return false;
+			for (const auto& cls : c.classes)
+				if (std::find(e.classes.begin(), e.classes.end(), cls) == e.classes.end()) return false;
+			return true;
+		}
+
+		// compounds[c] matched mPath[depth]; matches the ones left of it
+		// against the ancestors, backtracking over descendant combinators.
+		bool AncestorsMatch(const StyleRule& rule, size_t c, size_t depth)const
+		{
+			if (c == 0) return true;
+			const SelectorCompound& left = rule.compounds[c - 1];
+			if (rule.combinators[c - 1] == SelectorCombinator::Child)
+				return depth > 0 && CompoundMatches(left, mPath[depth - 1]) && AncestorsMatch(rule, c - 1, depth - 1);
+
+			for (size_t d = depth; d-- > 0;)
+				if (CompoundMatches(left, mPath[d]) && AncestorsMatch(rule, c - 1, d)) return true;
+			return false;
+		}
+
+		const StyleSheet& mSheet;
+		std::vector<SelectorElement> mPath;
+		size_t mDepth = 0;
+		std::vector<std::uint16_t> mBloom;
+		std::vector<std::uint32_t> mCandidates;
+		std::vector<const StyleRule*> mMatched;
+		SelectorStats mStats;
+	};
+
+	// The rules an element matches, which depend only on its compound and on
+	// the compounds of its ancestors: one context for every chain of them.
+	struct StyleContext {
+		const StyleContext* parent = nullptr;
+		// The tag, id and classes a selector mentions, each marked as in
+		// SelectorHash and ended by '\0'.
+		std::string compound;
+		std::vector<const StyleRule*> rules;
+	};
+
+	// StyleContexts shared by the walks styling a tree, on any number of
+	// threads.  The contexts are split over shards by hash, each behind its
+	// own lock, and no lock is held while matching; of two threads matching
+	// the same context, the one to insert second uses the first's.  Contexts
+	// point at the rules of the sheet and live as long as the cache.
+	class StyleCache
+	{
+	public:
+		static const size_t ShardCount = 64;
+
+		// The context of matcher's Subject() below parent, matched on a miss.
+		// key is scratch storage.
+		const StyleContext& Match(const StyleContext* parent, StyleMatcher& matcher, std::string& key, bool& hit)
+		{
+			const SelectorElement& e = matcher.Subject();
+			const StyleSheet& sheet = matcher.Sheet();
+			key.clear();
+			auto add = [&](char kind, std::string_view name)
+			{
+				if (name.empty() || !sheet.Mentions(kind, name)) return;
+				key.push_back(kind);
+				key.append(name).push_back('\0');
+			};
+			add('<', e.tag);
+			add('#', e.id);
+			for (const auto& cls : e.classes) add('.', cls);
+
+			std::uint64_t h = (14695981039346656037ull ^ (std::uint64_t)(std::uintptr_t)parent) * 1099511628211ull;
+			for (const char c : key) h = (h ^ (std::uint8_t)c) * 1099511628211ull;
+			Shard& shard = mShards[(h >> 32) & (ShardCount - 1)];
+
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				if (const StyleContext* found = Find(shard, h, parent, key))
+				{
+					hit = true;
+					return *found;
+				}
+			}
+
+			hit = false;
+			StyleContext context;
+			context.parent = parent;
+			context.compound = key;
+			context.rules = matcher.Match();
+
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			if (const StyleContext* found = Find(shard, h, parent, key)) return *found;
+			// Nodes of an unordered container stay where they are.
+			return shard.contexts.emplace(h, std::move(context))->second;
+		}
+
+		void Clear()
+		{
+			for (Shard& shard : mShards)
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				shard.contexts.clear();
+			}
+		}
+
+	private:
+		static_assert((ShardCount & (ShardCount - 1)) == 0, "shards are picked by masking a hash");
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::unordered_multimap<std::uint64_t, StyleContext> contexts;
+		};
+
+		static const StyleContext* Find(const Shard& shard, std::uint64_t h, const StyleContext* parent, const std::string& key)
+		{
+			auto range = shard.contexts.equal_range(h);
+			for (auto itr = range.first; itr != range.second; ++itr)
+				if (itr->second.parent == parent && itr->second.compound == key) return &itr->second;
+			return nullptr;
+		}
+
+		Shard mShards[ShardCount];
+	};
+}
@@ -0,0 +1,493 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+// Parsers for CSS property values: lengths, colors and box shorthands.  They
+// work on views into the declaration, never allocate, and leave their output
+// untouched when the value does not parse, so an invalid declaration is
+// ignored like in CSS.
+
+inline namespace YTML1_1
+{
+	enum class LengthUnit : std::uint8_t {
+		None, Px, Percent, Em, Rem, Vw, Vh,
+		// auto; resolves to 0 where nothing else gives it a size.
+		Auto
+	};
+
+	struct Length {
+		float value = 0.f;
+		LengthUnit unit = LengthUnit::None;
+	};
+
+	// The four sides of margin or border, in the order of the CSS shorthand.
+	struct BoxLengths {
+		Length top, right, bottom, left;
+	};
+
+	inline bool AutoLength(const Length& l)
+	{
+		return l.unit == LengthUnit::Auto;
+	}
+
+	inline bool operator==(const Length& a, const Length& b)
+	{
+		return a.value == b.value && a.unit == b.unit;
+	}
+	inline bool operator!=(const Length& a, const Length& b) { return !(a == b); }
+
+	inline bool operator==(const BoxLengths& a, const BoxLengths& b)
+	{
+		return a.top == b.top && a.right == b.right && a.bottom == b.bottom && a.left == b.left;
+	}
+	inline bool operator!=(const BoxLengths& a, const BoxLengths& b) { return !(a == b); }
+
+	inline bool ValueSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	inline std::string_view TrimValue(std::string_view s)
+	{
+		while (!s.empty() && ValueSpace(s.front())) s.remove_prefix(1);
+		while (!s.empty() && ValueSpace(s.back())) s.remove_suffix(1);
+		return s;
+	}
+
+	// The next blank separated token of s, which is advanced past it.
+	inline std::string_view NextValueToken(std::string_view& s)
+	{
+		while (!s.empty() && ValueSpace(s.front())) s.remove_prefix(1);
+		size_t n = 0;
+		while (n < s.size() && !ValueSpace(s[n])) ++n;
+		std::string_view token = s.substr(0, n);
+		s.remove_prefix(n);
+		return token;
+	}
+
+	// ASCII case insensitive; b is lower case.
+	inline bool SameValueName(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			const char c = a[i] >= 'A' && a[i] <= 'Z' ? (char)(a[i] + ('a' - 'A')) : a[i];
+			if (c != b[i]) return false;
+		}
+		return true;
+	}
+
+	// A CSS number at the start of s, which is advanced past it.  Unlike
+	// from_chars alone this takes a leading '+' and refuses inf and nan.
+	inline bool ParseNumber(std::string_view& s, float& out)
+	{
+		size_t sign = 0;
+		if (!s.empty() && (s[0] == '+' || s[0] == '-')) sign = 1;
+		if (s.size() <= sign || !((s[sign] >= '0' && s[sign] <= '9') || s[sign] == '.')) return false;
+
+		const char* first = s.data() + (s[0] == '+' ? 1 : 0);
+		float v = 0.f;
+		auto [end, ec] = std::from_chars(first, s.data() + s.size(), v);
+		if (ec != std::errc()) return false;
+		out = v;
+		s.remove_prefix(end - s.data());
+		return true;
+	}
+
+	inline bool ParseLengthUnit(std::string_view s, LengthUnit& unit)
+	{
+		if (s.empty())
+		{
+			unit = LengthUnit::None;
+			return true;
+		}
+		LengthUnit u;
+		switch (s[0] | 0x20)
+		{
+		case '%': u = LengthUnit::Percent; break;
+		case 'p': u = LengthUnit::Px; break;
+		case 'e': u = LengthUnit::Em; break;
+		case 'r': u = LengthUnit::Rem; break;
+		case 'v': u = s.size() == 2 && (s[1] | 0x20) == 'h' ? LengthUnit::Vh : LengthUnit::Vw; break;
+		default: return false;
+		}
+		static constexpr std::string_view names[] = { "", "px", "%", "em", "rem", "vw", "vh" };
+		if (!SameValueName(s, names[(int)u])) return false;
+		unit = u;
+		return true;
+	}
+
+	// A number with an optional unit, "12px", "50%", "1.5em", or auto; a bare
+	// number is left as LengthUnit::None.
+	inline bool ParseLength(std::string_view s, Length& out)
+	{
+		s = TrimValue(s);
+		if (SameValueName(s, "auto"))
+		{
+			out = { 0.f, LengthUnit::Auto };
+			return true;
+		}
+		Length l;
+		if (!ParseNumber(s, l.value) || !ParseLengthUnit(s, l.unit)) return false;
+		out = l;
+		return true;
+	}
+
+	// A number and nothing else.
+	inline bool ParseNumberValue(std::string_view s, float& out)
+	{
+		s = TrimValue(s);
+		float v = 0.f;
+		if (!ParseNumber(s, v) || !s.empty()) return false;
+		out = v;
+		return true;
+	}
+
+	template <typename T>
+	struct ValueKeyword {
+		std::string_view name;
+		T value;
+	};
+
+	// One of keywords, whose names are lower case.
+	template <typename T, size_t N>
+	inline bool ParseKeyword(std::string_view s, const ValueKeyword<T>(&keywords)[N], T& out)
+	{
+		s = TrimValue(s);
+		for (const auto& k : keywords)
+		{
+			if (!SameValueName(s, k.name)) continue;
+			out = k.value;
+			return true;
+		}
+		return false;
+	}
+
+	// One to four lengths: all sides; vertical and horizontal; top,
+	// horizontal and bottom; or top, right, bottom and left.
+	inline bool ParseBox(std::string_view s, BoxLengths& out)
+	{
+		Length v[4];
+		int n = 0;
+		for (std::string_view token = NextValueToken(s); !token.empty(); token = NextValueToken(s))
+			if (n == 4 || !ParseLength(token, v[n++])) return false;
+		switch (n)
+		{
+		case 1: out = { v[0], v[0], v[0], v[0] }; return true;
+		case 2: out = { v[0], v[1], v[0], v[1] }; return true;
+		case 3: out = { v[0], v[1], v[2], v[1] }; return true;
+		case 4: out = { v[0], v[1], v[2], v[3] }; return true;
+		}
+		return false;
+	}
+
+	inline DirectX::XMFLOAT4 UnpackColor(std::uint32_t rgba)
+	{
+		return DirectX::XMFLOAT4(
+			((rgba >> 24) & 0xff) / 255.f,
+			((rgba >> 16) & 0xff) / 255.f,
+			((rgba >> 8) & 0xff) / 255.f,
+			(rgba & 0xff) / 255.f);
+	}
+
+	struct NamedColor {
+		std::string_view name;
+		std::uint32_t rgba;
+	};
+
+	// The CSS named colors and transparent, found through a perfect hash
+	// made offline: the bucket of a name picks the seed that sends it to its
+	// own slot.  One hash, one table read and one compare per lookup.
+	struct NamedColorTable {
+		static constexpr size_t Buckets = 64;
+		static constexpr size_t Slots = 256;
+		static constexpr std::uint8_t Empty = 0xff;
+
+		static constexpr std::uint8_t Seed[Buckets] = {
+			5, 2, 7, 2, 0, 2, 2, 1, 5, 5, 0, 2, 0, 3, 1, 5,
+			3, 4, 3, 3, 0, 1, 2, 1, 3, 1, 1, 2, 4, 1, 2, 4,
+			8, 1, 1, 2, 1, 3, 1, 1, 2, 2, 0, 4, 0, 5, 5, 1,
+			11, 2, 4, 15, 5, 1, 1, 2, 2, 8, 5, 2, 7, 0, 3, 1,
+		};
+
+		// Index into Colors, or Empty.
+		static constexpr std::uint8_t Slot[Slots] = {
+			85, 255, 67, 255, 255, 123, 128, 7, 147, 47, 255, 100, 91, 129, 255, 39,
+			255, 112, 103, 255, 255, 255, 255, 23, 255, 255, 32, 97, 10, 41, 255, 60,
+			30, 102, 116, 255, 255, 54, 104, 255, 255, 89, 255, 255, 55, 27, 111, 66,
+			76, 255, 9, 109, 255, 255, 63, 255, 255, 255, 37, 255, 255, 255, 98, 255,
+			24, 130, 255, 15, 26, 255, 93, 70, 255, 119, 255, 80, 84, 255, 44, 255,
+			22, 51, 255, 106, 255, 137, 19, 255, 38, 43, 92, 120, 255, 255, 255, 2,
+			52, 88, 255, 255, 81, 8, 255, 134, 255, 18, 95, 255, 50, 255, 255, 255,
+			118, 45, 20, 255, 124, 255, 108, 94, 42, 1, 73, 36, 255, 72, 255, 255,
+			13, 83, 34, 90, 117, 99, 255, 64, 255, 56, 0, 255, 46, 255, 255, 5,
+			255, 255, 29, 58, 62, 82, 255, 255, 255, 87, 255, 255, 255, 65, 255, 78,
+			3, 255, 71, 255, 113, 255, 110, 255, 12, 68, 138, 255, 255, 4, 61, 105,
+			255, 255, 135, 146, 31, 57, 69, 126, 6, 255, 255, 122, 74, 14, 255, 144,
+			255, 143, 16, 141, 133, 48, 255, 255, 49, 255, 101, 255, 255, 125, 21, 145,
+			139, 255, 59, 107, 77, 255, 255, 75, 255, 121, 127, 255, 115, 79, 255, 86,
+			255, 148, 255, 53, 255, 35, 255, 255, 255, 96, 255, 255, 255, 33, 255, 132,
+			255, 142, 28, 255, 114, 25, 255, 140, 136, 255, 17, 40, 11, 255, 131, 255,
+		};
+
+		static constexpr NamedColor Colors[] = {
+			{ "aliceblue", 0xf0f8ffff },
+			{ "antiquewhite", 0xfaebd7ff },
+			{ "aqua", 0x00ffffff },
+			{ "aquamarine", 0x7fffd4ff },
+			{ "azure", 0xf0ffffff },
+			{ "beige", 0xf5f5dcff },
+			{ "bisque", 0xffe4c4ff },
+			{ "black", 0x000000ff },
+			{ "blanchedalmond", 0xffebcdff },
+			{ "blue", 0x0000ffff },
+			{ "blueviolet", 0x8a2be2ff },
+			{ "brown", 0xa52a2aff },
+			{ "burlywood", 0xdeb887ff },
+			{ "cadetblue", 0x5f9ea0ff },
+			{ "chartreuse", 0x7fff00ff },
+			{ "chocolate", 0xd2691eff },
+			{ "coral", 0xff7f50ff },
+			{ "cornflowerblue", 0x6495edff },
+			{ "cornsilk", 0xfff8dcff },
+			{ "crimson", 0xdc143cff },
+			{ "cyan", 0x00ffffff },
+			{ "darkblue", 0x00008bff },
+			{ "darkcyan", 0x008b8bff },
+			{ "darkgoldenrod", 0xb8860bff },
+			{ "darkgray", 0xa9a9a9ff },
+			{ "darkgreen", 0x006400ff },
+			{ "darkgrey", 0xa9a9a9ff },
+			{ "darkkhaki", 0xbdb76bff },
+			{ "darkmagenta", 0x8b008bff },
+			{ "darkolivegreen", 0x556b2fff },
+			{ "darkorange", 0xff8c00ff },
+			{ "darkorchid", 0x9932ccff },
+			{ "darkred", 0x8b0000ff },
+			{ "darksalmon", 0xe9967aff },
+			{ "darkseagreen", 0x8fbc8fff },
+			{ "darkslateblue", 0x483d8bff },
+			{ "darkslategray", 0x2f4f4fff },
+			{ "darkslategrey", 0x2f4f4fff },
+			{ "darkturquoise", 0x00ced1ff },
+			{ "darkviolet", 0x9400d3ff },
+			{ "deeppink", 0xff1493ff },
+			{ "deepskyblue", 0x00bfffff },
+			{ "dimgray", 0x696969ff },
+			{ "dimgrey", 0x696969ff },
+			{ "dodgerblue", 0x1e90ffff },
+			{ "firebrick", 0xb22222ff },
+			{ "floralwhite", 0xfffaf0ff },
+			{ "forestgreen", 0x228b22ff },
+			{ "fuchsia", 0xff00ffff },
+			{ "gainsboro", 0xdcdcdcff },
+			{ "ghostwhite", 0xf8f8ffff },
+			{ "gold", 0xffd700ff },
+			{ "goldenrod", 0xdaa520ff },
+			{ "gray", 0x808080ff },
+			{ "green", 0x008000ff },
+			{ "greenyellow", 0xadff2fff },
+			{ "grey", 0x808080ff },
+			{ "honeydew", 0xf0fff0ff },
+			{ "hotpink", 0xff69b4ff },
+			{ "indianred", 0xcd5c5cff },
+			{ "indigo", 0x4b0082ff },
+			{ "ivory", 0xfffff0ff },
+			{ "khaki", 0xf0e68cff },
+			{ "lavender", 0xe6e6faff },
+			{ "lavenderblush", 0xfff0f5ff },
+			{ "lawngreen", 0x7cfc00ff },
+			{ "lemonchiffon", 0xfffacdff },
+			{ "lightblue", 0xadd8e6ff },
+			{ "lightcoral", 0xf08080ff },
+			{ "lightcyan", 0xe0ffffff },
+			{ "lightgoldenrodyellow", 0xfafad2ff },
+			{ "lightgray", 0xd3d3d3ff },
+			{ "lightgreen", 0x90ee90ff },
+			{ "lightgrey", 0xd3d3d3ff },
+			{ "lightpink", 0xffb6c1ff },
+			{ "lightsalmon", 0xffa07aff },
+			{ "lightseagreen", 0x20b2aaff },
+			{ "lightskyblue", 0x87cefaff },
+			{ "lightslategray", 0x778899ff },
+			{ "lightslategrey", 0x778899ff },
+			{ "lightsteelblue", 0xb0c4deff },
+			{ "lightyellow", 0xffffe0ff },
+			{ "lime", 0x00ff00ff },
+			{ "limegreen", 0x32cd32ff },
+			{ "linen", 0xfaf0e6ff },
+			{ "magenta", 0xff00ffff },
+			{ "maroon", 0x800000ff },
+			{ "mediumaquamarine", 0x66cdaaff },
+			{ "mediumblue", 0x0000cdff },
+			{ "mediumorchid", 0xba55d3ff },
+			{ "mediumpurple", 0x9370dbff },
+			{ "mediumseagreen", 0x3cb371ff },
+			{ "mediumslateblue", 0x7b68eeff },
+			{ "mediumspringgreen", 0x00fa9aff },
+			{ "mediumturquoise", 0x48d1ccff },
+			{ "mediumvioletred", 0xc71585ff },
+			{ "midnightblue", 0x191970ff },
+			{ "mintcream", 0xf5fffaff },
+			{ "mistyrose", 0xffe4e1ff },
+			{ "moccasin", 0xffe4b5ff },
+			{ "navajowhite", 0xffdeadff },
+			{ "navy", 0x000080ff },
+			{ "oldlace", 0xfdf5e6ff },
+			{ "olive", 0x808000ff },
+			{ "olivedrab", 0x6b8e23ff },
+			{ "orange", 0xffa500ff },
+			{ "orangered", 0xff4500ff },
+			{ "orchid", 0xda70d6ff },
+			{ "palegoldenrod", 0xeee8aaff },
+			{ "palegreen", 0x98fb98ff },
+			{ "paleturquoise", 0xafeeeeff },
+			{ "palevioletred", 0xdb7093ff },
+			{ "papayawhip", 0xffefd5ff },
+			{ "peachpuff", 0xffdab9ff },
+			{ "peru", 0xcd853fff },
+			{ "pink", 0xffc0cbff },
+			{ "plum", 0xdda0ddff },
+			{ "powderblue", 0xb0e0e6ff },
+			{ "purple", 0x800080ff },
+			{ "rebeccapurple", 0x663399ff },
+			{ "red", 0xff0000ff },
+			{ "rosybrown", 0xbc8f8fff },
+			{ "royalblue", 0x4169e1ff },
+			{ "saddlebrown", 0x8b4513ff },
+			{ "salmon", 0xfa8072ff },
+			{ "sandybrown", 0xf4a460ff },
+			{ "seagreen", 0x2e8b57ff },
+			{ "seashell", 0xfff5eeff },
+			{ "sienna", 0xa0522dff },
+			{ "silver", 0xc0c0c0ff },
+			{ "skyblue", 0x87ceebff },
+			{ "slateblue", 0x6a5acdff },
+			{ "slategray", 0x708090ff },
+			{ "slategrey", 0x708090ff },
+			{ "snow", 0xfffafaff },
+			{ "springgreen", 0x00ff7fff },
+			{ "steelblue", 0x4682b4ff },
+			{ "tan", 0xd2b48cff },
+			{ "teal", 0x008080ff },
+			{ "thistle", 0xd8bfd8ff },
+			{ "tomato", 0xff6347ff },
+			{ "transparent", 0x00000000 },
+			{ "turquoise", 0x40e0d0ff },
+			{ "violet", 0xee82eeff },
+			{ "wheat", 0xf5deb3ff },
+			{ "white", 0xffffffff },
+			{ "whitesmoke", 0xf5f5f5ff },
+			{ "yellow", 0xffff00ff },
+			{ "yellowgreen", 0x9acd32ff },
+		};
+
+		// FNV-1a of the lower-cased name, seeded, with the high bits folded in.
+		static constexpr std::uint32_t Hash(std::string_view name, std::uint32_t seed)
+		{
+			std::uint32_t h = 2166136261u ^ seed * 0x9E3779B9u;
+			for (const char c : name) h = (h ^ (std::uint8_t)(c | 0x20)) * 16777619u;
+			return h ^ h >> 15;
+		}
+
+		static const NamedColor* Find(std::string_view name)
+		{
+			const std::uint8_t seed = Seed[Hash(name, 0) & (Buckets - 1)];
+			const std::uint8_t i = Slot[Hash(name, seed) & (Slots - 1)];
+			if (i == Empty || !SameValueName(name, Colors[i].name)) return nullptr;
+			return &Colors[i];
+		}
+	};
+
+	inline int HexDigit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	// The digits after '#': rgb, rgba, rrggbb or rrggbbaa.
+	inline bool ParseHexColor(std::string_view s, std::uint32_t& rgba)
+	{
+		const size_t n = s.size();
+		if (n != 3 && n != 4 && n != 6 && n != 8) return false;
+		std::uint32_t v = 0;
+		for (const char c : s)
+		{
+			const int d = HexDigit(c);
+			if (d < 0) return false;
+			v = v << 4 | (std::uint32_t)d;
+		}
+		if (n <= 4)
+		{
+			// Each digit doubled: 0xf80 -> 0xff8800.
+			std::uint32_t wide = 0;
+			for (size_t k = 0; k < n; ++k)
+			{
+				const std::uint32_t d = v >> (4 * (n - 1 - k)) & 0xf;
+				wide = wide << 8 | d << 4 | d;
+			}
+			v = wide;
+		}
+		rgba = n == 3 || n == 6 ? v << 8 | 0xff : v;
+		return true;
+	}
+
+	// The arguments of rgb() or rgba(): three channels, 0-255 or percent,
+	// and an optional alpha, 0-1 or percent.  Commas, blanks and the '/'
+	// before alpha all separate.
+	inline bool ParseRgbArguments(std::string_view s, DirectX::XMFLOAT4& out)
+	{
+		float v[4] = { 0.f, 0.f, 0.f, 1.f };
+		int n = 0;
+		for (;;)
+		{
+			while (!s.empty() && (ValueSpace(s.front()) || s.front() == ',' || s.front() == '/')) s.remove_prefix(1);
+			if (s.empty()) break;
+			if (n == 4 || !ParseNumber(s, v[n])) return false;
+			const bool percent = !s.empty() && s.front() == '%';
+			if (percent) s.remove_prefix(1);
+			if (!s.empty() && !ValueSpace(s.front()) && s.front() != ',' && s.front() != '/') return false;
+			float& c = v[n];
+			if (percent) c /= 100.f;
+			else if (n < 3) c /= 255.f;
+			c = c < 0.f ? 0.f : c > 1.f ? 1.f : c;
+			++n;
+		}
+		if (n < 3) return false;
+		out = DirectX::XMFLOAT4(v[0], v[1], v[2], v[3]);
+		return true;
+	}
+
+	// #rgb, #rgba, #rrggbb, #rrggbbaa, rgb(), rgba() or a CSS color name.
+	inline bool ParseColor(std::string_view s, DirectX::XMFLOAT4& out)
+	{
+		s = TrimValue(s);
+		if (s.empty()) return false;
+
+		std::uint32_t rgba = 0;
+		if (s.front() == '#')
+		{
+			if (!ParseHexColor(s.substr(1), rgba)) return false;
+			out = UnpackColor(rgba);
+			return true;
+		}
+
+		const size_t open = s.find('(');
+		if (open != std::string_view::npos)
+		{
+			const std::string_view function = TrimValue(s.substr(0, open));
+			if (s.back() != ')' || !(SameValueName(function, "rgb") || SameValueName(function, "rgba"))) return false;
+			return ParseRgbArguments(s.substr(open + 1, s.size() - open - 2), out);
+		}
+
+		const NamedColor* named = NamedColorTable::Find(s);
+		if (!named) return false;
+		out = UnpackColor(named->rgba);
+		return true;
+	}
+}
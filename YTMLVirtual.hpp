@@ -0,0 +1,541 @@
+#pragma once
+
+#include "YTML1_1.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Virtual lists for YTML.  A VirtualList takes over a container element and
+// shows a list of any length in it through a few slots, clones of the
+// container's first child: every layout it finds the items the container's
+// content box shows, plus an overscan margin above and below, binds the
+// slots that show new items through a callback and restyles them, and lays
+// out only those slots.  The slots of items still in the window keep their
+// item, so scrolling by an item rebinds one slot.  The slots showing part of
+// the content box are the container's children, laid out and emitted like
+// any other element, and hit by HitTest; the ones in the overscan are bound
+// and laid out, so an item scrolling in is ready, but kept out of the tree.
+// The container does not clip, as no element does.
+//
+// Items run down the container, each as tall as a fixed extent or, when the
+// extent is an estimate, as its slot measures once bound; a slot sizes to its
+// content when it is a flex container with an auto height.  Offsets come
+// from a Fenwick tree of the extents and the scroll position is held as an
+// item and the distance into it, so a layout costs the window and the
+// logarithm of the list's length, and items measuring other than their
+// estimate, or items inserted or erased above, leave what is shown in place.
+
+inline namespace YTML1_1
+{
+	// Extents of items, with the sums of runs of them in a Fenwick tree:
+	// offsets, updates and the item at an offset in O(log n).  Sums are kept
+	// in double, so long lists of small items do not drift.
+	class ItemExtents
+	{
+	public:
+		void Assign(size_t count, float extent)
+		{
+			mExtents.assign(count, extent);
+			Rebuild();
+		}
+
+		// Items added or dropped at the end.
+		void Resize(size_t count, float extent)
+		{
+			// A node only sums items before it, so dropping the last ones
+			// leaves the rest as they are.
+			if (count <= mExtents.size())
+			{
+				mExtents.resize(count);
+				mTree.resize(count + 1);
+				return;
+			}
+			while (mExtents.size() < count)
+			{
+				const size_t i = mExtents.size() + 1;
+				mExtents.push_back(extent);
+				mTree.push_back(extent + Prefix(i - 1) - Prefix(i - (i & (0 - i))));
+			}
+		}
+
+		// Items added or dropped in the middle cost a rebuild, O(n).
+		void Insert(size_t at, size_t count, float extent)
+		{
+			mExtents.insert(mExtents.begin() + at, count, extent);
+			Rebuild();
+		}
+
+		void Erase(size_t at, size_t count)
+		{
+			mExtents.erase(mExtents.begin() + at, mExtents.begin() + at + count);
+			Rebuild();
+		}
+
+		void Set(size_t item, float extent)
+		{
+			const double delta = (double)extent - mExtents[item];
+			mExtents[item] = extent;
+			for (size_t i = item + 1; i < mTree.size(); i += i & (0 - i)) mTree[i] += delta;
+		}
+
+		size_t Size()const { return mExtents.size(); }
+		float Extent(size_t item)const { return mExtents[item]; }
+
+		// Where item starts: the extents of the items before it.
+		double Offset(size_t item)const { return Prefix(item); }
+		double Total()const { return Prefix(mExtents.size()); }
+
+		// The item offset falls in, clamped to the first and last.
+		size_t Find(double offset)const
+		{
+			if (mExtents.empty()) return 0;
+			size_t pos = 0, step = 1;
+			while (step * 2 < mTree.size()) step *= 2;
+			for (; step > 0; step /= 2)
+			{
+				if (pos + step < mTree.size() && mTree[pos + step] <= offset)
+				{
+					pos += step;
+					offset -= mTree[pos];
+				}
+			}
+			return std::min(pos, mExtents.size() - 1);
+		}
+
+	private:
+		double Prefix(size_t count)const
+		{
+			double sum = 0.0;
+			for (size_t i = count; i > 0; i -= i & (0 - i)) sum += mTree[i];
+			return sum;
+		}
+
+		void Rebuild()
+		{
+			mTree.assign(mExtents.size() + 1, 0.0);
+			for (size_t i = 1; i < mTree.size(); ++i)
+			{
+				mTree[i] += mExtents[i - 1];
+				const size_t parent = i + (i & (0 - i));
+				if (parent < mTree.size()) mTree[parent] += mTree[i];
+			}
+		}
+
+		std::vector<float> mExtents;
+		// 1-based; mTree[i] sums the items (i - lowbit(i), i].
+		std::vector<double> mTree;
+	};
+
+	struct VirtualListStats {
+		// Of the last layout: slots in the content box, slots laid out with
+		// the overscan, slots bound to a new item, and slots in all.
+		size_t shown = 0;
+		size_t laid_out = 0;
+		size_t bound = 0;
+		size_t slots = 0;
+	};
+
+	class VirtualList : public ChildLayout
+	{
+	public:
+		// Sets what slot shows for item, typically attributes of the slot and
+		// its children, which are applied and restyled after.  It is called
+		// while the tree is laid out, on a worker under RunYTML1_1Parallel,
+		// and must only touch the slot.
+		using Bind = std::function<void(size_t item, Tree& slot)>;
+
+		static constexpr size_t None = std::numeric_limits<size_t>::max();
+
+		// Takes over the children of container: the first is the template of
+		// the slots, the rest are dropped.  sheet restyles bound slots; slot
+		// eids are taken from biggest_id.  The list has to go before its
+		// container does.
+		VirtualList(Tree& container, const StyleSheet& sheet, size_t& biggest_id, Bind bind) :
+			mContainer(container), mBiggestId(biggest_id), mBind(std::move(bind)), mMatcher(sheet)
+		{
+			if (container.child.empty())
+			{
+				mTemplate = new Tree();
+				mTemplate->value.head = "div";
+			}
+			else
+			{
+				mTemplate = container.child.front();
+				for (size_t i = 1; i < container.child.size(); ++i) delete container.child[i];
+				container.child.clear();
+			}
+			mTemplate->parent = &container;
+			container->child_layout = this;
+			container->flags |= ElementFlag::LayoutDirty;
+		}
+
+		VirtualList(const VirtualList&) = delete;
+		VirtualList& operator=(const VirtualList&) = delete;
+
+		~VirtualList() override
+		{
+			// The slots shown are the container's to delete.
+			for (const Slot& s : mSlots)
+				if (std::find(mContainer.child.begin(), mContainer.child.end(), s.node) == mContainer.child.end()) delete s.node;
+			delete mTemplate;
+			mContainer->child_layout = nullptr;
+		}
+
+		// Every item is extent pixels tall, margins included; an estimate is
+		// replaced by what the item measures once it is laid out.
+		void SetExtent(float extent, bool estimated)
+		{
+			mExtent = std::max(extent, 1.f);
+			mEstimated = estimated;
+			if (mEstimated) mExtents.Assign(mCount, mExtent);
+			else mExtents.Assign(0, mExtent);
+		}
+
+		// In pixels, beyond each edge of the content box.
+		void SetOverscan(float overscan) { mOverscan = std::max(overscan, 0.f); }
+
+		// Keeps the last item in view while it is, as a log viewer does.
+		void SetFollowEnd(bool follow) { mFollowEnd = follow; }
+
+		// Items added or dropped at the end.
+		void SetCount(size_t count)
+		{
+			if (count < mCount) Unbind(count, mCount);
+			mCount = count;
+			if (mEstimated) mExtents.Resize(count, mExtent);
+			if (mAnchor >= count)
+			{
+				mAnchor = count > 0 ? count - 1 : 0;
+				mWithin = 0.0;
+			}
+		}
+
+		// count items before item at; what is shown stays where it is.
+		void Insert(size_t at, size_t count)
+		{
+			at = std::min(at, mCount);
+			mCount += count;
+			if (mEstimated) mExtents.Insert(at, count, mExtent);
+			Shift(at, count, true);
+			if (mAnchor >= at && mCount > count) mAnchor += count;
+		}
+
+		void Erase(size_t at, size_t count)
+		{
+			if (at >= mCount) return;
+			count = std::min(count, mCount - at);
+			Unbind(at, at + count);
+			mCount -= count;
+			if (mEstimated) mExtents.Erase(at, count);
+			Shift(at + count, count, false);
+			if (mAnchor >= at + count) mAnchor -= count;
+			else if (mAnchor >= at)
+			{
+				mAnchor = std::min(at, mCount > 0 ? mCount - 1 : 0);
+				mWithin = 0.0;
+			}
+		}
+
+		// Binds the items [first, last) again at the next layout, e.g. after
+		// the data they show or the stylesheet changed.
+		void Refresh(size_t first = 0, size_t last = None)
+		{
+			Unbind(first, std::min(last, mCount));
+		}
+
+		// From the top of the first item; clamped to the content at layout.
+		void ScrollTo(double offset)
+		{
+			offset = std::max(offset, 0.0);
+			mAnchor = Find(offset);
+			mWithin = offset - Offset(mAnchor);
+			mAtEnd = false;
+		}
+
+		void ScrollBy(double delta) { ScrollTo(ScrollOffset() + delta); }
+
+		double ScrollOffset()const { return mCount > 0 ? Offset(mAnchor) + mWithin : 0.0; }
+		double ContentExtent()const { return Offset(mCount); }
+		// The height of the content box at the last layout.
+		float Viewport()const { return mViewport; }
+		size_t Count()const { return mCount; }
+		const VirtualListStats& Stats()const { return mStats; }
+
+		void LayoutChildren(Tree& node, const LengthBasis& basis, LayoutPass& pass) override
+		{
+			Element& t = node.value;
+			const FloatRect& d = t.size_in_display;
+			LengthBasis inner = basis;
+			inner.width = d.w - t.border.left - t.border.right;
+			inner.height = d.h - t.border.top - t.border.bottom;
+			inner.font = t.font_size;
+			const float x = d.x + t.border.left, y = d.y + t.border.top;
+			mViewport = std::max(inner.height, 0.f);
+
+			mStats = VirtualListStats();
+			node.child.clear();
+			++mFrame;
+			if (mCount == 0)
+			{
+				mStats.slots = mSlots.size();
+				return;
+			}
+
+			const double wanted = mFollowEnd && mAtEnd ? std::numeric_limits<double>::max() : ScrollOffset();
+			double scroll = Clamp(wanted);
+			SetAnchor(scroll);
+
+			// Slots of items outside the window expected from the extents
+			// known so far are free to show others.
+			const size_t first_expected = Find(scroll - mOverscan), last_expected = Find(scroll + mViewport + mOverscan);
+			mFree.clear();
+			for (uint32_t s = 0; s < mSlots.size(); ++s)
+				if (mSlots[s].item == None || mSlots[s].item < first_expected || mSlots[s].item > last_expected) mFree.push_back(s);
+
+			// Down from the anchor until the content box and the overscan are
+			// covered, again while what was measured moves the end of the
+			// content past a clamped scroll position; then up from it.  Items
+			// measured above the anchor move it, and the scroll position with
+			// it.
+			mBinding = false;
+			for (int settle = 0;; ++settle)
+			{
+				mWindow.clear();
+				size_t last = mAnchor;
+				while (last < mCount && (last == mAnchor || Offset(last) < scroll + mViewport + mOverscan)) mWindow.push_back(Prepare(node, last++, inner, pass));
+				const double end = Clamp(wanted);
+				if (end == scroll || settle == 3) break;
+				scroll = end;
+				SetAnchor(scroll);
+			}
+			size_t first = mAnchor;
+			std::vector<Shown>& above = mAbove;
+			above.clear();
+			while (first > 0 && Offset(first) > Offset(mAnchor) + mWithin - mOverscan) above.push_back(Prepare(node, --first, inner, pass));
+			scroll = Offset(mAnchor) + mWithin;
+			mWindow.insert(mWindow.begin(), above.rbegin(), above.rend());
+			mAtEnd = scroll >= Clamp(std::numeric_limits<double>::max()) - 0.5;
+
+			static const std::function<void(Element&, bool&)> nop = [](Element&, bool&) {};
+			bool aside_run = true;
+			// Slots in the overscan are laid out here, never handed to a task.
+			LayoutPass aside = { nop, aside_run, pass.stats, pass.id, nullptr };
+			for (const Shown& w : mWindow)
+			{
+				Tree& slot = *mSlots[w.slot].node;
+				Element& e = slot.value;
+				ResolveIfStale(e, inner, pass.stats);
+				const float h = !AutoLength(e.lengths.height) ? e.size.h :
+					mEstimated ? w.height : std::max(mExtent - e.margin.top - e.margin.bottom, 0.f);
+				const float top = y + (float)(Offset(w.item) - scroll);
+				FloatRect& r = e.size_in_display;
+				r.x = x + e.margin.left;
+				r.y = top + e.margin.top;
+				r.w = AutoLength(e.lengths.width) ? std::max(inner.width - e.margin.left - e.margin.right, 0.f) : e.size.w;
+				r.h = h;
+				e.flags &= ~(uint16_t)ElementFlag::LayoutDirty;
+				++pass.stats.elements;
+				++mStats.laid_out;
+
+				const FloatRect margin_box = { r.x - e.margin.left, top, r.w + e.margin.left + e.margin.right, r.h + e.margin.top + e.margin.bottom };
+				if (margin_box.y < y + mViewport && margin_box.y + margin_box.h > y)
+				{
+					node.child.push_back(&slot);
+					++mStats.shown;
+					pass.user_func(e, pass.run);
+					if (!pass.run) return;
+					if (!pass.defer || !pass.defer(slot, margin_box, inner)) YTML1_1::LayoutChildren(slot, margin_box, inner, pass);
+					if (!pass.run) return;
+				}
+				else
+				{
+					YTML1_1::LayoutChildren(slot, margin_box, inner, aside);
+				}
+			}
+			mStats.slots = mSlots.size();
+		}
+
+	private:
+		struct Slot {
+			Tree* node;
+			size_t item = None;
+			// The layout that last claimed the slot.
+			uint32_t frame = 0;
+		};
+
+		// A slot in the window, with the height it measured.
+		struct Shown {
+			size_t item;
+			uint32_t slot;
+			float height;
+		};
+
+		double Offset(size_t item)const { return mEstimated ? mExtents.Offset(item) : (double)item * mExtent; }
+
+		size_t Find(double offset)const
+		{
+			if (mCount == 0) return 0;
+			if (mEstimated) return mExtents.Find(offset);
+			return (size_t)std::min(std::max(std::floor(offset / mExtent), 0.0), (double)(mCount - 1));
+		}
+
+		double Clamp(double offset)const
+		{
+			return std::min(std::max(offset, 0.0), std::max(Offset(mCount) - mViewport, 0.0));
+		}
+
+		void SetAnchor(double offset)
+		{
+			mAnchor = Find(offset);
+			mWithin = offset - Offset(mAnchor);
+		}
+
+		// The slot for item, bound to it unless it already is, and measured.
+		Shown Prepare(Tree& node, size_t item, const LengthBasis& inner, LayoutPass& pass)
+		{
+			uint32_t s;
+			auto itr = mSlotOf.find(item);
+			if (itr != mSlotOf.end()) s = itr->second;
+			else
+			{
+				while (!mFree.empty() && mSlots[mFree.back()].frame == mFrame) mFree.pop_back();
+				if (!mFree.empty())
+				{
+					s = mFree.back();
+					mFree.pop_back();
+					if (mSlots[s].item != None) mSlotOf.erase(mSlots[s].item);
+				}
+				else
+				{
+					s = (uint32_t)mSlots.size();
+					mSlots.push_back({ Clone(*mTemplate, node) });
+				}
+				mSlots[s].item = item;
+				mSlotOf[item] = s;
+				BindSlot(node, *mSlots[s].node, item);
+			}
+			mSlots[s].frame = mFrame;
+
+			Shown shown = { item, s, 0.f };
+			if (mEstimated)
+			{
+				Tree& slot = *mSlots[s].node;
+				const Element& e = slot.value;
+				shown.height = MeasureYTML1_1(slot, inner, pass).h;
+				const float extent = e.margin.top + shown.height + e.margin.bottom;
+				// A block with an auto height measures nothing; it keeps the estimate.
+				if (AutoLength(e.lengths.height) && shown.height <= 0.f) shown.height = std::max(mExtent - e.margin.top - e.margin.bottom, 0.f);
+				else if (extent != mExtents.Extent(item)) mExtents.Set(item, extent);
+			}
+			return shown;
+		}
+
+		void BindSlot(Tree& node, Tree& slot, size_t item)
+		{
+			if (mBind) mBind(item, slot);
+			++mStats.bound;
+
+			// The matcher holds the container's ancestors for the rest of
+			// the layout.
+			if (!mBinding)
+			{
+				while (mMatcher.Depth() > 0) mMatcher.Pop();
+				std::vector<const Tree*> path;
+				for (const Tree* p = &node; p->parent != nullptr; p = p->parent) path.push_back(p);
+				for (auto itr = path.rbegin(); itr != path.rend(); ++itr)
+				{
+					ReadSelectorElement(mMatcher.Subject(), (*itr)->value);
+					mMatcher.Push();
+				}
+				mBinding = true;
+			}
+			Restyle(slot);
+		}
+
+		void Restyle(Tree& node)
+		{
+			Element& e = node.value;
+			e.ResetStyle();
+			e.ApplyAttributes();
+			ApplyStyle(e, mMatcher);
+			e.flags |= ElementFlag::LayoutDirty;
+			if (node.child.empty()) return;
+			mMatcher.Push();
+			for (Tree* c : node.child) Restyle(*c);
+			mMatcher.Pop();
+		}
+
+		Tree* Clone(const Tree& from, Tree& parent)
+		{
+			Tree* to = new Tree();
+			to->value = from.value;
+			to->parent = &parent;
+			{
+				// Lists may grow their pools on different layout workers.
+				static std::mutex ids;
+				std::lock_guard<std::mutex> lock(ids);
+				to->value.eid = mBiggestId++;
+			}
+			to->value.flags |= ElementFlag::LayoutDirty;
+			for (const Tree* c : from.child) to->child.push_back(Clone(*c, *to));
+			return to;
+		}
+
+		// Slots of items in [first, last) show nothing.
+		void Unbind(size_t first, size_t last)
+		{
+			for (Slot& s : mSlots)
+			{
+				if (s.item == None || s.item < first || s.item >= last) continue;
+				mSlotOf.erase(s.item);
+				s.item = None;
+			}
+		}
+
+		// Items from at on moved by count, down when inserted.
+		void Shift(size_t at, size_t count, bool down)
+		{
+			mSlotOf.clear();
+			for (uint32_t i = 0; i < mSlots.size(); ++i)
+			{
+				Slot& s = mSlots[i];
+				if (s.item == None) continue;
+				if (s.item >= at) s.item = down ? s.item + count : s.item - count;
+				mSlotOf[s.item] = i;
+			}
+		}
+
+		Tree& mContainer;
+		size_t& mBiggestId;
+		Bind mBind;
+		Tree* mTemplate = nullptr;
+
+		size_t mCount = 0;
+		float mExtent = 24.f;
+		bool mEstimated = false;
+		ItemExtents mExtents;
+		float mOverscan = 256.f;
+		bool mFollowEnd = false;
+
+		// The scroll position: the item at the top of the content box and
+		// how far into it.
+		size_t mAnchor = 0;
+		double mWithin = 0.0;
+		bool mAtEnd = false;
+		float mViewport = 0.f;
+
+		std::vector<Slot> mSlots;
+		std::unordered_map<size_t, uint32_t> mSlotOf;
+		std::vector<uint32_t> mFree;
+		std::vector<Shown> mWindow, mAbove;
+		uint32_t mFrame = 0;
+		StyleMatcher mMatcher;
+		bool mBinding = false;
+		VirtualListStats mStats;
+	};
+}